@@ -58,6 +58,7 @@
 #include "misc.h"
 #include "machine.h"
 #include "bpred.h"
+#include "warm.h"
 
 /* turn this on to enable the SimpleScalar 2.0 RAS bug */
 /* #define RAS_BUG_COMPATIBLE */
@@ -483,6 +484,128 @@ bpred_after_priming(struct bpred_t *bpred)
   bpred->ras_hits = 0;
 }
 
+/* write NBYTES bytes of predictor state at P to warm state file W, or read
+   them from W if it is open for reading */
+static void
+bpred_warm_xfer(struct warm_t *w,	/* warm state file */
+		void *p,		/* predictor state */
+		int nbytes)		/* number of bytes */
+{
+  if (w->writing)
+    warm_put(w, p, nbytes);
+  else
+    warm_get(w, p, nbytes);
+}
+
+/* save or restore the state of branch direction predictor PRED_DIR */
+static void
+bpred_dir_warm(struct bpred_dir_t *pred_dir,	/* branch dir predictor inst */
+	       struct warm_t *w)		/* warm state file */
+{
+  warm_check(w, "direction predictor", (int)pred_dir->class);
+  switch (pred_dir->class) {
+  case BPred2Level:
+    warm_check(w, "level-1 size", pred_dir->config.two.l1size);
+    warm_check(w, "level-2 size", pred_dir->config.two.l2size);
+    warm_check(w, "history width", pred_dir->config.two.shift_width);
+    warm_check(w, "history xor", pred_dir->config.two.xor);
+    bpred_warm_xfer(w, pred_dir->config.two.shiftregs,
+		    pred_dir->config.two.l1size * sizeof(int));
+    bpred_warm_xfer(w, pred_dir->config.two.l2table,
+		    pred_dir->config.two.l2size * sizeof(unsigned char));
+    break;
+
+  case BPred2bit:
+    warm_check(w, "table size", pred_dir->config.bimod.size);
+    bpred_warm_xfer(w, pred_dir->config.bimod.table,
+		    pred_dir->config.bimod.size * sizeof(unsigned char));
+    break;
+
+  case BPredTaken:
+  case BPredNotTaken:
+    /* no other state */
+    break;
+
+  default:
+    panic("bogus branch direction predictor class");
+  }
+}
+
+/* save or restore BTB (or return-address stack) entry ENT */
+static void
+bpred_ent_warm(struct bpred_btb_ent_t *ent,	/* BTB entry */
+	       struct warm_t *w)		/* warm state file */
+{
+  bpred_warm_xfer(w, &ent->addr, sizeof(md_addr_t));
+  bpred_warm_xfer(w, &ent->op, sizeof(enum md_opcode));
+  bpred_warm_xfer(w, &ent->target, sizeof(md_addr_t));
+}
+
+/* save or restore the state of branch predictor PRED */
+static void
+bpred_warm(struct bpred_t *pred,	/* branch predictor instance */
+	   struct warm_t *w)		/* warm state file */
+{
+  struct bpred_btb_ent_t *ent;
+  int i, prev, next, nents = pred->btb.sets * pred->btb.assoc;
+
+  warm_check(w, "predictor", (int)pred->class);
+  if (pred->dirpred.bimod)
+    bpred_dir_warm(pred->dirpred.bimod, w);
+  if (pred->dirpred.twolev)
+    bpred_dir_warm(pred->dirpred.twolev, w);
+  if (pred->dirpred.meta)
+    bpred_dir_warm(pred->dirpred.meta, w);
+
+  if (pred->class == BPredTaken || pred->class == BPredNotTaken)
+    return;
+
+  /* the BTB, with the LRU chain of each set as entry indices */
+  warm_check(w, "BTB sets", pred->btb.sets);
+  warm_check(w, "BTB associativity", pred->btb.assoc);
+  for (i=0; i < nents; i++)
+    {
+      ent = &pred->btb.btb_data[i];
+      bpred_ent_warm(ent, w);
+
+      prev = ent->prev ? ent->prev - pred->btb.btb_data : -1;
+      next = ent->next ? ent->next - pred->btb.btb_data : -1;
+      bpred_warm_xfer(w, &prev, sizeof(int));
+      bpred_warm_xfer(w, &next, sizeof(int));
+      if (prev >= nents || next >= nents)
+	fatal("warm state of `%s' in `%s' is corrupted", w->name, w->fname);
+      ent->prev = prev >= 0 ? &pred->btb.btb_data[prev] : NULL;
+      ent->next = next >= 0 ? &pred->btb.btb_data[next] : NULL;
+    }
+
+  /* the return-address stack */
+  warm_check(w, "return-address stack size", pred->retstack.size);
+  bpred_warm_xfer(w, &pred->retstack.tos, sizeof(int));
+  for (i=0; i < pred->retstack.size; i++)
+    bpred_ent_warm(&pred->retstack.stack[i], w);
+}
+
+/* save the state of branch predictor PRED to warm state file W */
+void
+bpred_save(struct bpred_t *pred,	/* branch predictor instance */
+	   struct warm_t *w)		/* warm state file to write */
+{
+  warm_begin(w, "bpred");
+  bpred_warm(pred, w);
+  warm_end(w);
+}
+
+/* restore the state of branch predictor PRED from the current section of
+   warm state file W */
+void
+bpred_restore(struct bpred_t *pred,	/* branch predictor instance */
+	      struct warm_t *w)		/* warm state file to read */
+{
+  if (pred->lookups)
+    panic("branch predictor restored after it was used");
+  bpred_warm(pred, w);
+}
+
 #define BIMOD_HASH(PRED, ADDR)						\
   ((((ADDR) >> 19) ^ ((ADDR) >> MD_BR_SHIFT)) & ((PRED)->config.bimod.size-1))
     /* was: ((baddr >> 16) ^ baddr) & (pred->dirpred.bimod.size-1) */
@@ -61,6 +61,8 @@
 #include "machine.h"
 #include "stats.h"
 
+struct warm_t;
+
 /*
  * This module implements a number of branch predictor mechanisms.  The
  * following predictors are supported:
@@ -273,6 +275,20 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
 	     struct bpred_update_t *dir_update_ptr); /* pred state pointer */
 
 
+/* save the direction predictor tables, BTB and return-address stack of
+   branch predictor PRED, i.e., its warm state, in the section "bpred" of
+   warm state file W (see warm.h) */
+void
+bpred_save(struct bpred_t *pred,	/* branch predictor instance */
+	   struct warm_t *w);		/* warm state file to write */
+
+/* restore the state of branch predictor PRED from the current section of
+   warm state file W, the predictor must be configured like the one saved,
+   and not used yet */
+void
+bpred_restore(struct bpred_t *pred,	/* branch predictor instance */
+	      struct warm_t *w);	/* warm state file to read */
+
 #ifdef foo0
 /* OBSOLETE */
 /* dump branch predictor state (for debug) */
@@ -0,0 +1,260 @@
+/* bus.c - interconnect contention model routines */
+
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stats.h"
+#include "bus.h"
+
+/* create a bus named NAME */
+struct bus_t *				/* bus created */
+bus_create(char *name,			/* bus name */
+	   int channels,		/* number of channels */
+	   int width,			/* channel width, in bytes */
+	   int occupancy,		/* cycles per WIDTH bytes */
+	   int queue)			/* transfers waiting per channel */
+{
+  struct bus_t *bus;
+
+  if (channels <= 0)
+    fatal("bus `%s' channels `%d' must be non-zero and positive",
+	  name, channels);
+  if (width <= 0)
+    fatal("bus `%s' width `%d' must be non-zero and positive", name, width);
+  if (occupancy <= 0)
+    fatal("bus `%s' occupancy `%d' must be non-zero and positive",
+	  name, occupancy);
+  if (queue < 0)
+    fatal("bus `%s' queue `%d' must be positive", name, queue);
+
+  bus = (struct bus_t *)calloc(1, sizeof(struct bus_t));
+  if (!bus)
+    fatal("out of virtual memory");
+
+  bus->name = mystrdup(name);
+  bus->channels = channels;
+  bus->width = width;
+  bus->occupancy = occupancy;
+  bus->queue = queue;
+
+  bus->chan = (struct bus_chan_t *)calloc(channels, sizeof(struct bus_chan_t));
+  if (!bus->chan)
+    fatal("out of virtual memory");
+
+  return bus;
+}
+
+/* parse bus config BUS and create the bus named NAME */
+struct bus_t *				/* bus created */
+bus_parse(char *name,			/* bus name */
+	  char *bus)			/* bus config */
+{
+  int channels, width, occupancy, queue;
+
+  if (!mystricmp(bus, "none"))
+    return NULL;
+
+  if (sscanf(bus, "%d:%d:%d:%d", &channels, &width, &occupancy, &queue) != 4)
+    fatal("bad bus config `%s', use <channels>:<width>:<occupancy>:<queue>",
+	  bus);
+
+  return bus_create(name, channels, width, occupancy, queue);
+}
+
+/* print bus configuration */
+void
+bus_config(struct bus_t *bus,		/* bus instance */
+	   FILE *stream)		/* output stream */
+{
+  fprintf(stream,
+	  "bus: %s: %d channel(s), %d bytes wide, %d cycle(s)/transfer, ",
+	  bus->name, bus->channels, bus->width, bus->occupancy);
+  if (bus->queue)
+    fprintf(stream, "%d queued transfer(s)/channel\n", bus->queue);
+  else
+    fprintf(stream, "unlimited queue\n");
+}
+
+/* register bus stats */
+void
+bus_reg_stats(struct bus_t *bus,	/* bus instance */
+	      struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], buf1[512], *name = bus->name;
+
+  sprintf(buf, "%s.transfers", name);
+  stat_reg_counter(sdb, buf, "total number of transfers",
+		   &bus->transfers, 0, NULL);
+  sprintf(buf, "%s.bytes", name);
+  stat_reg_counter(sdb, buf, "total number of bytes transferred",
+		   &bus->bytes, 0, NULL);
+  sprintf(buf, "%s.busy_cycles", name);
+  stat_reg_counter(sdb, buf, "total number of channel cycles busy",
+		   &bus->busy_cycles, 0, NULL);
+  sprintf(buf, "%s.wait_cycles", name);
+  stat_reg_counter(sdb, buf, "total cycles transfers waited for a channel",
+		   &bus->wait_cycles, 0, NULL);
+  sprintf(buf, "%s.queue_full", name);
+  stat_reg_counter(sdb, buf, "total number of transfers finding queues full",
+		   &bus->queue_full, 0, NULL);
+  sprintf(buf, "%s.avg_wait", name);
+  sprintf(buf1, "%s.wait_cycles / %s.transfers", name, name);
+  stat_reg_formula(sdb, buf, "average cycles a transfer waited", buf1, NULL);
+}
+
+/* find the earliest time no earlier than WHEN that channel CH can accept a
+   transfer of OCC cycles, sets *POS to where the transfer goes in the list */
+static tick_t
+bus_fit(struct bus_t *bus, struct bus_chan_t *ch, int occ, tick_t when,
+	int *pos, int *full)
+{
+  int i, waiting;
+  tick_t next;
+
+  /* a full queue holds the request back until a waiting transfer starts */
+  *full = FALSE;
+  if (bus->queue)
+    for (;;)
+      {
+	waiting = 0;
+	next = 0;
+	for (i=0; i<ch->num; i++)
+	  if (ch->xfer[i].req <= when && ch->xfer[i].start > when)
+	    {
+	      if (!waiting++)
+		next = ch->xfer[i].start;
+	    }
+	if (waiting < bus->queue)
+	  break;
+	*full = TRUE;
+	when = next;
+      }
+
+  /* take the first gap after WHEN long enough for the transfer */
+  for (i=0; i<ch->num; i++)
+    {
+      if (ch->xfer[i].end <= when)
+	continue;
+      if (ch->xfer[i].start >= when + occ)
+	break;
+      when = ch->xfer[i].end;
+    }
+  *pos = i;
+  return when;
+}
+
+/* transfer NBYTES over BUS, starting no earlier than WHEN */
+unsigned int				/* latency of transfer */
+bus_access(struct bus_t *bus,		/* bus instance */
+	   int nbytes,			/* bytes transferred */
+	   tick_t when,			/* earliest start of transfer */
+	   tick_t now)			/* current time */
+{
+  int c, n, pos, full, best = -1, best_pos = 0, best_full = FALSE;
+  int occ = ((nbytes + (bus->width - 1)) / bus->width) * bus->occupancy;
+  struct bus_chan_t *ch;
+  tick_t start, best_start = 0;
+
+  for (c=0; c<bus->channels; c++)
+    {
+      ch = &bus->chan[c];
+
+      /* forget the transfers done by now */
+      for (n=0; n<ch->num && ch->xfer[n].end <= now; n++)
+	/* nada */;
+      if (n > 0)
+	{
+	  ch->num -= n;
+	  memmove(ch->xfer, ch->xfer + n, ch->num * sizeof(struct bus_xfer_t));
+	}
+
+      start = bus_fit(bus, ch, occ, when, &pos, &full);
+      if (best < 0 || start < best_start)
+	{
+	  best = c;
+	  best_start = start;
+	  best_pos = pos;
+	  best_full = full;
+	}
+    }
+
+  /* accept the transfer on the channel that can start it first */
+  ch = &bus->chan[best];
+  if (ch->num == ch->size)
+    {
+      ch->size = ch->size ? 2 * ch->size : 16;
+      ch->xfer = (struct bus_xfer_t *)
+	realloc(ch->xfer, ch->size * sizeof(struct bus_xfer_t));
+      if (!ch->xfer)
+	fatal("out of virtual memory");
+    }
+  memmove(ch->xfer + best_pos + 1, ch->xfer + best_pos,
+	  (ch->num - best_pos) * sizeof(struct bus_xfer_t));
+  ch->xfer[best_pos].req = when;
+  ch->xfer[best_pos].start = best_start;
+  ch->xfer[best_pos].end = best_start + occ;
+  ch->num++;
+
+  bus->transfers++;
+  bus->bytes += nbytes;
+  bus->busy_cycles += occ;
+  bus->wait_cycles += best_start - when;
+  if (best_full)
+    bus->queue_full++;
+
+  return (unsigned int)(best_start + occ - when);
+}
@@ -0,0 +1,150 @@
+/* bus.h - interconnect contention model interfaces */
+
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#ifndef BUS_H
+#define BUS_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stats.h"
+
+/*
+ * A bus models the interconnect between a cache and the next level of the
+ * memory hierarchy (see cache_set_bus()), it may be shared by several
+ * caches, e.g., the L1 instruction and data caches sharing the bus to a
+ * unified L2 cache.  A bus has CHANNELS independent channels, each
+ * WIDTH bytes wide, a transfer of N bytes occupies a channel for
+ * OCCUPANCY cycles per WIDTH bytes, and takes whichever channel can carry
+ * it first.  Fills and writebacks of all the caches attached to the bus
+ * compete for its channels.
+ *
+ * Every channel keeps the transfers it has accepted as a list of busy
+ * intervals, so a transfer requested for a future time (e.g., the data of
+ * a fill returning from the next level) does not hold up transfers
+ * requested for earlier times, which are fitted into the gaps before it.
+ * Up to QUEUE transfers may be waiting on a channel (wanted, but not yet
+ * started), a request finding the queue full waits for the next waiting
+ * transfer to start before it is accepted (QUEUE of zero for an unlimited
+ * queue).
+ */
+
+/* a transfer accepted by a bus channel */
+struct bus_xfer_t
+{
+  tick_t req;			/* time the transfer was wanted */
+  tick_t start;			/* time the transfer starts */
+  tick_t end;			/* time the transfer is done */
+};
+
+/* bus channel, its transfers are kept sorted by start time */
+struct bus_chan_t
+{
+  struct bus_xfer_t *xfer;	/* accepted transfers */
+  int num;			/* number of transfers */
+  int size;			/* number of transfers allocated */
+};
+
+/* bus definition */
+struct bus_t
+{
+  char *name;			/* bus name */
+  int channels;			/* number of channels */
+  int width;			/* channel width, in bytes */
+  int occupancy;		/* cycles per WIDTH bytes transferred */
+  int queue;			/* transfers waiting per channel, 0 for any */
+  struct bus_chan_t *chan;	/* channels */
+
+  /* stats */
+  counter_t transfers;		/* total number of transfers */
+  counter_t bytes;		/* total bytes transferred */
+  counter_t busy_cycles;	/* total channel cycles busy */
+  counter_t wait_cycles;	/* total cycles transfers waited for a channel */
+  counter_t queue_full;		/* transfers that found the queues full */
+};
+
+/* create a bus named NAME */
+struct bus_t *				/* bus created */
+bus_create(char *name,			/* bus name */
+	   int channels,		/* number of channels */
+	   int width,			/* channel width, in bytes */
+	   int occupancy,		/* cycles per WIDTH bytes */
+	   int queue);			/* transfers waiting per channel */
+
+/* parse bus config BUS, "<channels>:<width>:<occupancy>:<queue>", and create
+   the bus named NAME, returns NULL for none */
+struct bus_t *				/* bus created */
+bus_parse(char *name,			/* bus name */
+	  char *bus);			/* bus config */
+
+/* print bus configuration */
+void
+bus_config(struct bus_t *bus,		/* bus instance */
+	   FILE *stream);		/* output stream */
+
+/* register bus stats */
+void
+bus_reg_stats(struct bus_t *bus,	/* bus instance */
+	      struct stat_sdb_t *sdb);	/* stats database */
+
+/* transfer NBYTES over BUS, starting no earlier than WHEN, NOW is the
+   current time (transfers done by NOW are forgotten), returns the time
+   from WHEN until the transfer is done */
+unsigned int				/* latency of transfer */
+bus_access(struct bus_t *bus,		/* bus instance */
+	   int nbytes,			/* bytes transferred */
+	   tick_t when,			/* earliest start of transfer */
+	   tick_t now);			/* current time */
+
+#endif /* BUS_H */
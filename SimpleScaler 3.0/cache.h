@@ -78,16 +78,20 @@
  * physical page address information, etc...
  *
  * The caches implemented by this module provide efficient storage management
- * and fast access for all cache geometries.  When sets become highly
- * associative, a hash table (indexed by address) is allocated for each set
- * in the cache.
+ * and fast access for all cache geometries.  The tags of each set are kept
+ * in a contiguous tag store, apart from the blocks and their replacement
+ * state, so a lookup only touches the tags of its set.  When sets become
+ * highly associative, a hash table (indexed by address) is allocated for
+ * each set in the cache instead.
  *
  * This module also tracks latency of accessing the data cache, each cache has
  * a hit latency defined when instantiated, miss latency is returned by the
  * cache's block access function, the caches may service any number of hits
- * under any number of misses, the calling simulator should limit the number
- * of outstanding misses or the number of hits under misses as per the
- * limitations of the particular microarchitecture being simulated.
+ * under any number of misses, unless the cache is given miss status holding
+ * registers (see cache_set_mshr()), then misses wait for a free MSHR, and
+ * the calling simulator can use cache_mshr_avail() to hold back accesses
+ * that would have to wait, as per the limitations of the particular
+ * microarchitecture being simulated.
  *
  * Due to the organization of this cache implementation, the latency of a
  * request cannot be affected by a later request to this module.  As a result,
@@ -95,19 +99,115 @@
  */
 
 /* highly associative caches are implemented using a hash table lookup to
-   speed block access, this macro decides if a cache is "highly associative" */
-#define CACHE_HIGHLY_ASSOC(cp)	((cp)->assoc > 4)
+   speed block access, this macro decides if a cache is "highly associative",
+   up to this associativity searching the tag store of a set is faster */
+#define CACHE_HIGHLY_ASSOC(cp)	((cp)->assoc > 32)
 
 /* cache replacement policy */
 enum cache_policy {
   LRU,		/* replace least recently used block (perfect LRU) */
   Random,	/* replace a random block */
-  FIFO		/* replace the oldest block in the set */
+  FIFO,		/* replace the oldest block in the set */
+  TreePLRU,	/* tree pseudo-LRU, ASSOC-1 bits per set */
+  BitPLRU,	/* bit (MRU) pseudo-LRU, ASSOC bits per set */
+  SRRIP,	/* static re-reference interval prediction */
+  BRRIP,	/* bimodal RRIP, most fills predicted distant */
+  DRRIP		/* dynamic RRIP, SRRIP or BRRIP by set dueling */
 };
 
+/* RRIP parameters, 2-bit re-reference prediction values (RRPVs), BRRIP
+   inserts one fill in RRIP_BIMODAL at RRIP_MAX-1 and the others at RRIP_MAX,
+   DRRIP dedicates about RRIP_LEADERS sets to each of SRRIP and BRRIP and
+   follows the one with fewer misses according to a 10-bit PSEL counter */
+#define RRIP_MAX		3
+#define RRIP_BIMODAL		32
+#define RRIP_LEADERS		32
+#define RRIP_PSEL_MAX		1023
+
+/* cache set index function */
+enum cache_index {
+  IndexBits,	/* the index bits of the address (bit selection) */
+  IndexXOR,	/* the index bits XORed with as many low tag bits */
+  IndexPrime,	/* the block address modulo the largest prime <= NSETS */
+  IndexSkew	/* skewed-associative, each way XORs in its own tag hash */
+};
+
+/* cache write policy */
+enum cache_wpolicy {
+  WriteBack,	/* mark block dirty, write it to the next level on eviction */
+  WriteThrough	/* forward every write to the next level immediately */
+};
+
+/* tag store value of an invalid block */
+#define CACHE_TAG_INVALID	((md_addr_t)-1)
+
 /* block status values */
 #define CACHE_BLK_VALID		0x00000001	/* block in valid, in use */
 #define CACHE_BLK_DIRTY		0x00000002	/* dirty block */
+#define CACHE_BLK_PREFETCH	0x00000004	/* prefetched block, not yet used */
+
+/* write buffer entry, a block written through to the next level */
+struct cache_wbuf_ent_t
+{
+  md_addr_t baddr;		/* address of block written */
+  tick_t start;			/* when the write to the next level starts,
+				   writes to the block combine until then */
+  tick_t done;			/* when the write to the next level is done,
+				   and the entry is free */
+};
+
+/* victim buffer entry, a block evicted from the cache */
+struct cache_victim_t
+{
+  md_addr_t baddr;		/* address of block held */
+  unsigned int status;		/* block status, see CACHE_BLK_* defs above */
+  byte_t *user_data;		/* user data of the block, swapped with the
+				   cache block the entry is exchanged with */
+  byte_t *data;			/* block data, if BALLOC */
+};
+
+/* miss status holding register, an outstanding miss of the cache */
+struct cache_mshr_t
+{
+  md_addr_t baddr;		/* address of block being filled */
+  tick_t ready;			/* when the fill is done, and the MSHR is
+				   free */
+  int targets;			/* accesses waiting for the fill */
+};
+
+/* block of the 3C shadow cache, blocks are never freed, so a block that
+   is not in the shadow cache remembers that its address was touched */
+struct cache_shadow_blk_t
+{
+  md_addr_t baddr;		/* block address */
+  struct cache_shadow_blk_t *hash_next;/* next block in the hash chain */
+  struct cache_shadow_blk_t *lru_prev;/* next more recently used block */
+  struct cache_shadow_blk_t *lru_next;/* next less recently used block */
+  int resident;			/* block in the shadow cache? */
+};
+
+/* fully-associative LRU shadow of a cache, of the same capacity, used to
+   classify its misses as compulsory (block never touched), capacity (block
+   not in the shadow cache either) or conflict (block in the shadow cache),
+   it finds a block in a hash table and keeps its blocks in an LRU list,
+   so an access is O(1) at any capacity */
+struct cache_shadow_t
+{
+  int size;			/* capacity in blocks */
+  int num;			/* blocks in the shadow cache */
+  struct cache_shadow_blk_t *lru_head;/* most recently used block */
+  struct cache_shadow_blk_t *lru_tail;/* least recently used block */
+  int hsize;			/* hash table size, a power of two */
+  int nblks;			/* number of blocks touched */
+  struct cache_shadow_blk_t **hash;/* hash table of touched blocks */
+  struct cache_shadow_blk_t *free;/* free blocks, linked by HASH_NEXT */
+  struct cache_shadow_chunk_t *chunks;/* blocks allocated, see cache.c */
+};
+
+struct prefetch_t;
+struct bus_t;
+struct reuse_t;
+struct warm_t;
 
 /* cache block (or line) definition */
 struct cache_blk_t
@@ -155,6 +255,9 @@ struct cache_t
   int usize;			/* user allocated data size */
   int assoc;			/* cache associativity */
   enum cache_policy policy;	/* cache replacement policy */
+  enum cache_wpolicy wpolicy;	/* cache write policy */
+  int walloc;			/* allocate blocks on write misses? if not,
+				   write misses go around the cache */
   unsigned int hit_latency;	/* cache hit latency */
 
   /* miss/replacement handler, read/write BSIZE bytes starting at BADDR
@@ -165,7 +268,8 @@ struct cache_t
      effect the latency of later operations (e.g., write buffer fills),
      if !BALLOC, then just return the latency; BLK_ACCESS_FN is also
      responsible for generating any user data and incorporating the latency
-     of that operation */
+     of that operation; BLK is NULL for writes of blocks that are not in the
+     cache, i.e., writes around the cache and victim buffer writebacks */
   unsigned int					/* latency of block access */
     (*blk_access_fn)(enum mem_cmd cmd,		/* block access command */
 		     md_addr_t baddr,		/* program address to access */
@@ -181,6 +285,41 @@ struct cache_t
   int tag_shift;
   md_addr_t tag_mask;		/* use *after* shift */
   md_addr_t tagset_mask;	/* used for fast hit detection */
+  int extras;			/* non-zero if an optional feature (write
+				   buffer, victim buffer, MSHRs, prefetcher,
+				   reuse profiler, shadow cache, bus,
+				   no-write-allocate, hashed index or set
+				   sampling) needs work on every access */
+
+  /* set index function, see cache_set_index(), the tags of caches not
+     indexed by bits of the address are whole block addresses */
+  enum cache_index index;	/* set index function */
+  int index_shift;		/* shift of the tag bits XORed in */
+  md_addr_t index_xor;		/* tag bits XORed in, SET_MASK or 0 */
+  md_addr_t index_mask;		/* set bits of the block address, or 0 */
+  int index_prime;		/* sets used by IndexPrime, 0 if not */
+  counter_t *skew_stamp;	/* IndexSkew replacement state, when each
+				   block (in tag store order) was last used
+				   (LRU) or filled (FIFO and Random) */
+  counter_t skew_clock;		/* last SKEW_STAMP given out */
+
+  /* random replacement state, private to the cache so that its replacements
+     do not depend on other caches (possibly accessed by other host threads) */
+  unsigned int rand_state;
+
+  /* pseudo-LRU replacement state, PLRU_STRIDE bytes of bits per set, only
+     allocated for the TreePLRU and BitPLRU policies */
+  byte_t *plru;
+  int plru_stride;
+
+  /* RRIP replacement state, an RRPV per block (in tag store order), only
+     allocated for the SRRIP, BRRIP and DRRIP policies */
+  byte_t *rrpv;
+  int psel;			/* DRRIP policy selector, > RRIP_PSEL_MAX/2
+				   selects BRRIP for the follower sets */
+  int duel_stride;		/* DRRIP leader set spacing, set S is an SRRIP
+				   leader if S % DUEL_STRIDE == 0, a BRRIP
+				   leader if S % DUEL_STRIDE == 1 */
 
   /* bus resource */
   tick_t bus_free;		/* time when bus to next level of cache is
@@ -191,6 +330,74 @@ struct cache_t
  				   latency of the access to the lower level
  				   may be more than one cycle, as specified
  				   by the miss handler */
+  struct bus_t *bus;		/* interconnect to the next level (see
+				   bus.h), if set it replaces BUS_FREE, and
+				   every fill, writeback and write-through
+				   moves the block over it */
+
+  /* write buffer between a write-through cache and its next level, a FIFO
+     of WBUF_SIZE entries (none if zero), entries drain one at a time */
+  int wbuf_size;		/* number of write buffer entries */
+  struct cache_wbuf_ent_t *wbuf;/* write buffer entries */
+  int wbuf_head, wbuf_num;	/* oldest entry, number of entries */
+  tick_t wbuf_free;		/* when the last write to drain is done */
+
+  /* fully-associative victim buffer of VICTIM_SIZE entries (none if zero),
+     kept in LRU order, VICTIM[0] is the most recently inserted block, it
+     holds the blocks evicted by misses and is checked before the next level
+     is accessed, a hit swaps the buffered block with the evicted one */
+  int victim_size;		/* number of victim buffer entries */
+  int victim_num;		/* number of valid entries */
+  unsigned int victim_lat;	/* latency of a swap with the victim buffer */
+  struct cache_victim_t *victim;/* victim buffer entries */
+
+  /* miss status holding registers, MSHR_SIZE entries (unlimited if zero)
+     of MSHR_TARGETS targets each, a miss needs a free MSHR (it waits for
+     one if there is none), accesses to a block still being filled merge
+     into its MSHR as secondary misses */
+  int mshr_size;		/* number of MSHRs */
+  int mshr_targets;		/* targets per MSHR */
+  int mshr_num;			/* number of MSHRs in use */
+  struct cache_mshr_t *mshr;	/* MSHRs, the first MSHR_NUM are in use */
+  tick_t mshr_last_ready;	/* latest fill done time of any MSHR */
+  struct stat_stat_t *mshr_occ_dist;/* MSHRs in use, sampled at misses */
+
+  /* hardware prefetcher (NULL if none), trained by the demand accesses of
+     the cache, PC is the PC of the instruction making the current access,
+     set by the simulator before accessing the cache (0 if not known) */
+  struct prefetch_t *pf;
+  md_addr_t pc;
+
+  /* index in its batch of the reference being accessed by
+     cache_access_batch(), so a miss handler can tell which reference of
+     the batch missed */
+  int batch_ref;
+
+  /* 3C miss classification shadow cache, NULL if none */
+  struct cache_shadow_t *shadow;
+
+  /* reuse distance profiler of the demand accesses (see reuse.h), NULL if
+     none */
+  struct reuse_t *reuse;
+
+  /* set sampling, only 1 in SAMPLE_RATE sets is modelled, its blocks live
+     in set CACHE_SAMPLE_SET() (see cache.c) of the first SAMPLE_NSETS sets,
+     accesses to the other sets are skipped; a cache simulated in slices
+     is made of SAMPLE_SLICES caches, each modelling its own 1 in
+     SAMPLE_RATE sets, i.e., sampling 1 in SAMPLE_RATE/SAMPLE_SLICES */
+  int sample_rate;		/* 1 in SAMPLE_RATE sets modelled */
+  int sample_nsets;		/* number of sets modelled, NSETS if all */
+  md_addr_t sample_mult;	/* set index hash multiplier, 1 if all */
+  md_addr_t sample_inv;		/* its inverse, maps a modelled set back */
+  md_addr_t sample_first;	/* first hashed set index modelled */
+  int sample_slices;		/* number of slices of the cache */
+  unsigned int sample_mean_lat;	/* mean latency of the accesses modelled */
+  counter_t *sample_acc;	/* accesses to each modelled set */
+  counter_t *sample_miss;	/* misses of each modelled set */
+  double sample_acc_sq;		/* sum of SAMPLE_ACC squared */
+  double sample_miss_sq;	/* sum of SAMPLE_MISS squared */
+  double sample_acc_miss;	/* sum of SAMPLE_ACC times SAMPLE_MISS */
+  counter_t sample_lat;		/* total latency of the accesses modelled */
 
   /* per-cache stats */
   counter_t hits;		/* total number of hits */
@@ -198,20 +405,65 @@ struct cache_t
   counter_t replacements;	/* total number of replacements at misses */
   counter_t writebacks;		/* total number of writebacks at misses */
   counter_t invalidations;	/* total number of external invalidations */
+  counter_t write_arounds;	/* write misses not allocated in the cache */
+  counter_t rrip_distant_fills;	/* RRIP fills inserted at RRIP_MAX */
+  counter_t sdm_srrip_misses;	/* DRRIP misses in SRRIP leader sets */
+  counter_t sdm_brrip_misses;	/* DRRIP misses in BRRIP leader sets */
+  counter_t follower_brrip_fills;/* DRRIP follower set fills using BRRIP */
+  counter_t wbuf_writes;	/* writes into the write buffer */
+  counter_t wbuf_coalesced;	/* writes combined with a buffered write */
+  counter_t wbuf_drains;	/* writes drained to the next level */
+  counter_t wbuf_full_stalls;	/* writes stalled by a full write buffer */
+  counter_t wbuf_stall_cycles;	/* cycles stalled by a full write buffer */
+  counter_t victim_hits;	/* misses that hit in the victim buffer */
+  counter_t victim_misses;	/* misses that missed in the victim buffer */
+  counter_t mshr_allocs;	/* misses allocating an MSHR */
+  counter_t mshr_merges;	/* secondary misses merged into an MSHR */
+  counter_t mshr_full_stalls;	/* misses waiting for a free MSHR */
+  counter_t mshr_stall_cycles;	/* cycles waiting for a free MSHR */
+  counter_t mshr_busy_cycles;	/* sum of MSHR occupancy over all cycles */
+  counter_t mshr_miss_cycles;	/* cycles with at least one MSHR in use */
+  counter_t pf_issued;		/* prefetch fills */
+  counter_t pf_useful;		/* prefetched blocks used by a demand access */
+  counter_t pf_late;		/* prefetched blocks used before they arrived */
+  counter_t pf_useless;		/* prefetched blocks evicted before use */
+  counter_t compulsory_misses;	/* misses to blocks never touched */
+  counter_t capacity_misses;	/* misses the shadow cache misses too */
+  counter_t conflict_misses;	/* misses that hit in the shadow cache */
+  counter_t sample_skips;	/* accesses to sets not modelled */
 
   /* last block to hit, used to optimize cache hit processing */
   md_addr_t last_tagset;	/* tag of last line accessed */
   struct cache_blk_t *last_blk;	/* cache block last accessed */
+  md_addr_t last_set;		/* set of the block last accessed */
+
+  /* tag store, ASSOC tags per set in block order, CACHE_TAG_INVALID for
+     invalid blocks, tags are a shifted address so can never be all ones,
+     NOTE: the tag store, not CACHE_BLK_VALID, says which blocks are valid,
+     cache_flush() invalidates the whole cache by resetting it, leaving the
+     status of the blocks stale */
+  md_addr_t *tags;
+
+  /* flush state, a bit per set marks the sets that may hold dirty blocks,
+     so cache_flush() only visits them */
+  unsigned int *dirty_sets;	/* SAMPLE_NSETS bits, set when a block is
+				   dirtied */
+  int valid_blks;		/* number of valid blocks */
+  int pf_pending;		/* valid prefetched blocks not yet used */
 
   /* data blocks */
   byte_t *data;			/* pointer to data blocks allocation */
 
   /* NOTE: this is a variable-size tail array, this must be the LAST field
      defined in this structure! */
-  struct cache_set_t sets[1];	/* each entry is a set */
+  struct cache_set_t sets[1];	/* each entry is a modelled set */
 };
 
-/* create and initialize a general cache structure */
+/* create and initialize a general cache structure, with a SAMPLE of N > 1
+   only 1 in N sets (a power of two) are modelled, chosen by a hash of the
+   set index, accesses to the other sets are skipped and only counted, the
+   miss rate of the modelled sets then estimates that of the cache, with a
+   confidence interval from the spread of the miss rates of the sets */
 struct cache_t *			/* pointer to cache created */
 cache_create(char *name,		/* name of the cache */
 	     int nsets,			/* total number of sets in cache */
@@ -220,17 +472,124 @@ cache_create(char *name,		/* name of the cache */
 	     int usize,			/* size of user data to alloc w/blks */
 	     int assoc,			/* associativity of cache */
 	     enum cache_policy policy,	/* replacement policy w/in sets */
+	     enum cache_wpolicy wpolicy,/* write-back or write-through */
 	     /* block access function, see description w/in struct cache def */
 	     unsigned int (*blk_access_fn)(enum mem_cmd cmd,
 					   md_addr_t baddr, int bsize,
 					   struct cache_blk_t *blk,
 					   tick_t now),
-	     unsigned int hit_latency);/* latency in cycles for a hit */
+	     unsigned int hit_latency,/* latency in cycles for a hit */
+	     int sample);		/* model 1 in SAMPLE sets, 1 for all */
+
+/* give write-through cache CP a coalescing write buffer of NENTRIES blocks,
+   writes to a block already buffered (and not yet draining) combine with
+   it, the writer only sees the latency of waiting for a full buffer */
+void
+cache_set_wbuf(struct cache_t *cp,	/* cache instance */
+	       int nentries);		/* write buffer entries, 0 for none */
+
+/* attach a fully-associative victim buffer of NENTRIES blocks to cache CP,
+   blocks evicted by misses are kept in it, a miss that finds its block there
+   swaps it back into the cache in SWAP_LAT cycles, without a next level
+   access */
+void
+cache_set_victim(struct cache_t *cp,	/* cache instance */
+		 int nentries,		/* victim buffer entries, 0 for none */
+		 unsigned int swap_lat);/* latency of a victim buffer hit */
+
+/* limit cache CP to NENTRIES outstanding misses (miss status holding
+   registers) of up to NTARGETS accesses each, 0 entries for no limit */
+void
+cache_set_mshr(struct cache_t *cp,	/* cache instance */
+	       int nentries,		/* number of MSHRs, 0 for unlimited */
+	       int ntargets);		/* accesses merged per MSHR */
+
+/* return non-zero if an access to ADDR of cache CP at NOW would find an MSHR
+   (or an MSHR target, if the block is being filled) when it misses, i.e.,
+   if the access can be made without waiting for the MSHRs */
+int					/* non-zero if access will not wait */
+cache_mshr_avail(struct cache_t *cp,	/* cache instance */
+		 md_addr_t addr,	/* address of access */
+		 tick_t now);		/* time of access */
+
+/* connect cache CP to its next level through BUS (see bus.h), NULL for the
+   default single-port BUS_FREE model, a bus may be shared by caches */
+void
+cache_set_bus(struct cache_t *cp,	/* cache instance */
+	      struct bus_t *bus);	/* interconnect, or NULL */
+
+/* attach prefetcher PF (see prefetch.h) to cache CP, NULL for none */
+void
+cache_set_prefetch(struct cache_t *cp,	/* cache instance */
+		   struct prefetch_t *pf);/* prefetcher, or NULL */
+
+/* prefetch the block containing ADDR into cache CP at NOW, the block is
+   filled like a miss and marked as prefetched, returns FALSE if the block
+   was already in the cache */
+int					/* non-zero if prefetch issued */
+cache_prefetch(struct cache_t *cp,	/* cache to prefetch into */
+	       md_addr_t addr,		/* address of block to prefetch */
+	       tick_t now);		/* time of prefetch */
+
+/* set the write miss policy of cache CP, with WALLOC write misses fetch and
+   allocate the block (the default), without it write misses are sent to the
+   next level (or the write buffer) and leave the cache untouched */
+void
+cache_set_walloc(struct cache_t *cp,	/* cache instance */
+		 int walloc);		/* allocate blocks on write misses? */
+
+/* classify the misses of cache CP as compulsory, capacity or conflict
+   misses, with a fully-associative LRU shadow cache of the same capacity
+   that sees the same demand accesses, a flush of CP also empties the
+   shadow cache but not its record of the blocks touched, so misses after
+   a flush count as capacity misses, not compulsory ones */
+void
+cache_set_classify(struct cache_t *cp,	/* cache instance */
+		   int classify);	/* classify the misses? */
+
+/* index the sets of cache CP with index function INDEX, hashed indexes
+   spread the power of two strides that map to few sets of a bit selected
+   index, a skewed-associative cache looks up each way in a set of its
+   own, and needs LRU, FIFO or random replacement, must be called before
+   the cache is accessed */
+void
+cache_set_index(struct cache_t *cp,	/* cache instance */
+		enum cache_index index);/* set index function */
+
+/* make cache CP, created to model 1 in N sets, slice SLICE of NSLICES
+   slices of its sets, the slices of a cache model disjoint sets, so they
+   can be simulated apart, e.g., by separate host threads, must be called
+   before the cache is accessed */
+void
+cache_set_slice(struct cache_t *cp,	/* cache instance */
+		int slice,		/* slice of the sets modelled */
+		int nslices);		/* number of slices, must divide N */
+
+/* set the stats of cache CP, simulated in NSLICES slices SLICES, to the
+   totals of the slices */
+void
+cache_merge_slices(struct cache_t *cp,	/* cache instance, not accessed */
+		   struct cache_t **slices,/* slices of the cache */
+		   int nslices);	/* number of slices */
+
+/* attach reuse distance profiler R (see reuse.h) to cache CP, NULL for
+   none */
+void
+cache_set_reuse(struct cache_t *cp,	/* cache instance */
+		struct reuse_t *r);	/* reuse profiler, or NULL */
 
 /* parse policy */
 enum cache_policy			/* replacement policy enum */
 cache_char2policy(char c);		/* replacement policy as a char */
 
+/* parse set index function */
+enum cache_index			/* set index function enum */
+cache_char2index(char c);		/* set index function as a char */
+
+/* parse write policy */
+enum cache_wpolicy			/* write policy enum */
+cache_str2wpolicy(char *s);		/* write policy string, "wb" or "wt" */
+
 /* print cache configuration */
 void
 cache_config(struct cache_t *cp,	/* cache instance */
@@ -264,6 +623,30 @@ cache_access(struct cache_t *cp,	/* cache to access */
 	     byte_t **udata,		/* for return of user data ptr */
 	     md_addr_t *repl_addr);	/* for address of replaced block */
 
+/* a reference of a batch of cache accesses */
+struct cache_ref_t
+{
+  md_addr_t addr;		/* address of access */
+  md_addr_t pc;			/* PC of the access, see CP->PC */
+  enum mem_cmd cmd;		/* access type, Read or Write */
+  int nbytes;			/* number of bytes to access */
+};
+
+/* access cache CP with the NREFS references REFS, in order, all initiated
+   at NOW, the latency of each access is returned in LATS (if non-NULL);
+   the results are those of setting CP->PC and calling cache_access() for
+   each reference without data or user data, but without a call per
+   reference, CP->BATCH_REF is the index of the reference accessed; the
+   batch is a plain loop over the references, the tags and sets are not
+   decoded ahead of the lookups nor their sets prefetched, both made trace
+   replay slower, even with 4MB L1 caches */
+void
+cache_access_batch(struct cache_t *cp,	/* cache to access */
+		   struct cache_ref_t *refs,/* references to access */
+		   int nrefs,		/* number of references */
+		   tick_t now,		/* time of accesses */
+		   unsigned int *lats);	/* latencies of accesses, or NULL */
+
 /* cache access functions, these are safe, they check alignment and
    permissions */
 #define cache_double(cp, cmd, addr, p, now, udata)	\
@@ -298,4 +681,20 @@ cache_flush_addr(struct cache_t *cp,	/* cache instance to flush */
 		 md_addr_t addr,	/* address of block to flush */
 		 tick_t now);		/* time of cache flush */
 
+/* save the blocks and replacement state of cache CP, i.e., its warm state,
+   in a section of warm state file W (see warm.h) named after the cache,
+   accesses in progress, write buffers, MSHRs, prefetcher training and the
+   -cache:classify and -cache:reuse profilers are not saved */
+void
+cache_save(struct cache_t *cp,		/* cache instance */
+	   struct warm_t *w);		/* warm state file to write */
+
+/* restore the blocks and replacement state of cache CP from the current
+   section of warm state file W, the cache must be organized like the one
+   saved, including the size of its victim buffer (a mismatch is fatal),
+   and not accessed yet */
+void
+cache_restore(struct cache_t *cp,	/* cache instance */
+	      struct warm_t *w);	/* warm state file to read */
+
 #endif /* CACHE_H */
@@ -0,0 +1,261 @@
+/* dram.c - banked DRAM main memory model routines */
+
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+#include "dram.h"
+
+/* row buffer policy names, indexed by enum dram_policy */
+static char *policy_names[] = { "open", "closed" };
+
+/* create a DRAM, all sizes must be powers of two */
+struct dram_t *				/* DRAM created */
+dram_create(int channels,		/* number of channels */
+	    int ranks,			/* ranks per channel */
+	    int banks,			/* banks per rank */
+	    int row_size,		/* row buffer size, in bytes */
+	    enum dram_policy policy,	/* row buffer policy */
+	    int tRCD,			/* row activate time */
+	    int tCAS,			/* column access time */
+	    int tRP,			/* row precharge time */
+	    int bus_width,		/* data bus width, in bytes */
+	    int tburst)			/* cycles per bus width transferred */
+{
+  struct dram_t *dram;
+
+  if (channels <= 0 || (channels & (channels-1)) != 0)
+    fatal("DRAM channels `%d' must be non-zero and a power of two",
+	  channels);
+  if (ranks <= 0 || (ranks & (ranks-1)) != 0)
+    fatal("DRAM ranks `%d' must be non-zero and a power of two", ranks);
+  if (banks <= 0 || (banks & (banks-1)) != 0)
+    fatal("DRAM banks `%d' must be non-zero and a power of two", banks);
+  if (row_size <= 0 || (row_size & (row_size-1)) != 0)
+    fatal("DRAM row size `%d' must be non-zero and a power of two",
+	  row_size);
+  if (tRCD < 0 || tCAS < 0 || tRP < 0)
+    fatal("DRAM timings must be non-negative");
+  if (tCAS + tburst < 1)
+    fatal("DRAM accesses must take at least one cycle");
+  if (bus_width <= 0 || tburst < 0)
+    fatal("bad DRAM bus width or burst time");
+
+  dram = (struct dram_t *)calloc(1, sizeof(struct dram_t));
+  if (!dram)
+    fatal("out of virtual memory");
+
+  dram->channels = channels;
+  dram->ranks = ranks;
+  dram->banks = banks;
+  dram->row_size = row_size;
+  dram->policy = policy;
+  dram->tRCD = tRCD;
+  dram->tCAS = tCAS;
+  dram->tRP = tRP;
+  dram->bus_width = bus_width;
+  dram->tburst = tburst;
+
+  /* | row | rank | bank | channel | column | */
+  dram->col_shift = log_base2(row_size);
+  dram->chan_shift = dram->col_shift;
+  dram->chan_mask = channels - 1;
+  dram->bank_shift = dram->chan_shift + log_base2(channels);
+  dram->bank_mask = banks - 1;
+  dram->rank_shift = dram->bank_shift + log_base2(banks);
+  dram->rank_mask = ranks - 1;
+  dram->row_shift = dram->rank_shift + log_base2(ranks);
+
+  dram->bank = (struct dram_bank_t *)
+    calloc(channels * ranks * banks, sizeof(struct dram_bank_t));
+  dram->bus_ready = (tick_t *)calloc(channels, sizeof(tick_t));
+  if (!dram->bank || !dram->bus_ready)
+    fatal("out of virtual memory");
+
+  return dram;
+}
+
+/* parse row buffer policy name POLICY, open or closed */
+enum dram_policy
+dram_parse_policy(char *policy)
+{
+  if (!mystricmp(policy, "open"))
+    return dram_open;
+  else if (!mystricmp(policy, "closed"))
+    return dram_closed;
+
+  fatal("bogus DRAM row buffer policy `%s', use open or closed", policy);
+  return dram_open;
+}
+
+/* print DRAM configuration */
+void
+dram_config(struct dram_t *dram,	/* DRAM instance */
+	    FILE *stream)		/* output stream */
+{
+  fprintf(stream,
+	  "dram: %d channel(s) x %d rank(s) x %d bank(s), %d-byte rows, "
+	  "%s-page policy\n",
+	  dram->channels, dram->ranks, dram->banks, dram->row_size,
+	  policy_names[dram->policy]);
+  fprintf(stream,
+	  "dram: tRCD %d, tCAS %d, tRP %d, %d-byte bus, %d cycle(s)/transfer\n",
+	  dram->tRCD, dram->tCAS, dram->tRP, dram->bus_width, dram->tburst);
+}
+
+/* register DRAM stats */
+void
+dram_reg_stats(struct dram_t *dram,	/* DRAM instance */
+	       struct stat_sdb_t *sdb)	/* stats database */
+{
+  stat_reg_counter(sdb, "dram.reads", "total number of DRAM reads",
+		   &dram->reads, 0, NULL);
+  stat_reg_counter(sdb, "dram.writes", "total number of DRAM writes",
+		   &dram->writes, 0, NULL);
+  stat_reg_counter(sdb, "dram.row_hits",
+		   "total number of accesses to an open row",
+		   &dram->row_hits, 0, NULL);
+  stat_reg_counter(sdb, "dram.row_empties",
+		   "total number of accesses to a precharged bank",
+		   &dram->row_empties, 0, NULL);
+  stat_reg_counter(sdb, "dram.row_conflicts",
+		   "total number of accesses to a bank with another row open",
+		   &dram->row_conflicts, 0, NULL);
+  stat_reg_formula(sdb, "dram.row_hit_rate", "row buffer hit rate",
+		   "dram.row_hits / (dram.reads + dram.writes)", NULL);
+  stat_reg_counter(sdb, "dram.bytes", "total number of bytes transferred",
+		   &dram->bytes, 0, NULL);
+  stat_reg_counter(sdb, "dram.bus_cycles",
+		   "total number of cycles the data buses were busy",
+		   &dram->bus_cycles, 0, NULL);
+  stat_reg_counter(sdb, "dram.read_lat", "total latency of DRAM reads",
+		   &dram->read_lat, 0, NULL);
+  stat_reg_formula(sdb, "dram.avg_read_lat", "average DRAM read latency",
+		   "dram.read_lat / dram.reads", NULL);
+}
+
+/* access NBYTES at ADDR in DRAM at time NOW, returns the latency of the
+   access */
+unsigned int				/* latency of access in cycles */
+dram_access(struct dram_t *dram,	/* DRAM to access */
+	    enum mem_cmd cmd,		/* Read or Write */
+	    md_addr_t addr,		/* address of access */
+	    int nbytes,			/* number of bytes accessed */
+	    tick_t now)			/* time of access */
+{
+  int chan = (addr >> dram->chan_shift) & dram->chan_mask;
+  int bank = (addr >> dram->bank_shift) & dram->bank_mask;
+  int rank = (addr >> dram->rank_shift) & dram->rank_mask;
+  md_addr_t row = addr >> dram->row_shift;
+  struct dram_bank_t *bp =
+    &dram->bank[(chan * dram->ranks + rank) * dram->banks + bank];
+  int chunks = (nbytes + (dram->bus_width - 1)) / dram->bus_width;
+  tick_t when, done;
+
+  if (chunks < 1)
+    chunks = 1;
+
+  if (bp->open && bp->row == row)
+    {
+      /* row hit, first-ready: go as soon as the row is open */
+      dram->row_hits++;
+      when = MAX(now, bp->row_ready);
+    }
+  else
+    {
+      /* row miss, wait for the bank to go idle, then open the row */
+      when = MAX(now, bp->ready);
+      if (bp->open)
+	{
+	  dram->row_conflicts++;
+	  when += dram->tRP;
+	}
+      else
+	dram->row_empties++;
+      when += dram->tRCD;
+
+      bp->open = TRUE;
+      bp->row = row;
+      bp->row_ready = when;
+    }
+
+  /* column access, then queue for the channel's data bus */
+  when += dram->tCAS;
+  when = MAX(when, dram->bus_ready[chan]);
+  done = when + chunks * dram->tburst;
+  dram->bus_ready[chan] = done;
+  dram->bus_cycles += chunks * dram->tburst;
+  bp->ready = MAX(bp->ready, done);
+
+  if (dram->policy == dram_closed)
+    {
+      /* auto-precharge, the bank is idle once the precharge completes */
+      bp->open = FALSE;
+      bp->ready += dram->tRP;
+    }
+
+  dram->bytes += nbytes;
+  if (cmd == Read)
+    {
+      dram->reads++;
+      dram->read_lat += done - now;
+    }
+  else
+    dram->writes++;
+
+  return (unsigned int)(done - now);
+}
@@ -0,0 +1,178 @@
+/* dram.h - banked DRAM main memory model interfaces */
+
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+
+/*
+ * The DRAM model replaces the fixed main memory latency with a memory made
+ * of CHANNELS independent channels, each with RANKS ranks of BANKS banks.
+ * Every bank has a row buffer holding one ROW_SIZE-byte row; an access to
+ * the open row (a row hit) only pays the column access time (tCAS), an
+ * access to a bank with no open row first activates the row (tRCD), and an
+ * access to a different row (a row conflict) must also precharge the bank
+ * (tRP) first.  Consecutive ROW_SIZE-byte chunks of the address space are
+ * interleaved across channels, then banks, then ranks:
+ *
+ *	| row | rank | bank | channel | column |
+ *
+ * Under the open-page policy rows are left open after an access, under the
+ * closed-page policy every access precharges its bank when done, so all
+ * accesses see an idle bank and no access ever pays tRP up front.
+ *
+ * Requests are scheduled when they are made, a request's latency cannot
+ * depend on requests made after it.  The FR-FCFS (first-ready, first-come
+ * first-served) scheduler is approximated by letting row hits issue as soon
+ * as their row is open, ahead of the earlier requests still transferring
+ * from the bank, while row misses wait for the bank to go idle.  All
+ * requests then queue in arrival order for their channel's data bus, where
+ * each BUS_WIDTH-byte chunk takes TBURST cycles.  Writes occupy banks and
+ * buses like reads.  All timings are in processor cycles.
+ */
+
+/* row buffer management policies */
+enum dram_policy {
+  dram_open,			/* leave rows open after an access */
+  dram_closed			/* precharge banks after every access */
+};
+
+/* DRAM bank state */
+struct dram_bank_t
+{
+  int open;			/* is a row open? */
+  md_addr_t row;		/* row open in the row buffer */
+  tick_t row_ready;		/* time the open row can be accessed */
+  tick_t ready;			/* time the bank goes idle */
+};
+
+/* DRAM definition */
+struct dram_t
+{
+  /* parameters */
+  int channels;			/* number of independent channels */
+  int ranks;			/* ranks per channel */
+  int banks;			/* banks per rank */
+  int row_size;			/* row buffer size, in bytes */
+  enum dram_policy policy;	/* row buffer management policy */
+  int tRCD;			/* row activate to column access time */
+  int tCAS;			/* column access to first data time */
+  int tRP;			/* row precharge time */
+  int bus_width;		/* channel data bus width, in bytes */
+  int tburst;			/* cycles to transfer one bus width */
+
+  /* address decoding */
+  int col_shift;
+  int chan_shift, chan_mask;
+  int bank_shift, bank_mask;
+  int rank_shift, rank_mask;
+  int row_shift;
+
+  /* state */
+  struct dram_bank_t *bank;	/* channels*ranks*banks banks */
+  tick_t *bus_ready;		/* time each channel's data bus goes idle */
+
+  /* stats */
+  counter_t reads;		/* total number of read requests */
+  counter_t writes;		/* total number of write requests */
+  counter_t row_hits;		/* requests to an open row */
+  counter_t row_empties;	/* requests to a bank with no open row */
+  counter_t row_conflicts;	/* requests to a bank with another row open */
+  counter_t bytes;		/* total bytes transferred */
+  counter_t read_lat;		/* total latency of read requests */
+  counter_t bus_cycles;		/* total cycles the data buses were busy */
+};
+
+/* create a DRAM, all sizes must be powers of two */
+struct dram_t *				/* DRAM created */
+dram_create(int channels,		/* number of channels */
+	    int ranks,			/* ranks per channel */
+	    int banks,			/* banks per rank */
+	    int row_size,		/* row buffer size, in bytes */
+	    enum dram_policy policy,	/* row buffer policy */
+	    int tRCD,			/* row activate time */
+	    int tCAS,			/* column access time */
+	    int tRP,			/* row precharge time */
+	    int bus_width,		/* data bus width, in bytes */
+	    int tburst);		/* cycles per bus width transferred */
+
+/* parse row buffer policy name POLICY, open or closed */
+enum dram_policy
+dram_parse_policy(char *policy);
+
+/* print DRAM configuration */
+void
+dram_config(struct dram_t *dram,	/* DRAM instance */
+	    FILE *stream);		/* output stream */
+
+/* register DRAM stats */
+void
+dram_reg_stats(struct dram_t *dram,	/* DRAM instance */
+	       struct stat_sdb_t *sdb);	/* stats database */
+
+/* access NBYTES at ADDR in DRAM at time NOW, returns the latency of the
+   access, assumed to not cross a row boundary */
+unsigned int				/* latency of access in cycles */
+dram_access(struct dram_t *dram,	/* DRAM to access */
+	    enum mem_cmd cmd,		/* Read or Write */
+	    md_addr_t addr,		/* address of access */
+	    int nbytes,			/* number of bytes accessed */
+	    tick_t now);		/* time of access */
+
+#endif /* DRAM_H */
@@ -51,8 +51,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <math.h>
 
 #include "host.h"
 #include "misc.h"
@@ -795,6 +797,25 @@ f_neg(struct eval_value_t val1)
   return val;
 }
 
+/* compute sqrt(<val1>), in double precision, negative values (e.g., the
+   round-off of a zero variance) have a zero root */
+static struct eval_value_t
+f_sqrt(struct eval_value_t val1)
+{
+  struct eval_value_t val;
+
+  /* symbols are not allowed in arithmetic expressions */
+  if (val1.type == et_symbol)
+    {
+      eval_error = ERR_BADEXPR;
+      return err_value;
+    }
+
+  val.type = et_double;
+  val.value.as_double = sqrt(MAX(eval_as_double(val1), 0.0));
+  return val;
+}
+
 /* compute val1 == 0 */
 static int
 f_eq_zero(struct eval_value_t val1)
@@ -969,6 +990,15 @@ factor(struct eval_state_t *es)		/* expression evaluator */
 
     case tok_ident:
       (void)get_next_token(es);
+      /* sqrt <factor>, e.g., sqrt(<expr>), is the square root function */
+      if (!strcmp(es->tok_buf, "sqrt"))
+	{
+	  val = factor(es);
+	  if (eval_error)
+	    return err_value;
+	  val = f_sqrt(val);
+	  break;
+	}
       /* evaluate the identifier in TOK_BUF */
       val = es->f_eval_ident(es);
       if (eval_error)
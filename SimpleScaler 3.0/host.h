@@ -65,6 +65,15 @@
 #define INLINE
 #endif
 
+/* inline even where the compiler would rather call, for the few functions
+   on the hot path of every simulated access */
+#undef ALWAYS_INLINE
+#if defined(__GNUC__)
+#define ALWAYS_INLINE	inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE
+#endif
+
 /* bind together two symbols, at preprocess time */
 #ifdef __GNUC__
 /* this works on all GNU GCC targets (that I've seen...) */
@@ -0,0 +1,290 @@
+/* prefetch.c - hardware prefetcher routines */
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stats.h"
+#include "cache.h"
+#include "prefetch.h"
+
+/* prefetcher type names, indexed by enum prefetch_class */
+static char *pf_names[PF_NUM] = { "nextline", "stride", "stream" };
+
+/* create a prefetcher of type CLASS that fills cache CP */
+struct prefetch_t *			/* prefetcher created */
+prefetch_create(enum prefetch_class class,/* type of prefetcher */
+		struct cache_t *cp,	/* cache to prefetch into */
+		int degree,		/* prefetches per trigger */
+		int distance)		/* strides ahead of the trigger */
+{
+  struct prefetch_t *pf;
+
+  if (degree <= 0)
+    fatal("prefetch degree `%d' must be non-zero and positive", degree);
+  if (distance <= 0)
+    fatal("prefetch distance `%d' must be non-zero and positive", distance);
+
+  pf = (struct prefetch_t *)calloc(1, sizeof(struct prefetch_t));
+  if (!pf)
+    fatal("out of virtual memory");
+
+  pf->class = class;
+  pf->cp = cp;
+  pf->degree = degree;
+  pf->distance = distance;
+
+  switch (class)
+    {
+    case PF_NextLine:
+      break;
+
+    case PF_Stride:
+      pf->stride = (struct prefetch_stride_t *)
+	calloc(PF_STRIDE_SIZE, sizeof(struct prefetch_stride_t));
+      if (!pf->stride)
+	fatal("out of virtual memory");
+      break;
+
+    case PF_Stream:
+      pf->streams = (struct prefetch_stream_t *)
+	calloc(PF_STREAMS, sizeof(struct prefetch_stream_t));
+      if (!pf->streams)
+	fatal("out of virtual memory");
+      break;
+
+    default:
+      panic("bogus prefetcher class");
+    }
+
+  return pf;
+}
+
+/* parse prefetcher config PF and create the prefetcher for cache CP */
+struct prefetch_t *			/* prefetcher created */
+prefetch_parse(char *pf,		/* prefetcher config */
+	       struct cache_t *cp)	/* cache to prefetch into */
+{
+  char name[128];
+  int i, n, degree = 1, distance = 1;
+
+  if (!mystricmp(pf, "none"))
+    return NULL;
+
+  n = sscanf(pf, "%127[^:]:%d:%d", name, &degree, &distance);
+  if (n < 1)
+    fatal("bad prefetcher config `%s', use <type>[:<degree>[:<distance>]]",
+	  pf);
+
+  for (i=0; i<PF_NUM; i++)
+    if (!mystricmp(name, pf_names[i]))
+      return prefetch_create((enum prefetch_class)i, cp, degree, distance);
+
+  fatal("bogus prefetcher type `%s', use nextline, stride or stream", name);
+  return NULL;
+}
+
+/* print prefetcher configuration */
+void
+prefetch_config(struct prefetch_t *pf,	/* prefetcher instance */
+		FILE *stream)		/* output stream */
+{
+  fprintf(stream, "prefetch: %s: %s prefetcher, degree %d, distance %d\n",
+	  pf->cp->name, pf_names[pf->class], pf->degree, pf->distance);
+}
+
+/* register prefetcher stats */
+void
+prefetch_reg_stats(struct prefetch_t *pf,/* prefetcher instance */
+		   char *name,		/* cache name */
+		   struct stat_sdb_t *sdb)/* stats database */
+{
+  char buf[512];
+
+  sprintf(buf, "%s.pf_triggers", name);
+  stat_reg_counter(sdb, buf, "total number of accesses triggering prefetches",
+		   &pf->triggers, 0, NULL);
+  sprintf(buf, "%s.pf_requests", name);
+  stat_reg_counter(sdb, buf, "total number of prefetches requested",
+		   &pf->requests, 0, NULL);
+}
+
+/* request DEGREE prefetches along STRIDE from ADDR, starting DISTANCE
+   strides ahead */
+static void
+prefetch_issue(struct prefetch_t *pf,	/* prefetcher instance */
+	       md_addr_t addr,		/* triggering address */
+	       int stride,		/* stride in bytes */
+	       tick_t now)		/* time of access */
+{
+  int i;
+
+  pf->triggers++;
+  for (i=0; i<pf->degree; i++)
+    {
+      pf->requests++;
+      cache_prefetch(pf->cp, addr + (md_addr_t)(stride * (pf->distance + i)),
+		     now);
+    }
+}
+
+/* train prefetcher PF with a demand access to ADDR, issue any prefetches */
+void
+prefetch_access(struct prefetch_t *pf,	/* prefetcher instance */
+		md_addr_t pc,		/* PC of instruction accessing */
+		md_addr_t addr,		/* address accessed */
+		int miss,		/* access missed? */
+		int pfhit,		/* access hit a prefetched block? */
+		tick_t now)		/* time of access */
+{
+  int bsize = pf->cp->bsize;
+  md_addr_t baddr = addr & ~(md_addr_t)(bsize - 1);
+  struct prefetch_stride_t *ent;
+  struct prefetch_stream_t *s, *lru;
+  int i, stride, dir;
+
+  switch (pf->class)
+    {
+    case PF_NextLine:
+      /* tagged, a use of a prefetched block triggers the next prefetch */
+      if (miss || pfhit)
+	prefetch_issue(pf, baddr, bsize, now);
+      break;
+
+    case PF_Stride:
+      ent = &pf->stride[(pc / sizeof(md_inst_t)) % PF_STRIDE_SIZE];
+      if (ent->pc != pc)
+	{
+	  /* new load/store, start tracking it */
+	  ent->pc = pc;
+	  ent->addr = addr;
+	  ent->stride = 0;
+	  ent->conf = 0;
+	  break;
+	}
+
+      stride = (int)(addr - ent->addr);
+      if (stride == ent->stride)
+	{
+	  if (ent->conf < PF_STRIDE_CONF_MAX)
+	    ent->conf++;
+	}
+      else if (ent->conf > 0)
+	ent->conf--;
+      else
+	ent->stride = stride;
+      ent->addr = addr;
+
+      if (ent->conf >= PF_STRIDE_CONF && ent->stride != 0)
+	prefetch_issue(pf, addr, ent->stride, now);
+      break;
+
+    case PF_Stream:
+      /* streams are trained by misses, and by the hits that consume the
+	 blocks they prefetched */
+      if (!miss && !pfhit)
+	break;
+
+      pf->stamp++;
+      lru = NULL;
+      for (i=0; i<PF_STREAMS; i++)
+	{
+	  s = &pf->streams[i];
+	  if (s->stamp
+	      && (baddr > s->baddr ? baddr - s->baddr : s->baddr - baddr)
+		 <= (md_addr_t)(PF_STREAM_WINDOW * bsize))
+	    break;
+	  if (!lru || s->stamp < lru->stamp)
+	    lru = s;
+	}
+
+      if (i == PF_STREAMS)
+	{
+	  /* no stream nearby, start a new one on a miss */
+	  if (miss)
+	    {
+	      lru->baddr = baddr;
+	      lru->dir = 0;
+	      lru->conf = 0;
+	      lru->stamp = pf->stamp;
+	    }
+	  break;
+	}
+
+      s->stamp = pf->stamp;
+      if (baddr == s->baddr)
+	break;
+
+      dir = baddr > s->baddr ? 1 : -1;
+      if (dir == s->dir)
+	{
+	  if (s->conf < PF_STREAM_CONF_MAX)
+	    s->conf++;
+	}
+      else
+	{
+	  s->dir = dir;
+	  s->conf = 1;
+	}
+      s->baddr = baddr;
+
+      if (s->conf >= PF_STREAM_CONF)
+	prefetch_issue(pf, baddr, s->dir * bsize, now);
+      break;
+
+    default:
+      panic("bogus prefetcher class");
+    }
+}
@@ -0,0 +1,177 @@
+/* prefetch.h - hardware prefetcher interfaces */
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stats.h"
+
+/*
+ * A prefetcher is attached to a cache (see cache_set_prefetch()) and is
+ * trained by the demand accesses of that cache.  On each access it decides
+ * which blocks to bring in ahead of their use and requests them with
+ * cache_prefetch(), which fills them like demand misses (they occupy the
+ * bus to the next level and evict blocks) and marks them as prefetched, so
+ * the cache can count useful, late and useless prefetches.
+ *
+ * Every prefetcher issues up to DEGREE prefetches per trigger, starting
+ * DISTANCE strides (blocks, for next-line and stream prefetchers) ahead of
+ * the triggering access:
+ *
+ *	NextLine	on a miss or a first hit to a prefetched block, fetch
+ *			the next block(s) (tagged next-line prefetching)
+ *	Stride		a PC-indexed table tracks the last address and stride
+ *			of each load/store, once a stride repeats, fetch along
+ *			it
+ *	Stream		misses are grouped into up to PF_STREAMS streams of
+ *			nearby blocks, once a stream moves in one direction,
+ *			fetch ahead of it
+ */
+
+struct cache_t;
+
+/* prefetcher types */
+enum prefetch_class {
+  PF_NextLine,			/* tagged next-line prefetcher */
+  PF_Stride,			/* PC-indexed stride prefetcher */
+  PF_Stream,			/* multi-stream prefetcher */
+  PF_NUM
+};
+
+/* stride prefetcher table size, and the confidence needed to prefetch */
+#define PF_STRIDE_SIZE		256
+#define PF_STRIDE_CONF		2
+#define PF_STRIDE_CONF_MAX	3
+
+/* stream prefetcher streams, the blocks a stream may move at a time, and
+   the confidence needed to prefetch */
+#define PF_STREAMS		16
+#define PF_STREAM_WINDOW	16
+#define PF_STREAM_CONF		2
+#define PF_STREAM_CONF_MAX	3
+
+/* stride prefetcher table entry */
+struct prefetch_stride_t
+{
+  md_addr_t pc;			/* PC of the load/store tracked */
+  md_addr_t addr;		/* last address accessed */
+  int stride;			/* last stride seen */
+  int conf;			/* saturating confidence in STRIDE */
+};
+
+/* stream prefetcher stream */
+struct prefetch_stream_t
+{
+  md_addr_t baddr;		/* last block accessed by the stream */
+  int dir;			/* direction, in blocks, 0 if not known */
+  int conf;			/* saturating confidence in DIR */
+  counter_t stamp;		/* time of last use, for LRU replacement */
+};
+
+/* prefetcher definition */
+struct prefetch_t
+{
+  enum prefetch_class class;	/* type of prefetcher */
+  struct cache_t *cp;		/* cache prefetched into */
+  int degree;			/* prefetches per trigger */
+  int distance;			/* strides ahead of the trigger to start */
+
+  struct prefetch_stride_t *stride;/* stride table, PF_Stride only */
+  struct prefetch_stream_t *streams;/* streams, PF_Stream only */
+  counter_t stamp;		/* stream LRU clock */
+
+  /* stats */
+  counter_t triggers;		/* accesses that triggered prefetches */
+  counter_t requests;		/* prefetches requested from the cache */
+};
+
+/* create a prefetcher of type CLASS that fills cache CP */
+struct prefetch_t *			/* prefetcher created */
+prefetch_create(enum prefetch_class class,/* type of prefetcher */
+		struct cache_t *cp,	/* cache to prefetch into */
+		int degree,		/* prefetches per trigger */
+		int distance);		/* strides ahead of the trigger */
+
+/* parse prefetcher config PF, "<type>[:<degree>[:<distance>]]" where type
+   is one of none, nextline, stride or stream, and create the prefetcher for
+   cache CP, returns NULL for none */
+struct prefetch_t *			/* prefetcher created */
+prefetch_parse(char *pf,		/* prefetcher config */
+	       struct cache_t *cp);	/* cache to prefetch into */
+
+/* print prefetcher configuration */
+void
+prefetch_config(struct prefetch_t *pf,	/* prefetcher instance */
+		FILE *stream);		/* output stream */
+
+/* register prefetcher stats, NAME is the name of the cache prefetched into */
+void
+prefetch_reg_stats(struct prefetch_t *pf,/* prefetcher instance */
+		   char *name,		/* cache name */
+		   struct stat_sdb_t *sdb);/* stats database */
+
+/* train prefetcher PF with a demand access to ADDR by the instruction at PC
+   at NOW, MISS is set if the access missed, PFHIT if it was the first hit
+   to a prefetched block; issues any prefetches triggered */
+void
+prefetch_access(struct prefetch_t *pf,	/* prefetcher instance */
+		md_addr_t pc,		/* PC of instruction accessing */
+		md_addr_t addr,		/* address accessed */
+		int miss,		/* access missed? */
+		int pfhit,		/* access hit a prefetched block? */
+		tick_t now);		/* time of access */
+
+#endif /* PREFETCH_H */
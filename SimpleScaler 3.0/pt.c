@@ -0,0 +1,403 @@
+/* pt.c - multi-level page table routines */
+
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+#include "pt.h"
+#include "warm.h"
+
+/* create a page table named NAME of LEVELS levels */
+struct pt_t *				/* page table created */
+pt_create(char *name,			/* page table name */
+	  int levels)			/* levels of tables, or 0 */
+{
+  struct pt_t *pt;
+  int vpn_bits, root_size;
+
+  pt = (struct pt_t *)calloc(1, sizeof(struct pt_t));
+  if (!pt)
+    fatal("out of virtual memory");
+
+  pt->name = mystrdup(name);
+  pt->mem = mem_create(name);
+  pt->page_shift = MD_LOG_PAGE_SIZE;
+  pt->index_bits = MD_LOG_PAGE_SIZE - log_base2(sizeof(md_addr_t));
+
+  vpn_bits = PT_VA_BITS - pt->page_shift;
+  if (levels <= 0)
+    levels = (vpn_bits + pt->index_bits - 1) / pt->index_bits;
+  if (levels > PT_MAX_LEVELS)
+    fatal("page table `%s' levels `%d' must be <= %d",
+	  name, levels, PT_MAX_LEVELS);
+  pt->levels = levels;
+
+  pt->root_bits = vpn_bits - (levels - 1) * pt->index_bits;
+  if (pt->root_bits < 1)
+    fatal("page table `%s' has too many levels, at most %d are needed",
+	  name, (vpn_bits + pt->index_bits - 1) / pt->index_bits);
+
+  /* the root table comes first, the other tables follow it */
+  root_size = (1 << pt->root_bits) * sizeof(md_addr_t);
+  pt->next_table =
+    PT_BASE + (md_addr_t)((root_size + MD_PAGE_SIZE - 1) & ~(MD_PAGE_SIZE - 1));
+  pt->tables = 1;
+
+  pt->alloc = pt_seq;
+  pt->rand_state = 1;
+  pt->last_vpn = ~(md_addr_t)0;
+
+  return pt;
+}
+
+/* set the physical page allocation policy of page table PT */
+void
+pt_set_alloc(struct pt_t *pt,		/* page table instance */
+	     enum pt_alloc_t alloc,	/* page allocation policy */
+	     int colors)		/* page colors, for pt_color */
+{
+  if (pt->frames != 0)
+    panic("page table `%s' already maps pages", pt->name);
+
+  pt->alloc = alloc;
+  switch (alloc)
+    {
+    case pt_seq:
+      break;
+    case pt_random:
+      pt->frame_used = (unsigned int *)
+	calloc((PT_PHYS_PAGES + 31) / 32, sizeof(unsigned int));
+      if (!pt->frame_used)
+	fatal("out of virtual memory");
+      break;
+    case pt_color:
+      if (colors < 1)
+	fatal("page table `%s' needs at least one page color", pt->name);
+      pt->colors = colors;
+      pt->color_next = (md_addr_t *)calloc(colors, sizeof(md_addr_t));
+      if (!pt->color_next)
+	fatal("out of virtual memory");
+      break;
+    default:
+      panic("bogus page allocation policy");
+    }
+}
+
+/* parse a page allocation policy name */
+enum pt_alloc_t				/* page allocation policy */
+pt_parse_alloc(char *str)		/* policy name */
+{
+  if (!mystricmp(str, "seq"))
+    return pt_seq;
+  else if (!mystricmp(str, "random"))
+    return pt_random;
+  else if (!mystricmp(str, "color"))
+    return pt_color;
+  else
+    fatal("bad page allocation policy `%s', use seq, random or color", str);
+}
+
+/* allocate the physical page for virtual page number VPN, returns the
+   physical page number */
+static md_addr_t			/* physical page number */
+pt_alloc_frame(struct pt_t *pt,		/* page table instance */
+	       md_addr_t vpn)		/* virtual page number */
+{
+  md_addr_t frame;
+  unsigned int x;
+  int color;
+
+  pt->frames++;
+  switch (pt->alloc)
+    {
+    case pt_seq:
+      if (pt->next_frame >= PT_PHYS_PAGES)
+	fatal("page table `%s' is out of physical pages", pt->name);
+      return pt->next_frame++;
+
+    case pt_random:
+      if (pt->frames > PT_PHYS_PAGES)
+	fatal("page table `%s' is out of physical pages", pt->name);
+
+      /* xorshift, then probe for the next free page */
+      x = pt->rand_state;
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      pt->rand_state = x;
+      for (frame = x % PT_PHYS_PAGES;
+	   pt->frame_used[frame >> 5] & (1U << (frame & 31));
+	   frame = (frame + 1) % PT_PHYS_PAGES)
+	/* used */;
+      pt->frame_used[frame >> 5] |= 1U << (frame & 31);
+      return frame;
+
+    case pt_color:
+      color = vpn % pt->colors;
+      frame = pt->color_next[color] * pt->colors + color;
+      if (frame >= PT_PHYS_PAGES)
+	fatal("page table `%s' is out of physical pages of color %d",
+	      pt->name, color);
+      pt->color_next[color]++;
+      return frame;
+
+    default:
+      panic("bogus page allocation policy");
+    }
+}
+
+/* print page table configuration */
+void
+pt_config(struct pt_t *pt,		/* page table instance */
+	  FILE *stream)			/* output stream */
+{
+  fprintf(stream,
+	  "pt: %s: %d level(s), %d-bit root index, %d-bit table index, "
+	  "%d-byte pages, ",
+	  pt->name, pt->levels, pt->root_bits, pt->index_bits,
+	  1 << pt->page_shift);
+  switch (pt->alloc)
+    {
+    case pt_seq:
+      fprintf(stream, "sequential page allocation\n");
+      break;
+    case pt_random:
+      fprintf(stream, "random page allocation\n");
+      break;
+    case pt_color:
+      fprintf(stream, "page coloring with %d colors\n", pt->colors);
+      break;
+    default:
+      panic("bogus page allocation policy");
+    }
+}
+
+/* register page table stats */
+void
+pt_reg_stats(struct pt_t *pt,		/* page table instance */
+	     struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], buf1[512];
+
+  sprintf(buf, "%s.walks", pt->name);
+  stat_reg_counter(sdb, buf, "total number of page table walks",
+		   &pt->walks, 0, NULL);
+  sprintf(buf, "%s.tables", pt->name);
+  stat_reg_counter(sdb, buf, "total number of page tables allocated",
+		   &pt->tables, pt->tables, NULL);
+  sprintf(buf, "%s.frames", pt->name);
+  stat_reg_counter(sdb, buf, "total number of physical pages mapped",
+		   &pt->frames, 0, NULL);
+  sprintf(buf, "%s.table_mem", pt->name);
+  sprintf(buf1, "%s.tables * %d / 1024", pt->name, MD_PAGE_SIZE);
+  stat_reg_formula(sdb, buf, "total size of page tables allocated",
+		   buf1, "%11.0fk");
+}
+
+/* walk the page table for virtual address VADDR, without counting the
+   walk */
+static md_addr_t			/* physical page address */
+pt_walk(struct pt_t *pt,		/* page table instance */
+	md_addr_t vaddr,		/* virtual address to translate */
+	md_addr_t *addrs)		/* PTE addresses read, or NULL */
+{
+  md_addr_t vpn = vaddr >> pt->page_shift, table = PT_BASE, pte, pte_addr;
+  int i, shift, bits;
+
+  for (i=0; i<pt->levels; i++)
+    {
+      shift = (pt->levels - 1 - i) * pt->index_bits;
+      bits = i == 0 ? pt->root_bits : pt->index_bits;
+      pte_addr = table
+	+ ((vpn >> shift) & (((md_addr_t)1 << bits) - 1)) * sizeof(md_addr_t);
+      if (addrs)
+	addrs[i] = pte_addr;
+
+      pte = 0;
+      mem_access(pt->mem, Read, pte_addr, &pte, sizeof(md_addr_t));
+      if (!(pte & PT_PTE_VALID))
+	{
+	  /* not mapped yet, allocate the next table or the page */
+	  if (i < pt->levels - 1)
+	    {
+	      pte = pt->next_table | PT_PTE_VALID;
+	      pt->next_table += MD_PAGE_SIZE;
+	      pt->tables++;
+	    }
+	  else
+	    pte = (pt_alloc_frame(pt, vpn) << pt->page_shift) | PT_PTE_VALID;
+	  mem_access(pt->mem, Write, pte_addr, &pte, sizeof(md_addr_t));
+	}
+      table = pte & ~(md_addr_t)(MD_PAGE_SIZE - 1);
+    }
+
+  return table;
+}
+
+/* walk the page table for virtual address VADDR */
+md_addr_t				/* physical page address */
+pt_translate(struct pt_t *pt,		/* page table instance */
+	     md_addr_t vaddr,		/* virtual address to translate */
+	     md_addr_t *addrs)		/* PTE addresses read, or NULL */
+{
+  pt->walks++;
+  return pt_walk(pt, vaddr, addrs);
+}
+
+/* translate virtual address VADDR for a physically indexed cache */
+md_addr_t				/* physical address */
+pt_map(struct pt_t *pt,			/* page table instance */
+       md_addr_t vaddr)			/* virtual address to translate */
+{
+  md_addr_t vpn = vaddr >> pt->page_shift;
+
+  if (vaddr >= PT_BASE && vaddr < pt->next_table)
+    return vaddr;
+
+  /* consecutive accesses mostly stay within a page */
+  if (vpn != pt->last_vpn)
+    {
+      pt->last_page = pt_walk(pt, vaddr, NULL);
+      pt->last_vpn = vpn;
+    }
+  return pt->last_page | (vaddr & (((md_addr_t)1 << pt->page_shift) - 1));
+}
+
+/* transfer the configuration of page table PT to warm state file W */
+static void
+pt_warm_config(struct pt_t *pt,		/* page table instance */
+	       struct warm_t *w)	/* warm state file */
+{
+  warm_check(w, "levels", pt->levels);
+  warm_check(w, "page size", 1 << pt->page_shift);
+  warm_check(w, "page allocation policy", (int)pt->alloc);
+  warm_check(w, "page colors", pt->colors);
+}
+
+/* save the tables and page allocation state of page table PT to warm state
+   file W */
+void
+pt_save(struct pt_t *pt,		/* page table instance */
+	struct warm_t *w)		/* warm state file to write */
+{
+  int i, npages = (int)pt->mem->page_count;
+  md_addr_t addr;
+  struct mem_pte_t *pte;
+
+  warm_begin(w, pt->name);
+  pt_warm_config(pt, w);
+
+  warm_put(w, &pt->next_table, sizeof(md_addr_t));
+  warm_put(w, &pt->next_frame, sizeof(md_addr_t));
+  if (pt->color_next)
+    warm_put(w, pt->color_next, pt->colors * sizeof(md_addr_t));
+  if (pt->frame_used)
+    warm_put(w, pt->frame_used,
+	     ((PT_PHYS_PAGES + 31) / 32) * sizeof(unsigned int));
+  warm_put(w, &pt->rand_state, sizeof(unsigned int));
+  warm_put(w, &pt->tables, sizeof(counter_t));
+  warm_put(w, &pt->frames, sizeof(counter_t));
+
+  /* the pages holding the tables */
+  warm_put(w, &npages, sizeof(int));
+  MEM_FORALL(pt->mem, i, pte)
+    {
+      addr = MEM_PTE_ADDR(pte, i);
+      warm_put(w, &addr, sizeof(md_addr_t));
+      warm_put(w, pte->page, MD_PAGE_SIZE);
+    }
+
+  warm_end(w);
+}
+
+/* restore the tables and page allocation state of page table PT from the
+   current section of warm state file W */
+void
+pt_restore(struct pt_t *pt,		/* page table instance */
+	   struct warm_t *w)		/* warm state file to read */
+{
+  int i, npages;
+  md_addr_t addr;
+  byte_t page[MD_PAGE_SIZE];
+
+  if (pt->frames != 0 || pt->mem->page_count != 0)
+    panic("page table `%s' restored after it mapped pages", pt->name);
+  pt_warm_config(pt, w);
+
+  warm_get(w, &pt->next_table, sizeof(md_addr_t));
+  warm_get(w, &pt->next_frame, sizeof(md_addr_t));
+  if (pt->color_next)
+    warm_get(w, pt->color_next, pt->colors * sizeof(md_addr_t));
+  if (pt->frame_used)
+    warm_get(w, pt->frame_used,
+	     ((PT_PHYS_PAGES + 31) / 32) * sizeof(unsigned int));
+  warm_get(w, &pt->rand_state, sizeof(unsigned int));
+  warm_get(w, &pt->tables, sizeof(counter_t));
+  warm_get(w, &pt->frames, sizeof(counter_t));
+
+  warm_get(w, &npages, sizeof(int));
+  for (i=0; i<npages; i++)
+    {
+      warm_get(w, &addr, sizeof(md_addr_t));
+      warm_get(w, page, MD_PAGE_SIZE);
+      if (mem_access(pt->mem, Write, addr, page, MD_PAGE_SIZE)
+	  != md_fault_none)
+	fatal("warm state of `%s' in `%s' is corrupted", pt->name, w->fname);
+    }
+
+  pt->last_vpn = ~(md_addr_t)0;
+}
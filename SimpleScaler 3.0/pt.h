@@ -0,0 +1,198 @@
+/* pt.h - multi-level page table interfaces */
+
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#ifndef PT_H
+#define PT_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+
+struct warm_t;
+
+/*
+ * The page table gives the TLBs a real translation to look up on a miss.
+ * It is a radix tree of LEVELS levels kept in the pages of its own memory
+ * space (a mem_t), starting at PT_BASE, so the page walker can read every
+ * page table entry (PTE) it visits through the simulated caches.  Each
+ * table is one page of sizeof(md_addr_t)-byte PTEs, except the root,
+ * which is indexed by whatever virtual page number bits the lower levels
+ * leave over.  A PTE holds the page address of the next level table, or
+ * of the physical page at the last level, or'ed with PT_PTE_VALID.
+ *
+ * Tables and physical pages are allocated the first time a walk needs
+ * them.  Physical pages are chosen by the page allocation policy:
+ *
+ *   pt_seq	- pages are numbered in order of first touch
+ *   pt_random	- pages are drawn at random from the PT_PHYS_PAGES pages
+ *		  below PT_BASE (from a private generator, so the random
+ *		  streams of the simulator are not disturbed)
+ *   pt_color	- page coloring, with COLORS page colors, i.e., groups of
+ *		  page-sized sets of a physically indexed cache, a virtual
+ *		  page gets the next free physical page of its own color
+ *		  (VPN % COLORS), so pages contiguous in the virtual address
+ *		  space never conflict in the cache
+ *
+ * pt_map() gives physically indexed caches the same translation the TLBs
+ * see, without counting page table walks.
+ */
+
+/* virtual address bits translated by the page table */
+#define PT_VA_BITS		MIN(8*(int)sizeof(md_addr_t), 48)
+
+/* maximum page table levels */
+#define PT_MAX_LEVELS		8
+
+/* page table base address, outside of the program's address space, so
+   page walk accesses do not alias program data in the caches */
+#define PT_BASE			((md_addr_t)0xc0000000)
+
+/* PTE valid bit */
+#define PT_PTE_VALID		((md_addr_t)1)
+
+/* physical pages available to the page allocation policies */
+#define PT_PHYS_PAGES		(PT_BASE >> MD_LOG_PAGE_SIZE)
+
+/* physical page allocation policies */
+enum pt_alloc_t {
+  pt_seq,			/* in order of first touch */
+  pt_random,			/* random physical pages */
+  pt_color			/* page coloring */
+};
+
+/* page table definition */
+struct pt_t
+{
+  char *name;			/* page table name */
+  struct mem_t *mem;		/* memory holding the tables */
+  int levels;			/* levels of tables */
+  int page_shift;		/* log2 of the page size */
+  int index_bits;		/* VPN bits indexing a non-root table */
+  int root_bits;		/* VPN bits indexing the root table */
+  md_addr_t next_table;		/* address of the next table allocated */
+  md_addr_t next_frame;		/* next physical page number allocated */
+  enum pt_alloc_t alloc;	/* physical page allocation policy */
+  int colors;			/* page colors, for pt_color */
+  md_addr_t *color_next;	/* next page number of each color, pt_color */
+  unsigned int *frame_used;	/* bit per physical page, for pt_random */
+  unsigned int rand_state;	/* private random state, for pt_random */
+  md_addr_t last_vpn;		/* last VPN translated by pt_map(), or ~0 */
+  md_addr_t last_page;		/* its physical page address */
+
+  /* stats */
+  counter_t walks;		/* total number of translations walked */
+  counter_t tables;		/* total number of tables allocated */
+  counter_t frames;		/* total number of physical pages mapped */
+};
+
+/* create a page table named NAME of LEVELS levels (0 for as many as
+   PT_VA_BITS needs) */
+struct pt_t *				/* page table created */
+pt_create(char *name,			/* page table name */
+	  int levels);			/* levels of tables, or 0 */
+
+/* set the physical page allocation policy of page table PT to ALLOC, with
+   COLORS page colors for pt_color, must be set before the first walk */
+void
+pt_set_alloc(struct pt_t *pt,		/* page table instance */
+	     enum pt_alloc_t alloc,	/* page allocation policy */
+	     int colors);		/* page colors, for pt_color */
+
+/* parse a page allocation policy name, i.e., {seq|random|color} */
+enum pt_alloc_t				/* page allocation policy */
+pt_parse_alloc(char *str);		/* policy name */
+
+/* print page table configuration */
+void
+pt_config(struct pt_t *pt,		/* page table instance */
+	  FILE *stream);		/* output stream */
+
+/* register page table stats */
+void
+pt_reg_stats(struct pt_t *pt,		/* page table instance */
+	     struct stat_sdb_t *sdb);	/* stats database */
+
+/* walk the page table for virtual address VADDR, mapping the page if it is
+   not mapped yet, the addresses of the PTEs read (root first) are returned
+   in ADDRS[0..LEVELS-1], returns the physical page address */
+md_addr_t				/* physical page address */
+pt_translate(struct pt_t *pt,		/* page table instance */
+	     md_addr_t vaddr,		/* virtual address to translate */
+	     md_addr_t *addrs);		/* PTE addresses read, or NULL */
+
+/* translate virtual address VADDR to a physical address for a physically
+   indexed cache, mapping the page if it is not mapped yet, the translation
+   is not counted as a page table walk; page table addresses, e.g., PTE
+   reads that missed in a virtually indexed cache, are already physical */
+md_addr_t				/* physical address */
+pt_map(struct pt_t *pt,			/* page table instance */
+       md_addr_t vaddr);		/* virtual address to translate */
+
+/* save the tables and page allocation state of page table PT in the section
+   of warm state file W (see warm.h) named after the page table, so the
+   pages mapped stay where they are in a run restoring the caches */
+void
+pt_save(struct pt_t *pt,		/* page table instance */
+	struct warm_t *w);		/* warm state file to write */
+
+/* restore the tables and page allocation state of page table PT from the
+   current section of warm state file W, the page table must be configured
+   like the one saved, and not walked yet */
+void
+pt_restore(struct pt_t *pt,		/* page table instance */
+	   struct warm_t *w);		/* warm state file to read */
+
+#endif /* PT_H */
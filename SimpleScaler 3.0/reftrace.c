@@ -0,0 +1,437 @@
+/* reftrace.c - memory reference trace routines */
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "reftrace.h"
+
+/* trace file magic string */
+#define RT_MAGIC		"SSRTRC01"
+#define RT_MAGIC_LEN		8
+
+/* size of the record buffer of a block, and the largest record */
+#define RT_BLOCK_SIZE		65536
+#define RT_MAX_REC		(1 + 10 + 10)
+
+/* record flags */
+#define RT_FL_KIND		0x03	/* enum reftrace_kind_t */
+#define RT_FL_SYS		0x04	/* reference made by a system call */
+#define RT_FL_LGSIZE		0x18	/* log2 of reference size */
+#define RT_FL_LGSIZE_SHIFT	3
+#define RT_FL_SIZE		0x20	/* reference size follows */
+#define RT_FL_SEQ		0x40	/* reference follows last of stream */
+
+/* open reference trace FNAME for writing (WRITING) or reading */
+struct reftrace_t *			/* trace opened */
+reftrace_open(char *fname,		/* trace file name */
+	      int writing)		/* open for writing? */
+{
+  struct reftrace_t *t;
+  char magic[RT_MAGIC_LEN];
+
+  t = (struct reftrace_t *)calloc(1, sizeof(struct reftrace_t));
+  if (!t)
+    fatal("out of virtual memory");
+  t->buf = (unsigned char *)malloc(RT_BLOCK_SIZE);
+  if (!t->buf)
+    fatal("out of virtual memory");
+
+  t->fname = mystrdup(fname);
+  t->writing = writing;
+  t->fd = gzopen(fname, writing ? "w" : "r");
+  if (!t->fd)
+    fatal("cannot open reference trace `%s'", fname);
+
+  if (writing)
+    {
+      if (fwrite(RT_MAGIC, RT_MAGIC_LEN, 1, t->fd) != 1)
+	fatal("cannot write reference trace `%s'", fname);
+    }
+  else
+    {
+      if (fread(magic, RT_MAGIC_LEN, 1, t->fd) != 1
+	  || memcmp(magic, RT_MAGIC, RT_MAGIC_LEN) != 0)
+	fatal("`%s' is not a reference trace", fname);
+    }
+
+  t->nbytes = t->pos = t->nrecs = 0;
+  t->pc = t->iaddr = t->daddr = 0;
+  t->refs = t->blocks = t->bytes = 0;
+
+  return t;
+}
+
+/* put 32-bit word W at P, little-endian */
+static void
+put_word(unsigned char *p, word_t w)
+{
+  p[0] = w & 0xff;
+  p[1] = (w >> 8) & 0xff;
+  p[2] = (w >> 16) & 0xff;
+  p[3] = (w >> 24) & 0xff;
+}
+
+/* get 32-bit little-endian word at P */
+static word_t
+get_word(unsigned char *p)
+{
+  return (p[0] | (p[1] << 8) | (p[2] << 16) | ((word_t)p[3] << 24));
+}
+
+/* write the current block of trace T */
+static void
+flush_block(struct reftrace_t *t)
+{
+  unsigned char hdr[8];
+
+  if (!t->nrecs)
+    return;
+
+  put_word(hdr, t->nrecs);
+  put_word(hdr+4, t->nbytes);
+  if (fwrite(hdr, sizeof(hdr), 1, t->fd) != 1
+      || fwrite(t->buf, t->nbytes, 1, t->fd) != 1)
+    fatal("cannot write reference trace `%s'", t->fname);
+
+  t->blocks++;
+
+  /* start a new block */
+  t->nbytes = t->nrecs = 0;
+  t->iaddr = t->daddr = 0;
+}
+
+/* read the next block of trace T, returns FALSE at the end of the trace */
+static int
+fill_block(struct reftrace_t *t)
+{
+  unsigned char hdr[8];
+
+  if (fread(hdr, sizeof(hdr), 1, t->fd) != 1)
+    return FALSE;
+
+  t->nrecs = get_word(hdr);
+  t->nbytes = get_word(hdr+4);
+  if (t->nbytes > RT_BLOCK_SIZE
+      || fread(t->buf, t->nbytes, 1, t->fd) != 1)
+    fatal("reference trace `%s' is corrupted", t->fname);
+
+  t->blocks++;
+  t->bytes += sizeof(hdr) + t->nbytes;
+
+  t->pos = 0;
+  t->iaddr = t->daddr = 0;
+  return TRUE;
+}
+
+/* close reference trace T, flushing any records written */
+void
+reftrace_close(struct reftrace_t *t)	/* trace to close */
+{
+  if (t->writing)
+    flush_block(t);
+  gzclose(t->fd);
+  if (t->recs)
+    free(t->recs);
+  free(t->buf);
+  free(t->fname);
+  free(t);
+}
+
+/* append varint V to the current block of trace T */
+static void
+put_varint(struct reftrace_t *t, qword_t v)
+{
+  while (v >= 0x80)
+    {
+      t->buf[t->nbytes++] = (v & 0x7f) | 0x80;
+      v >>= 7;
+    }
+  t->buf[t->nbytes++] = v;
+}
+
+/* get the varint at *PP, before END, of the current block of trace T, and
+   advance *PP past it */
+static INLINE qword_t
+decode_varint(struct reftrace_t *t, unsigned char **pp, unsigned char *end)
+{
+  unsigned char *p = *pp;
+  qword_t v = 0;
+  int shift = 0;
+
+  do {
+    if (p >= end || shift > 63)
+      fatal("reference trace `%s' is corrupted", t->fname);
+    v |= (qword_t)(*p & 0x7f) << shift;
+    shift += 7;
+  } while (*p++ & 0x80);
+
+  *pp = p;
+  return v;
+}
+
+/* get the next varint from the current block of trace T */
+static qword_t
+get_varint(struct reftrace_t *t)
+{
+  unsigned char *p = t->buf + t->pos;
+  qword_t v = decode_varint(t, &p, t->buf + t->nbytes);
+
+  t->pos = p - t->buf;
+  return v;
+}
+
+/* append a reference to trace T */
+void
+reftrace_write(struct reftrace_t *t,	/* trace to write */
+	       enum reftrace_kind_t kind,/* kind of reference */
+	       int sys,			/* made by a system call? */
+	       md_addr_t addr,		/* address referenced */
+	       int nbytes)		/* size of the reference */
+{
+  int flags, lgsize, start;
+  md_addr_t *next;
+  sqword_t delta;
+
+  if (t->nbytes + RT_MAX_REC > RT_BLOCK_SIZE)
+    flush_block(t);
+
+  /* count the block header with the first record of the block */
+  if (!t->nrecs)
+    t->bytes += 8;
+  start = t->nbytes;
+
+  flags = kind | (sys ? RT_FL_SYS : 0);
+  t->refs++;
+  t->nrecs++;
+
+  if (kind == rt_flush)
+    {
+      t->buf[t->nbytes++] = flags;
+      t->bytes += t->nbytes - start;
+      return;
+    }
+
+  /* reference size, usually 1, 2, 4 or 8 bytes */
+  lgsize = nbytes == 1 ? 0 : nbytes == 2 ? 1 : nbytes == 4 ? 2
+    : nbytes == 8 ? 3 : -1;
+  if (lgsize >= 0)
+    flags |= lgsize << RT_FL_LGSIZE_SHIFT;
+  else
+    flags |= RT_FL_SIZE;
+
+  /* reference address, relative to the last of its stream */
+  next = (kind == rt_inst) ? &t->iaddr : &t->daddr;
+  if (addr == *next)
+    flags |= RT_FL_SEQ;
+
+  t->buf[t->nbytes++] = flags;
+  if (flags & RT_FL_SIZE)
+    put_varint(t, nbytes);
+  if (!(flags & RT_FL_SEQ))
+    {
+      /* sign-extend the difference of (possibly 32-bit) addresses */
+      delta = (sizeof(md_addr_t) == sizeof(word_t)
+	       ? (sqword_t)(sword_t)(addr - *next)
+	       : (sqword_t)(addr - *next));
+      put_varint(t, ((qword_t)delta << 1) ^ (qword_t)(delta >> 63));
+    }
+  *next = addr + nbytes;
+  t->bytes += t->nbytes - start;
+}
+
+/* read the next reference of trace T into REC, returns FALSE at the end of
+   the trace */
+int					/* non-zero if REC is valid */
+reftrace_read(struct reftrace_t *t,	/* trace to read */
+	      struct reftrace_rec_t *rec)/* reference read */
+{
+  int flags;
+  md_addr_t *next;
+  qword_t zz;
+
+  if (!t->nrecs && !fill_block(t))
+    return FALSE;
+  if (t->pos >= t->nbytes)
+    fatal("reference trace `%s' is corrupted", t->fname);
+
+  flags = t->buf[t->pos++];
+  t->nrecs--;
+  t->refs++;
+
+  rec->kind = (enum reftrace_kind_t)(flags & RT_FL_KIND);
+  rec->sys = (flags & RT_FL_SYS) != 0;
+  rec->pc = t->pc;
+  rec->addr = 0;
+  rec->nbytes = 0;
+  if (rec->kind == rt_flush)
+    return TRUE;
+
+  if (flags & RT_FL_SIZE)
+    rec->nbytes = (int)get_varint(t);
+  else
+    rec->nbytes = 1 << ((flags & RT_FL_LGSIZE) >> RT_FL_LGSIZE_SHIFT);
+
+  next = (rec->kind == rt_inst) ? &t->iaddr : &t->daddr;
+  if (flags & RT_FL_SEQ)
+    rec->addr = *next;
+  else
+    {
+      zz = get_varint(t);
+      rec->addr = *next + (md_addr_t)((sqword_t)(zz >> 1)
+				      ^ -(sqword_t)(zz & 1));
+    }
+  *next = rec->addr + rec->nbytes;
+
+  if (rec->kind == rt_inst)
+    rec->pc = t->pc = rec->addr;
+
+  return TRUE;
+}
+
+/* read the references left in the current block of trace T, or in the next
+   block if none are left, decoding them in one pass into an array returned
+   in *RECS, which is only valid until the next read, returns the number of
+   references, or 0 at the end of the trace */
+int					/* number of references read */
+reftrace_read_block(struct reftrace_t *t,/* trace to read */
+		    struct reftrace_rec_t **recs)/* references read */
+{
+  unsigned char *p, *end;
+  struct reftrace_rec_t *rec, *last;
+  md_addr_t pc, iaddr, daddr;
+  qword_t zz;
+  int flags, n;
+
+  if (!t->nrecs && !fill_block(t))
+    return 0;
+
+  /* each record is at least one byte, so a block holds at most
+     RT_BLOCK_SIZE of them */
+  if (!t->recs)
+    {
+      t->recs = (struct reftrace_rec_t *)
+	calloc(RT_BLOCK_SIZE, sizeof(struct reftrace_rec_t));
+      if (!t->recs)
+	fatal("out of virtual memory");
+    }
+  if (t->nrecs > t->nbytes - t->pos)
+    fatal("reference trace `%s' is corrupted", t->fname);
+
+  /* the address state lives in locals for the whole block */
+  p = t->buf + t->pos;
+  end = t->buf + t->nbytes;
+  pc = t->pc;
+  iaddr = t->iaddr;
+  daddr = t->daddr;
+  for (rec=t->recs, last=t->recs + t->nrecs; rec < last; rec++)
+    {
+      if (p >= end)
+	fatal("reference trace `%s' is corrupted", t->fname);
+      flags = *p++;
+
+      rec->kind = (enum reftrace_kind_t)(flags & RT_FL_KIND);
+      rec->sys = (flags & RT_FL_SYS) != 0;
+      if (rec->kind == rt_flush)
+	{
+	  rec->pc = pc;
+	  rec->addr = 0;
+	  rec->nbytes = 0;
+	  continue;
+	}
+
+      if (flags & RT_FL_SIZE)
+	rec->nbytes = (int)decode_varint(t, &p, end);
+      else
+	rec->nbytes = 1 << ((flags & RT_FL_LGSIZE) >> RT_FL_LGSIZE_SHIFT);
+
+      if (rec->kind == rt_inst)
+	{
+	  rec->addr = iaddr;
+	  if (!(flags & RT_FL_SEQ))
+	    {
+	      zz = decode_varint(t, &p, end);
+	      rec->addr += (md_addr_t)((sqword_t)(zz >> 1)
+				       ^ -(sqword_t)(zz & 1));
+	    }
+	  iaddr = rec->addr + rec->nbytes;
+	  pc = rec->addr;
+	}
+      else
+	{
+	  rec->addr = daddr;
+	  if (!(flags & RT_FL_SEQ))
+	    {
+	      zz = decode_varint(t, &p, end);
+	      rec->addr += (md_addr_t)((sqword_t)(zz >> 1)
+				       ^ -(sqword_t)(zz & 1));
+	    }
+	  daddr = rec->addr + rec->nbytes;
+	}
+      rec->pc = pc;
+    }
+
+  n = t->nrecs;
+  t->pos = p - t->buf;
+  t->nrecs = 0;
+  t->refs += n;
+  t->pc = pc;
+  t->iaddr = iaddr;
+  t->daddr = daddr;
+
+  *recs = t->recs;
+  return n;
+}
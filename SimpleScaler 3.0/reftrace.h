@@ -0,0 +1,155 @@
+/* reftrace.h - memory reference trace interfaces */
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef REFTRACE_H
+#define REFTRACE_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+
+/*
+ * A reference trace records the references made to the caches of sim-cache,
+ * i.e., instruction fetches, data reads and writes, and cache flushes, so
+ * they can be replayed without executing the program.  The trace is a short
+ * header followed by blocks of variable-length records:
+ *
+ *	header:	"SSRTRC01"
+ *	block:	<nrecs:4> <nbytes:4> <nbytes of records>
+ *	record:	<flags:1> [<nbytes:varint>] [<addr delta:varint>]
+ *
+ * Words are stored little-endian.  The record flags hold the reference kind,
+ * the log2 of the reference size (or RT_FL_SIZE if the size follows the
+ * flags) and RT_FL_SEQ if the reference immediately follows the last
+ * reference of the same stream (instruction or data), otherwise the
+ * zig-zag encoded difference from the last address of the stream follows.
+ * The address state is reset at the start of each block, so blocks can be
+ * decoded independently.  Data references are made by the instruction last
+ * fetched, so the PC of a reference is implicit.  Trace files with names
+ * ending in ".gz" are compressed with gzip.
+ */
+
+/* kind of a traced reference */
+enum reftrace_kind_t {
+  rt_inst,			/* instruction fetch */
+  rt_read,			/* data read */
+  rt_write,			/* data write */
+  rt_flush			/* data cache flush */
+};
+
+/* a traced reference */
+struct reftrace_rec_t {
+  enum reftrace_kind_t kind;	/* kind of reference */
+  int sys;			/* made by a system call? */
+  md_addr_t pc;			/* PC of instruction making the reference */
+  md_addr_t addr;		/* address referenced */
+  int nbytes;			/* size of the reference */
+};
+
+/* an open reference trace */
+struct reftrace_t {
+  char *fname;			/* trace file name */
+  FILE *fd;			/* trace file */
+  int writing;			/* trace is open for writing? */
+
+  /* current block */
+  unsigned char *buf;		/* encoded records */
+  int nbytes;			/* bytes in buffer */
+  int pos;			/* read position in buffer */
+  int nrecs;			/* records in (or left in) block */
+  struct reftrace_rec_t *recs;	/* references decoded by
+				   reftrace_read_block(), NULL if none */
+
+  /* address state, reset at each block */
+  md_addr_t pc;			/* last instruction address */
+  md_addr_t iaddr, daddr;	/* next sequential inst/data address */
+
+  /* stats */
+  counter_t refs;		/* number of references traced */
+  counter_t blocks;		/* number of blocks traced */
+  counter_t bytes;		/* number of (uncompressed) bytes traced */
+};
+
+/* open reference trace FNAME for writing (WRITING) or reading */
+struct reftrace_t *			/* trace opened */
+reftrace_open(char *fname,		/* trace file name */
+	      int writing);		/* open for writing? */
+
+/* close reference trace T, flushing any records written */
+void
+reftrace_close(struct reftrace_t *t);	/* trace to close */
+
+/* append a reference to trace T */
+void
+reftrace_write(struct reftrace_t *t,	/* trace to write */
+	       enum reftrace_kind_t kind,/* kind of reference */
+	       int sys,			/* made by a system call? */
+	       md_addr_t addr,		/* address referenced */
+	       int nbytes);		/* size of the reference */
+
+/* read the next reference of trace T into REC, returns FALSE at the end of
+   the trace */
+int					/* non-zero if REC is valid */
+reftrace_read(struct reftrace_t *t,	/* trace to read */
+	      struct reftrace_rec_t *rec);/* reference read */
+
+/* read the references left in the current block of trace T, or in the next
+   block if none are left, decoding them in one pass into an array returned
+   in *RECS, which is only valid until the next read, returns the number of
+   references, or 0 at the end of the trace */
+int					/* number of references read */
+reftrace_read_block(struct reftrace_t *t,/* trace to read */
+		    struct reftrace_rec_t **recs);/* references read */
+
+#endif /* REFTRACE_H */
@@ -0,0 +1,356 @@
+/* reuse.c - reuse distance profiler routines */
+
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stats.h"
+#include "reuse.h"
+
+/* initial number of times, blocks and hash table buckets */
+#define REUSE_INIT_SIZE		1024
+
+/* hash table bucket of block number BNO */
+#define REUSE_HASH(r, bno)	(((bno) ^ ((bno) >> 16)) & ((r)->hsize-1))
+
+/* create a reuse distance profiler named NAME */
+struct reuse_t *			/* profiler created */
+reuse_create(char *name,		/* profiler name */
+	     int bsize,			/* block size in bytes */
+	     int sample)		/* sampling rate, 1 in SAMPLE blocks */
+{
+  struct reuse_t *r;
+  unsigned int t;
+  int i;
+
+  if (bsize <= 0 || (bsize & (bsize-1)) != 0)
+    fatal("reuse profiler `%s' block size `%d' must be a power of two",
+	  name, bsize);
+  if (sample <= 0 || (sample & (sample-1)) != 0)
+    fatal("reuse profiler `%s' sampling rate `%d' must be a power of two",
+	  name, sample);
+
+  r = (struct reuse_t *)calloc(1, sizeof(struct reuse_t));
+  if (!r)
+    fatal("out of virtual memory");
+
+  r->name = mystrdup(name);
+  r->bsize = bsize;
+  r->blk_shift = log_base2(bsize);
+  r->sample = sample;
+  r->sample_shift = log_base2(sample);
+
+  r->blks_size = REUSE_INIT_SIZE;
+  r->blks = (struct reuse_blk_t *)
+    calloc(r->blks_size, sizeof(struct reuse_blk_t));
+  r->hsize = REUSE_INIT_SIZE;
+  r->hash = (int *)calloc(r->hsize, sizeof(int));
+  r->times = REUSE_INIT_SIZE;
+  r->tree = (unsigned int *)calloc(r->times + 1, sizeof(unsigned int));
+  r->owner = (int *)calloc(r->times + 1, sizeof(int));
+  if (!r->blks || !r->hash || !r->tree || !r->owner)
+    fatal("out of virtual memory");
+
+  for (i=0; i<r->hsize; i++)
+    r->hash[i] = -1;
+  for (t=0; t<=r->times; t++)
+    r->owner[t] = -1;
+
+  return r;
+}
+
+/* return the floor of the log base 2 of N, N > 0 */
+static int
+floor_log2(unsigned int n)
+{
+  int log = 0;
+
+  while (n >>= 1)
+    log++;
+  return log;
+}
+
+/* add V to time I of the Fenwick tree of profiler R */
+static void
+tree_add(struct reuse_t *r, unsigned int i, int v)
+{
+  for (; i <= r->times; i += i & -i)
+    r->tree[i] += v;
+}
+
+/* return the number of marked times in 1..I of profiler R */
+static unsigned int
+tree_sum(struct reuse_t *r, unsigned int i)
+{
+  unsigned int sum = 0;
+
+  for (; i > 0; i -= i & -i)
+    sum += r->tree[i];
+  return sum;
+}
+
+/* renumber the marked times of profiler R to 1..NBLKS, in order, making
+   room for at least as many more accesses */
+static void
+reuse_compact(struct reuse_t *r)
+{
+  unsigned int t, n, j, times;
+
+  /* renumber the marks, in place, as N <= T */
+  for (t=1, n=0; t <= r->times; t++)
+    if (r->owner[t] >= 0)
+      {
+	r->owner[++n] = r->owner[t];
+	r->blks[r->owner[n]].time = n;
+      }
+
+  times = r->times;
+  if (times < 2*n)
+    {
+      times = 2*n;
+      r->tree = (unsigned int *)
+	realloc(r->tree, (times + 1) * sizeof(unsigned int));
+      r->owner = (int *)realloc(r->owner, (times + 1) * sizeof(int));
+      if (!r->tree || !r->owner)
+	fatal("out of virtual memory");
+      r->times = times;
+    }
+  for (t=n+1; t <= times; t++)
+    r->owner[t] = -1;
+
+  /* rebuild the tree in O(TIMES), each entry adds itself to its parent */
+  for (t=1; t <= times; t++)
+    r->tree[t] = (t <= n);
+  for (t=1; t <= times; t++)
+    {
+      j = t + (t & -t);
+      if (j <= times)
+	r->tree[j] += r->tree[t];
+    }
+  r->now = n;
+}
+
+/* add a block for block number BNO to profiler R, returns its index */
+static int
+reuse_new_blk(struct reuse_t *r, md_addr_t bno)
+{
+  int i, b;
+
+  if (r->nblks == r->blks_size)
+    {
+      r->blks_size *= 2;
+      r->blks = (struct reuse_blk_t *)
+	realloc(r->blks, r->blks_size * sizeof(struct reuse_blk_t));
+      if (!r->blks)
+	fatal("out of virtual memory");
+    }
+  b = r->nblks++;
+  r->blks[b].baddr = bno;
+
+  if (r->nblks > 2*r->hsize)
+    {
+      /* grow the hash table, and rechain all the blocks */
+      free(r->hash);
+      r->hsize *= 2;
+      r->hash = (int *)malloc(r->hsize * sizeof(int));
+      if (!r->hash)
+	fatal("out of virtual memory");
+      for (i=0; i<r->hsize; i++)
+	r->hash[i] = -1;
+      for (i=0; i<r->nblks; i++)
+	{
+	  r->blks[i].hash_next = r->hash[REUSE_HASH(r, r->blks[i].baddr)];
+	  r->hash[REUSE_HASH(r, r->blks[i].baddr)] = i;
+	}
+    }
+  else
+    {
+      r->blks[b].hash_next = r->hash[REUSE_HASH(r, bno)];
+      r->hash[REUSE_HASH(r, bno)] = b;
+    }
+  return b;
+}
+
+/* profile an access to the block containing ADDR */
+void
+reuse_access(struct reuse_t *r,		/* profiler instance */
+	     md_addr_t addr)		/* address accessed */
+{
+  md_addr_t bno = addr >> r->blk_shift;
+  unsigned int dist, t;
+  int b, bucket;
+
+  r->accesses++;
+
+  /* SHARDS sampling, keep the blocks whose hash has SAMPLE_SHIFT leading
+     zero bits */
+  if (r->sample_shift
+      && ((unsigned int)bno * 2654435761U) >> (32 - r->sample_shift))
+    return;
+  r->sampled++;
+
+  for (b=r->hash[REUSE_HASH(r, bno)]; b >= 0; b=r->blks[b].hash_next)
+    if (r->blks[b].baddr == bno)
+      break;
+
+  if (r->now == r->times)
+    reuse_compact(r);
+  t = ++r->now;
+
+  if (b < 0)
+    {
+      b = reuse_new_blk(r, bno);
+      bucket = REUSE_COLD;
+    }
+  else
+    {
+      /* every block has one mark, those after its last access are the
+	 distinct blocks accessed since */
+      dist = r->nblks - tree_sum(r, r->blks[b].time);
+      if (!dist)
+	bucket = 0;
+      else
+	bucket = MIN(floor_log2(dist) + 1 + r->sample_shift,
+		     REUSE_COLD - 1);
+
+      tree_add(r, r->blks[b].time, -1);
+      r->owner[r->blks[b].time] = -1;
+    }
+
+  tree_add(r, t, 1);
+  r->owner[t] = b;
+  r->blks[b].time = t;
+
+  stat_add_samples(r->dist, bucket, r->sample);
+  stat_add_samples(r->mrc, REUSE_COLD - bucket, r->sample);
+}
+
+/* print profiler configuration */
+void
+reuse_config(struct reuse_t *r,		/* profiler instance */
+	     FILE *stream)		/* output stream */
+{
+  fprintf(stream,
+	  "reuse: %s: reuse distances of %d byte blocks, 1 in %d blocks "
+	  "profiled\n", r->name, r->bsize, r->sample);
+}
+
+/* return a label for a cache of BYTES bytes, e.g., 64KB */
+static char *
+size_label(double bytes)
+{
+  static char *units[] = { "B", "KB", "MB", "GB", "TB", "PB" };
+  char buf[64];
+  int u;
+
+  for (u=0; bytes >= 1024.0 && u < N_ELT(units)-1; u++)
+    bytes /= 1024.0;
+  sprintf(buf, "%.0f%s", bytes, units[u]);
+  return mystrdup(buf);
+}
+
+/* register the profiler stats */
+void
+reuse_reg_stats(struct reuse_t *r,	/* profiler instance */
+		char *name,		/* name of the profiled cache */
+		struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], **dist_imap, **mrc_imap;
+  int i;
+
+  dist_imap = (char **)calloc(REUSE_BUCKETS, sizeof(char *));
+  mrc_imap = (char **)calloc(REUSE_BUCKETS, sizeof(char *));
+  if (!dist_imap || !mrc_imap)
+    fatal("out of virtual memory");
+
+  /* bucket I > 0 holds distances in [2^(I-1), 2^I), which miss in caches
+     of up to 2^(I-1) blocks */
+  dist_imap[0] = "0";
+  mrc_imap[REUSE_COLD] = "0B";
+  for (i=1; i<REUSE_COLD; i++)
+    {
+      if (i == 1)
+	sprintf(buf, "1");
+      else
+	sprintf(buf, "%.0f-%.0f", ldexp(1.0, i-1), ldexp(1.0, i) - 1.0);
+      dist_imap[i] = mystrdup(buf);
+      mrc_imap[REUSE_COLD - i] = size_label(ldexp((double)r->bsize, i-1));
+    }
+  dist_imap[REUSE_COLD] = "cold";
+  mrc_imap[0] = "infinite";
+
+  sprintf(buf, "%s.reuse_accesses", name);
+  stat_reg_counter(sdb, buf, "total number of accesses seen by the reuse profiler", &r->accesses, 0, NULL);
+  sprintf(buf, "%s.reuse_sampled", name);
+  stat_reg_counter(sdb, buf, "total number of accesses to sampled blocks", &r->sampled, 0, NULL);
+  sprintf(buf, "%s.reuse_blocks", name);
+  stat_reg_int(sdb, buf, "total number of sampled blocks", &r->nblks, 0, NULL);
+
+  sprintf(buf, "%s.reuse_dist", name);
+  r->dist = stat_reg_dist(sdb, buf,
+			  "reuse distance (in blocks) of each access",
+			  /* init */0, /* arr sz */REUSE_BUCKETS,
+			  /* bucket sz */1, PF_ALL, /* format */NULL,
+			  /* imap */dist_imap, /* print fn */NULL);
+  sprintf(buf, "%s.mrc", name);
+  r->mrc = stat_reg_dist(sdb, buf,
+			 "miss ratio curve, cdf is the miss rate of a "
+			 "fully-associative LRU cache of each size",
+			 /* init */0, /* arr sz */REUSE_BUCKETS,
+			 /* bucket sz */1, (PF_COUNT|PF_CDF),
+			 /* format */NULL, /* imap */mrc_imap,
+			 /* print fn */NULL);
+}
@@ -0,0 +1,156 @@
+/* reuse.h - reuse distance profiler interfaces */
+
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#ifndef REUSE_H
+#define REUSE_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stats.h"
+
+/*
+ * The reuse distance profiler measures the LRU stack distance of each
+ * access to a cache, i.e., the number of distinct blocks accessed since
+ * the last access to the same block, at the block size of the cache.  An
+ * access hits in a fully-associative LRU cache of C blocks if and only if
+ * its distance is less than C, so one profile gives the miss ratio curve
+ * (MRC) of the access stream for every cache size.
+ *
+ * Each profiled block remembers the time of its last access, and a
+ * Fenwick tree over the access times marks the last access of every
+ * block, so the distance of an access is the number of marks after the
+ * last access of its block, counted in O(log n).  When the times run
+ * out, the marks are renumbered in order and the tree is rebuilt.
+ *
+ * With a sampling rate of 1 in SAMPLE (a power of two), only the blocks
+ * whose address hash falls below 1/SAMPLE of the hash space are profiled
+ * (SHARDS, spatially hashed sampling), which keeps the blocks and times
+ * tracked at about 1/SAMPLE of the footprint.  The distances measured on
+ * the sampled blocks are scaled by SAMPLE, and each sampled access
+ * counts for SAMPLE accesses.
+ */
+
+/* distance buckets, bucket 0 holds distance 0, bucket I holds distances
+   in [2^(I-1), 2^I), the last bucket holds the first accesses */
+#define REUSE_BUCKETS		34
+#define REUSE_COLD		(REUSE_BUCKETS-1)
+
+/* a profiled block */
+struct reuse_blk_t
+{
+  md_addr_t baddr;		/* block address */
+  int hash_next;		/* next block in the hash chain, or -1 */
+  unsigned int time;		/* time of the last access */
+};
+
+/* reuse distance profiler definition */
+struct reuse_t
+{
+  char *name;			/* profiler name */
+  int bsize;			/* block size in bytes */
+  int blk_shift;		/* log2 of BSIZE */
+  int sample;			/* 1 in SAMPLE blocks are profiled */
+  int sample_shift;		/* log2 of SAMPLE */
+
+  /* profiled blocks, found through a hash table of block indices */
+  int nblks;			/* number of blocks profiled */
+  int blks_size;		/* room for blocks */
+  struct reuse_blk_t *blks;	/* profiled blocks */
+  int hsize;			/* hash table size, a power of two */
+  int *hash;			/* first block of each chain, or -1 */
+
+  /* Fenwick tree over the access times 1..TIMES, marking the last access
+     of each block, and the block of each marked time */
+  unsigned int times;		/* number of times */
+  unsigned int now;		/* last time given to an access */
+  unsigned int *tree;		/* Fenwick tree, TIMES+1 entries */
+  int *owner;			/* block last accessed at each time, or -1 */
+
+  /* stats */
+  counter_t accesses;		/* total number of accesses */
+  counter_t sampled;		/* total number of accesses profiled */
+  struct stat_stat_t *dist;	/* reuse distance distribution */
+  struct stat_stat_t *mrc;	/* miss ratio curve */
+};
+
+/* create a reuse distance profiler named NAME, of blocks of BSIZE bytes,
+   that profiles 1 in SAMPLE blocks */
+struct reuse_t *			/* profiler created */
+reuse_create(char *name,		/* profiler name */
+	     int bsize,			/* block size in bytes */
+	     int sample);		/* sampling rate, 1 in SAMPLE blocks */
+
+/* profile an access to the block containing ADDR */
+void
+reuse_access(struct reuse_t *r,		/* profiler instance */
+	     md_addr_t addr);		/* address accessed */
+
+/* print profiler configuration */
+void
+reuse_config(struct reuse_t *r,		/* profiler instance */
+	     FILE *stream);		/* output stream */
+
+/* register the profiler stats, named after cache NAME, the distribution
+   <name>.reuse_dist holds the accesses of each distance range, and the
+   distribution <name>.mrc holds the same accesses in descending order of
+   distance, each labeled with the largest cache size that misses them, so
+   its cdf is the miss rate of a fully-associative LRU cache of each
+   size */
+void
+reuse_reg_stats(struct reuse_t *r,	/* profiler instance */
+		char *name,		/* name of the profiled cache */
+		struct stat_sdb_t *sdb);/* stats database */
+
+#endif /* REUSE_H */
@@ -53,6 +53,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <sched.h>
+#include <pthread.h>
 #include <assert.h>
 
 #include "host.h"
@@ -61,6 +63,12 @@
 #include "regs.h"
 #include "memory.h"
 #include "cache.h"
+#include "prefetch.h"
+#include "reuse.h"
+#include "pt.h"
+#include "reftrace.h"
+#include "warm.h"
+#include "eio.h"
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
@@ -86,23 +94,217 @@ static counter_t sim_num_refs = 0;
 /* maximum number of inst's to execute */
 static unsigned int max_insts;
 
-/* level 1 instruction cache, entry level instruction cache */
-static struct cache_t *cache_il1 = NULL;
+/* a cache hierarchy, i.e., the caches and TLBs of one configuration, the
+   base hierarchy is configured with the -cache:* and -tlb:* options, each
+   -fanout argument adds another hierarchy driven by the same references */
+struct cache_hier_t
+{
+  char *prefix;			/* prefix of cache (and stat) names */
+
+  /* cache/TLB configs, see the -cache:* and -tlb:* options */
+  char *dl1_opt;
+  char *dl1_wpolicy_opt;
+  int dl1_wbuf;
+  int dl1_walloc;
+  int dl1_victim;
+  char *dl1_pf_opt;
+  char *dl2_opt;
+  char *dl2_wpolicy_opt;
+  int dl2_wbuf;
+  int dl2_walloc;
+  int dl2_victim;
+  char *dl2_pf_opt;
+  char *il1_opt;
+  char *il2_opt;
+  char *itlb_opt;
+  char *dtlb_opt;
+  char *pt_opt;
+  char *walk_opt;
+  char *pwc_opt;
+  char *stlb_opt;
+  char *pindex_opt;
+  char *palloc_opt;
+  int pcolors;
+  int classify;
+  char *reuse_opt;
+  int sample;
+  int slices;
+
+  struct cache_t *il1;		/* level 1 inst cache, entry level i-cache */
+  struct cache_t *il2;		/* level 2 instruction cache */
+  struct cache_t *dl1;		/* level 1 data cache, entry level d-cache */
+  struct cache_t *dl2;		/* level 2 data cache */
+  struct cache_t *itlb;		/* instruction TLB */
+  struct cache_t *dtlb;		/* data TLB */
+  struct pt_t *pt;		/* page table walked on TLB misses */
+  struct cache_t *walk_cache;	/* cache the page walker reads PTEs through */
+  struct cache_t *pwc;		/* page walk cache */
+  struct cache_t *stlb;		/* second level TLB */
+
+  /* caches indexed with physical addresses, the L1 caches see virtual
+     addresses unless all caches are physically indexed */
+  enum { pindex_none, pindex_all, pindex_l2 } pindex;
+  struct pt_t *pmap;		/* page mapper, the page table if any */
+
+  /* a hierarchy simulated in SLICES slices is never accessed, each of its
+     SLICE_HIERS simulates the references to its own slice of the sets of
+     every cache and TLB, their stats are merged into those of the
+     hierarchy, see hier_merge() */
+  int slice;			/* slice simulated, 0 if not a slice */
+  struct cache_hier_t *slice_hiers;/* slices of hierarchy, if SLICES > 1 */
+};
+
+/* simulated cache hierarchies, the base hierarchy is HIERS[0] */
+#define MAX_FANOUT 32
+static int n_hiers = 0;
+static struct cache_hier_t hiers[MAX_FANOUT+1];
+
+/* hierarchies accessed by the references, the hierarchies not simulated in
+   slices and the slices of the others */
+static int n_sim_hiers = 0;
+static struct cache_hier_t **sim_hiers = NULL;
+
+/* the only hierarchy accessed, when the references are neither recorded nor
+   fanned out, sim_main() and trace_replay() then access it directly */
+static struct cache_hier_t *direct_hier = NULL;
+
+/* maximum number of slices of a hierarchy */
+#define MAX_SLICES 256
+
+/* hierarchy currently being accessed, the miss handlers use it to find the
+   next level of the hierarchy, each host thread accesses its own hierarchies */
+static __thread struct cache_hier_t *hier = NULL;
+
+/* address ADDR as seen by the caches of hierarchy H at level LEVEL
+   (pindex_all for the L1 caches, pindex_l2 for the L2 caches) */
+#define CACHE_ADDR(H, ADDR, LEVEL)					\
+  ((H)->pindex == (LEVEL) ? pt_map((H)->pmap, (ADDR)) : (ADDR))
+
+/* with -fanout:threads, sim_main() does not access the caches itself, it
+   appends each reference to a chunk of a ring of chunks shared with the
+   worker threads; each worker simulates a fixed range of the hierarchies
+   and consumes every chunk of the ring in order, so the caches see the
+   same references, in the same order, as they would without threads */
+enum fanout_kind_t { fk_inst, fk_data, fk_flush };
+
+/* a reference in the fanout stream */
+struct fanout_ref_t
+{
+  md_addr_t addr;		/* address to access */
+  unsigned char kind;		/* enum fanout_kind_t */
+  unsigned char cmd;		/* enum mem_cmd, Read or Write */
+  unsigned short nbytes;	/* number of bytes to access */
+};
 
-/* level 1 instruction cache */
-static struct cache_t *cache_il2 = NULL;
+#define FANOUT_CHUNK_SIZE	4096	/* references per chunk */
+#define FANOUT_RING_SIZE	64	/* chunks in the ring */
+
+/* a chunk of the fanout stream */
+struct fanout_chunk_t
+{
+  int nrefs;			/* number of references in chunk */
+  struct fanout_ref_t refs[FANOUT_CHUNK_SIZE];
+};
 
-/* level 1 data cache, entry level data cache */
-static struct cache_t *cache_dl1 = NULL;
+/* a fanout worker thread, it simulates SIM_HIERS[FIRST..LAST-1] */
+struct fanout_worker_t
+{
+  pthread_t thread;		/* host thread */
+  int first, last;		/* range of hierarchies simulated */
+  unsigned long tail;		/* number of chunks consumed, only written
+				   by the worker */
+  char pad[64];			/* keep tails on different host lines */
+};
+
+/* the ring of chunks, chunk N of the stream is FANOUT_RING[N % RING_SIZE],
+   FANOUT_HEAD is the number of chunks published by the producer, only
+   written by the producer; a worker owns chunks TAIL..HEAD-1 until it
+   advances its tail, the producer fills a chunk once every worker has
+   consumed it */
+static struct fanout_chunk_t *fanout_ring = NULL;
+static unsigned long fanout_head = 0;
+static int fanout_done = FALSE;
+
+/* chunk the producer is filling */
+static struct fanout_chunk_t *fanout_chunk = NULL;
+
+/* fanout worker threads */
+static int fanout_nworkers = 0;
+static struct fanout_worker_t *fanout_workers = NULL;
+
+static void fanout_drain(void);
+
+/* a replayed chunk is simulated in batches, see chunk_replay(), its
+   references are split by L1 cache once for all the hierarchies a thread
+   simulates, then each L1 cache of a hierarchy accesses all its references
+   at once, with its misses queued, and the queued misses are made to the
+   L2 caches in the order of their references */
+
+/* a queued L1 miss */
+struct hier_miss_t
+{
+  int seq;			/* chunk index of the reference that missed */
+  enum mem_cmd cmd;		/* access cmd, Read or Write */
+  md_addr_t baddr;		/* block address to access */
+  int bsize;			/* size of block to access */
+  md_addr_t pc;			/* PC of the access */
+};
+
+/* the references of a chunk to one L1 cache, and its queued misses */
+struct hier_stream_t
+{
+  int nrefs;			/* number of references */
+  struct cache_ref_t refs[FANOUT_CHUNK_SIZE];
+  struct cache_ref_t prefs[FANOUT_CHUNK_SIZE];/* REFS, physical addresses */
+  struct cache_ref_t trefs[FANOUT_CHUNK_SIZE];/* REFS, as TLB reads */
+  int seq[FANOUT_CHUNK_SIZE];	/* chunk index of each reference */
+  int nmisses;			/* number of queued misses */
+  int misses_size;		/* room for queued misses */
+  struct hier_miss_t *misses;	/* queued misses */
+};
+
+/* a chunk split by L1 cache */
+struct hier_split_t
+{
+  struct hier_stream_t inst;	/* l1 inst cache references */
+  struct hier_stream_t data;	/* l1 data cache references */
+  md_addr_t pc;			/* address of the last instruction split */
+};
+
+/* split of the chunk being replayed by this host thread, and whether the
+   L1 misses of the hierarchy being accessed are queued */
+static __thread struct hier_split_t *hier_split = NULL;
+static __thread int hier_defer_misses = FALSE;
+
+/* queue a miss of the L1 cache CP, which is being accessed by a batch of
+   the references of stream S */
+static unsigned int			/* latency of block access */
+hier_defer(struct hier_stream_t *s,	/* stream of the L1 cache */
+	   struct cache_t *cp,		/* L1 cache that missed */
+	   enum mem_cmd cmd,		/* access cmd, Read or Write */
+	   md_addr_t baddr,		/* block address to access */
+	   int bsize)			/* size of block to access */
+{
+  struct hier_miss_t *m;
 
-/* level 2 data cache */
-static struct cache_t *cache_dl2 = NULL;
+  if (s->nmisses == s->misses_size)
+    {
+      s->misses_size = s->misses_size ? 2 * s->misses_size : 1024;
+      s->misses = (struct hier_miss_t *)
+	realloc(s->misses, s->misses_size * sizeof(struct hier_miss_t));
+      if (!s->misses)
+	fatal("out of virtual memory");
+    }
 
-/* instruction TLB */
-static struct cache_t *itlb = NULL;
+  m = &s->misses[s->nmisses++];
+  m->seq = s->seq[cp->batch_ref];
+  m->cmd = cmd;
+  m->baddr = baddr;
+  m->bsize = bsize;
+  m->pc = cp->pc;
 
-/* data TLB */
-static struct cache_t *dtlb = NULL;
+  return /* access latency, ignored */1;
+}
 
 /* text-based stat profiles */
 #define MAX_PCSTAT_VARS 8
@@ -128,10 +330,15 @@ dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
 	      tick_t now)		/* time of access */
 {
-  if (cache_dl2)
+  if (hier_defer_misses)
+    return hier_defer(&hier_split->data, hier->dl1, cmd, baddr, bsize);
+
+  if (hier->dl2)
     {
       /* access next level of data cache hierarchy */
-      return cache_access(cache_dl2, cmd, baddr, NULL, bsize,
+      hier->dl2->pc = hier->dl1->pc;
+      return cache_access(hier->dl2, cmd,
+			  CACHE_ADDR(hier, baddr, pindex_l2), NULL, bsize,
 			  /* now */now, /* pudata */NULL, /* repl addr */NULL);
     }
   else
@@ -162,10 +369,15 @@ il1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
 	      tick_t now)		/* time of access */
 {
-  if (cache_il2)
+  if (hier_defer_misses)
+    return hier_defer(&hier_split->inst, hier->il1, cmd, baddr, bsize);
+
+  if (hier->il2)
     {
       /* access next level of inst cache hierarchy */
-      return cache_access(cache_il2, cmd, baddr, NULL, bsize,
+      hier->il2->pc = baddr;
+      return cache_access(hier->il2, cmd,
+			  CACHE_ADDR(hier, baddr, pindex_l2), NULL, bsize,
 			  /* now */now, /* pudata */NULL, /* repl addr */NULL);
     }
   else
@@ -188,6 +400,87 @@ il2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
   return /* access latency, ignored */1;
 }
 
+/* read the PTE at ADDR for the page walker of the current hierarchy */
+static void
+walk_read(md_addr_t addr,		/* address of PTE */
+	  int nbytes,			/* bytes to read */
+	  tick_t now)			/* time of read */
+{
+  md_addr_t pc;
+
+  if (hier->walk_cache)
+    {
+      /* the walk is not made by an instruction, keep the PC of the next
+	 data access */
+      pc = hier->walk_cache->pc;
+      hier->walk_cache->pc = 0;
+      cache_access(hier->walk_cache, Read, addr, NULL, nbytes,
+		   now, NULL, NULL);
+      hier->walk_cache->pc = pc;
+    }
+}
+
+/* page walk cache block miss handler function */
+static unsigned int			/* latency of block access */
+pwc_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t baddr,		/* block address to access */
+	      int bsize,		/* size of block to access */
+	      struct cache_blk_t *blk,	/* ptr to block in upper level */
+	      tick_t now)		/* time of access */
+{
+  if (cmd == Read)
+    walk_read(baddr, bsize, now);
+  else
+    panic("writes to the page walk cache not supported");
+
+  return /* access latency, ignored */1;
+}
+
+/* translate VADDR for a TLB miss of the current hierarchy, walking its page
+   table if there is one, returns the physical page address */
+static md_addr_t			/* physical page address */
+tlb_walk(md_addr_t vaddr,		/* virtual address to translate */
+	 tick_t now)			/* time of miss */
+{
+  md_addr_t addrs[PT_MAX_LEVELS], phy_page;
+  int i;
+
+  if (!hier->pt)
+    {
+      /* fake translation */
+      return 0;
+    }
+
+  /* read the PTE of each level, upper levels through the page walk cache */
+  phy_page = pt_translate(hier->pt, vaddr, addrs);
+  for (i=0; i<hier->pt->levels; i++)
+    {
+      if (hier->pwc && i < hier->pt->levels - 1)
+	cache_access(hier->pwc, Read, addrs[i], NULL, sizeof(md_addr_t),
+		     now, NULL, NULL);
+      else
+	walk_read(addrs[i], sizeof(md_addr_t), now);
+    }
+
+  return phy_page;
+}
+
+/* translate VADDR for a first level TLB miss of the current hierarchy,
+   through its second level TLB if there is one */
+static md_addr_t			/* physical page address */
+tlb_miss(md_addr_t vaddr,		/* virtual address to translate */
+	 tick_t now)			/* time of miss */
+{
+  byte_t *udata;
+
+  if (!hier->stlb)
+    return tlb_walk(vaddr, now);
+
+  cache_access(hier->stlb, Read, vaddr & ~(md_addr_t)(sizeof(md_addr_t)-1),
+	       NULL, sizeof(md_addr_t), now, &udata, NULL);
+  return *(md_addr_t *)udata;
+}
+
 /* inst cache block miss handler function */
 static unsigned int			/* latency of block access */
 itlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
@@ -198,11 +491,15 @@ itlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
 {
   md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
 
+  /* a TLB block is never dirty, an eviction writes nothing back, so it
+     must not start a walk */
+  if (cmd == Write)
+    return 0;
+
   /* no real memory access, however, should have user data space attached */
   assert(phy_page_ptr);
 
-  /* fake translation, for now... */
-  *phy_page_ptr = 0;
+  *phy_page_ptr = tlb_miss(baddr, now);
 
   return /* access latency, ignored */1;
 }
@@ -217,25 +514,92 @@ dtlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
 {
   md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
 
+  /* a TLB block is never dirty, an eviction writes nothing back, so it
+     must not start a walk */
+  if (cmd == Write)
+    return 0;
+
+  /* no real memory access, however, should have user data space attached */
+  assert(phy_page_ptr);
+
+  *phy_page_ptr = tlb_miss(baddr, now);
+
+  return /* access latency, ignored */1;
+}
+
+/* second level TLB block miss handler function */
+static unsigned int			/* latency of block access */
+stlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
+	       md_addr_t baddr,		/* block address to access */
+	       int bsize,		/* size of block to access */
+	       struct cache_blk_t *blk,	/* ptr to block in upper level */
+	       tick_t now)		/* time of access */
+{
+  md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
+
+  /* a TLB block is never dirty, an eviction writes nothing back, so it
+     must not start a walk */
+  if (cmd == Write)
+    return 0;
+
   /* no real memory access, however, should have user data space attached */
   assert(phy_page_ptr);
 
-  /* fake translation, for now... */
-  *phy_page_ptr = 0;
+  *phy_page_ptr = tlb_walk(baddr, now);
 
   return /* access latency, ignored */1;
 }
 
 /* cache/TLB options */
 static char *cache_dl1_opt /* = "none" */;
+static char *cache_dl1_wpolicy_opt /* = "wb" */;
+static int cache_dl1_wbuf /* = 0 */;
+static int cache_dl1_walloc /* = TRUE */;
+static int cache_dl1_victim /* = 0 */;
+static char *cache_dl1_pf_opt /* = "none" */;
 static char *cache_dl2_opt /* = "none" */;
+static char *cache_dl2_wpolicy_opt /* = "wb" */;
+static int cache_dl2_wbuf /* = 0 */;
+static int cache_dl2_walloc /* = TRUE */;
+static int cache_dl2_victim /* = 0 */;
+static char *cache_dl2_pf_opt /* = "none" */;
 static char *cache_il1_opt /* = "none" */;
 static char *cache_il2_opt /* = "none" */;
 static char *itlb_opt /* = "none" */;
 static char *dtlb_opt /* = "none" */;
+static char *tlb_pt_opt /* = "none" */;
+static char *tlb_walk_opt /* = "dl1" */;
+static char *tlb_pwc_opt /* = "none" */;
+static char *tlb_stlb_opt /* = "none" */;
+static char *cache_pindex_opt /* = "none" */;
+static char *mem_palloc_opt /* = "seq" */;
+static int mem_pcolors /* = 0 */;
+static int cache_classify /* = FALSE */;
+static char *cache_reuse_opt /* = "none" */;
+static int cache_reuse_sample /* = 1 */;
+static int cache_sample /* = 1 */;
+static int cache_slices /* = 1 */;
 static int flush_on_syscalls /* = FALSE */;
 static int compress_icache_addrs /* = FALSE */;
 
+/* additional cache hierarchies */
+static int fanout_nelt = 0;
+static char *fanout_vars[MAX_FANOUT];
+static int fanout_threads /* = 0 */;
+
+/* reference trace options */
+static char *trace_out_opt /* = NULL */;
+static char *trace_in_opt /* = NULL */;
+
+/* reference trace being recorded, or replayed */
+static struct reftrace_t *trace_out = NULL;
+static struct reftrace_t *trace_in = NULL;
+
+/* warm state options */
+static char *warm_save_opt /* = NULL */;
+static char *warm_chkpt_opt /* = NULL */;
+static char *warm_load_opt /* = NULL */;
+
 /* text-based stat profiles */
 static int pcstat_nelt = 0;
 static char *pcstat_vars[MAX_PCSTAT_VARS];
@@ -274,20 +638,63 @@ sim_reg_options(struct opt_odb_t *odb)	/* options database */
   opt_reg_note(odb,
 "  The cache config parameter <config> has the following format:\n"
 "\n"
-"    <name>:<nsets>:<bsize>:<assoc>:<repl>\n"
+"    <name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]\n"
 "\n"
 "    <name>   - name of the cache being defined\n"
 "    <nsets>  - number of sets in the cache\n"
 "    <bsize>  - block size of the cache\n"
 "    <assoc>  - associativity of the cache\n"
-"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random\n"
+"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random,\n"
+"               't'-tree pseudo-LRU, 'b'-bit pseudo-LRU, 's'-SRRIP,\n"
+"               'i'-BRRIP, 'd'-DRRIP (set dueling SRRIP/BRRIP)\n"
+"    <index>  - set index function (caches only), 'b'-address bits (the\n"
+"               default), 'x'-bits XOR tag bits, 'p'-block address modulo\n"
+"               the largest prime <= <nsets>, 's'-skewed-associative, each\n"
+"               way with its own XOR hash (needs 'l', 'f' or 'r' <repl>)\n"
 "\n"
 "    Examples:   -cache:dl1 dl1:4096:32:1:l\n"
+"                -cache:dl1 dl1:128:32:4:l:s\n"
 "                -dtlb dtlb:128:4096:32:r\n"
 	       );
+  opt_reg_string(odb, "-cache:dl1:wpolicy",
+		 "l1 data cache write policy, i.e., {wb|wt} (wt = old default)",
+		 &cache_dl1_wpolicy_opt, "wb", /* print */TRUE, NULL);
+  opt_reg_int(odb, "-cache:dl1:wbuf",
+	      "l1 data cache write buffer entries (wt only, 0 = none)",
+	      &cache_dl1_wbuf, /* default */0, /* print */TRUE, NULL);
+  opt_reg_flag(odb, "-cache:dl1:walloc",
+	       "allocate l1 data cache blocks on write misses",
+	       &cache_dl1_walloc, /* default */TRUE, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-cache:dl1:victim",
+	      "l1 data cache victim buffer entries (0 = none)",
+	      &cache_dl1_victim, /* default */0, /* print */TRUE, NULL);
+  opt_reg_string(odb, "-cache:dl1:pf",
+		 "l1 data cache prefetcher, i.e., {none|<type>[:<degree>[:<distance>]]}",
+		 &cache_dl1_pf_opt, "none", /* print */TRUE, NULL);
   opt_reg_string(odb, "-cache:dl2",
 		 "l2 data cache config, i.e., {<config>|none}",
 		 &cache_dl2_opt, "ul2:1024:64:4:l", /* print */TRUE, NULL);
+  opt_reg_string(odb, "-cache:dl2:wpolicy",
+		 "l2 data cache write policy, i.e., {wb|wt} (wt = old default)",
+		 &cache_dl2_wpolicy_opt, "wb", /* print */TRUE, NULL);
+  opt_reg_int(odb, "-cache:dl2:wbuf",
+	      "l2 data cache write buffer entries (wt only, 0 = none)",
+	      &cache_dl2_wbuf, /* default */0, /* print */TRUE, NULL);
+  opt_reg_flag(odb, "-cache:dl2:walloc",
+	       "allocate l2 data cache blocks on write misses",
+	       &cache_dl2_walloc, /* default */TRUE, /* print */TRUE, NULL);
+  opt_reg_int(odb, "-cache:dl2:victim",
+	      "l2 data cache victim buffer entries (0 = none)",
+	      &cache_dl2_victim, /* default */0, /* print */TRUE, NULL);
+  opt_reg_string(odb, "-cache:dl2:pf",
+		 "l2 data cache prefetcher, i.e., {none|<type>[:<degree>[:<distance>]]}",
+		 &cache_dl2_pf_opt, "none", /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  The prefetcher <type> is nextline (tagged next-line), stride (PC-indexed\n"
+"  stride table) or stream (multi-stream detector), up to <degree> (default\n"
+"  1) blocks are prefetched per trigger, starting <distance> (default 1)\n"
+"  strides ahead of the triggering access, e.g., -cache:dl1:pf stride:2:4\n"
+	       );
   opt_reg_string(odb, "-cache:il1",
 		 "l1 inst cache config, i.e., {<config>|dl1|dl2|none}",
 		 &cache_il1_opt, "il1:256:32:1:l", /* print */TRUE, NULL);
@@ -313,6 +720,102 @@ sim_reg_options(struct opt_odb_t *odb)	/* options database */
   opt_reg_string(odb, "-tlb:dtlb",
 		 "data TLB config, i.e., {<config>|none}",
 		 &dtlb_opt, "dtlb:32:4096:4:l", /* print */TRUE, NULL);
+  opt_reg_string(odb, "-tlb:pt",
+		 "page table walked on TLB misses, i.e., {<levels>|none}",
+		 &tlb_pt_opt, "none", /* print */TRUE, NULL);
+  opt_reg_string(odb, "-tlb:walkcache",
+		 "cache the page walker reads PTEs through, i.e., "
+		 "{dl1|dl2|none}",
+		 &tlb_walk_opt, "dl1", /* print */TRUE, NULL);
+  opt_reg_string(odb, "-tlb:pwc",
+		 "page walk cache config, i.e., {<config>|none}",
+		 &tlb_pwc_opt, "none", /* print */TRUE, NULL);
+  opt_reg_string(odb, "-tlb:stlb",
+		 "second level TLB config, i.e., {<config>|none}",
+		 &tlb_stlb_opt, "none", /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  By default TLB misses translate every page to physical page 0.  With\n"
+"  -tlb:pt, misses walk a page table of <levels> levels (0 for as many as\n"
+"  the address space needs), physical pages are assigned in order of first\n"
+"  touch, and the PTE of each level is read through -tlb:walkcache, so page\n"
+"  walks show up in the data cache stats.  The upper level PTEs may be held\n"
+"  in a page walk cache (-tlb:pwc, e.g., pwc:1:8:16:l for 16 8-byte blocks)\n"
+"  and the I- and D-TLBs may share a second level TLB that is looked up\n"
+"  before walking (-tlb:stlb, e.g., stlb:128:4096:4:l).\n"
+	       );
+  opt_reg_string(odb, "-cache:pindex",
+		 "physically indexed caches, i.e., {none|l2|all}",
+		 &cache_pindex_opt, "none", /* print */TRUE, NULL);
+  opt_reg_string(odb, "-mem:palloc",
+		 "physical page allocation policy, i.e., {seq|random|color}",
+		 &mem_palloc_opt, "seq", /* print */TRUE, NULL);
+  opt_reg_int(odb, "-mem:pcolors",
+	      "page colors of the color policy (0 = sets of the L2 per page)",
+	      &mem_pcolors, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_note(odb,
+"  By default all caches are indexed and tagged with virtual addresses.\n"
+"  With -cache:pindex l2, the L2 caches see physical addresses, with\n"
+"  -cache:pindex all, the L1 caches do too.  Physical pages are assigned on\n"
+"  first touch by -mem:palloc, which also maps the pages of -tlb:pt: seq\n"
+"  numbers them in order, random draws them at random, and color gives each\n"
+"  virtual page the next physical page of its own color (VPN modulo\n"
+"  -mem:pcolors), e.g., to compare allocation policies in one run,\n"
+"\n"
+"    -cache:pindex l2 -fanout palloc=random -fanout palloc=color\n"
+	       );
+  opt_reg_flag(odb, "-cache:classify",
+	       "classify cache misses as compulsory, capacity or conflict",
+	       &cache_classify, /* default */FALSE, /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  With -cache:classify, each cache and TLB runs a fully-associative LRU\n"
+"  shadow cache of the same capacity next to it.  A miss to a block never\n"
+"  touched before is compulsory, else a miss of the shadow cache too is a\n"
+"  capacity miss, else it is a conflict miss, see <cache>.compulsory_misses,\n"
+"  <cache>.capacity_misses and <cache>.conflict_misses.  The shadow cache\n"
+"  is flushed and invalidated with its cache, but remembers the blocks\n"
+"  touched, so a miss after a flush is a capacity miss.\n"
+	       );
+  opt_reg_string(odb, "-cache:reuse",
+		 "profile reuse distances of cache, i.e., {none|dl1|dl2|il1|il2|all}",
+		 &cache_reuse_opt, "none", /* print */TRUE, NULL);
+  opt_reg_int(odb, "-cache:reuse:sample",
+	      "reuse profiler samples 1 in <n> blocks (a power of two)",
+	      &cache_reuse_sample, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_note(odb,
+"  With -cache:reuse, the accesses to a cache (or all its caches) are\n"
+"  profiled for their reuse distance, the number of distinct blocks\n"
+"  accessed since the last access to the same block, in blocks of the\n"
+"  cache.  <cache>.reuse_dist is the distribution of the distances, and\n"
+"  the cdf of <cache>.mrc is the miss ratio curve, the miss rate of a\n"
+"  fully-associative LRU cache of every size, e.g., to size the L2 cache,\n"
+"\n"
+"    -cache:reuse dl2 -cache:reuse:sample 64\n"
+"\n"
+"  With -cache:reuse:sample <n>, only 1 in <n> blocks, chosen by a hash of\n"
+"  their address, are profiled (SHARDS sampling), which cuts the memory\n"
+"  and time of the profile by about <n>, the curve is then only accurate\n"
+"  for caches of many more than <n> blocks.\n"
+	       );
+  opt_reg_int(odb, "-cache:sample",
+	      "L2 caches model 1 in <n> sets (a power of two)",
+	      &cache_sample, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_note(odb,
+"  With -cache:sample <n>, the L2 caches only model 1 in <n> of their sets,\n"
+"  chosen by a hash of the set index, the references to the other sets are\n"
+"  skipped, which cuts the memory and time of a large L2 cache by about\n"
+"  <n>.  <cache>.miss_rate is then the miss rate of the sets modelled,\n"
+"  <cache>.miss_rate_ci its 95% confidence interval as an estimate of the\n"
+"  miss rate of the cache, <cache>.est_misses and <cache>.est_writebacks\n"
+"  extrapolate to all sets, e.g., to compare 8MB and 16MB L2 caches,\n"
+"\n"
+"    -cache:dl2 ul2:16384:64:8:l -cache:sample 32 -fanout dl2=ul2:32768:64:8:l\n"
+"\n"
+"  Write buffers, victim buffers and prefetchers of a sampled cache only\n"
+"  see the references to the sets modelled.\n"
+	       );
   opt_reg_flag(odb, "-flush", "flush caches on system calls",
 	       &flush_on_syscalls, /* default */FALSE, /* print */TRUE, NULL);
   opt_reg_flag(odb, "-cache:icompress",
@@ -320,6 +823,111 @@ sim_reg_options(struct opt_odb_t *odb)	/* options database */
 	       &compress_icache_addrs, /* default */FALSE,
 	       /* print */TRUE, NULL);
 
+  opt_reg_string_list(odb, "-fanout",
+		      "additional cache hierarchy config(s) (mult uses ok)",
+		      fanout_vars, MAX_FANOUT, &fanout_nelt, NULL,
+		      /* print */TRUE, /* format */NULL, /* accrue */TRUE);
+  opt_reg_note(odb,
+"  Each -fanout argument instantiates one more cache hierarchy, all\n"
+"  hierarchies see the same instruction and data references, so a sweep of\n"
+"  configurations costs a single functional execution.  The argument is a\n"
+"  comma-separated list of <level>=<config> overrides of the base hierarchy,\n"
+"  <level> is one of dl1, dl1:wpolicy, dl1:wbuf, dl1:walloc, dl1:victim,\n"
+"  dl1:pf, dl2, dl2:wpolicy, dl2:wbuf, dl2:walloc, dl2:victim, dl2:pf, il1,\n"
+"  il2, itlb, dtlb, pt, walkcache, pwc, stlb, pindex, palloc, pcolors,\n"
+"  classify, reuse, sample or slices (walloc and classify take true or\n"
+"  false).  Every setting not overridden is inherited from the base\n"
+"  hierarchy, e.g., the -cache:dl1:victim buffer, use dl1:victim=0 for a\n"
+"  hierarchy without it.  The caches of the N'th additional hierarchy are\n"
+"  named cfgN.<name>, e.g.,\n"
+"\n"
+"    -fanout dl1=dl1:256:64:2:l -fanout dl1=dl1:128:32:4:f,dl1:wpolicy=wt\n"
+	       );
+
+  opt_reg_int(odb, "-fanout:threads",
+	      "host threads simulating the cache hierarchies (0 = none)",
+	      &fanout_threads, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_note(odb,
+"  With -fanout:threads <n>, the cache hierarchies are divided among <n>\n"
+"  host threads (at most one per hierarchy) that consume the reference\n"
+"  stream in chunks, while the main thread only executes the program.\n"
+"  Results are identical to those of a run without threads, the cache\n"
+"  stats are only up to date on system calls, so -pcstat cannot be used.\n"
+	       );
+
+  opt_reg_int(odb, "-cache:slices",
+	      "simulate the L1 caches and TLBs in <n> slices of their sets",
+	      &cache_slices, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_note(odb,
+"  With -cache:slices <n>, the sets of each L1 cache and TLB are divided\n"
+"  among <n> slices (a power of two, at most the number of sets), chosen\n"
+"  by a hash of the set index, and each slice is simulated as a hierarchy\n"
+"  of its own, so -fanout:threads divides the slices among the threads,\n"
+"  e.g., to simulate one large configuration on 4 host threads,\n"
+"\n"
+"    -cache:dl1 dl1:65536:64:8:l -cache:dl2 none -cache:il2 none\n"
+"      -cache:slices 4 -fanout:threads 4\n"
+"\n"
+"  The sets of a cache do not interact, so the stats of the slices, which\n"
+"  are merged on system calls and at the end of the run, are those of a\n"
+"  run without slices.  The hierarchy may not have L2 caches, page walks,\n"
+"  second level TLBs, physically indexed caches, write buffers, victim\n"
+"  buffers, prefetchers, -cache:classify, -cache:reuse or random, BRRIP\n"
+"  and DRRIP replacement.\n"
+	       );
+
+  opt_reg_string(odb, "-trace:out",
+		 "record cache references to reference trace file",
+		 &trace_out_opt, /* default */NULL,
+		 /* print */TRUE, NULL);
+  opt_reg_string(odb, "-trace:in",
+		 "replay cache references from reference trace file",
+		 &trace_in_opt, /* default */NULL,
+		 /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  A reference trace holds every reference made to the caches, including\n"
+"  the flushes made by -flush, in a compact binary format (compressed with\n"
+"  gzip if the file name ends in .gz).  With -trace:in, the program is\n"
+"  loaded but not executed, the traced references are fed to the caches\n"
+"  instead, so the -flush and -cache:icompress settings of the recording\n"
+"  run apply.  A replay feeds each TLB and L1 cache its references in\n"
+"  batches, with the L1 misses made to the L2 caches in reference order,\n"
+"  hierarchies with page walks, second level TLBs, write buffers, L2\n"
+"  prefetchers or shared L1 caches are replayed one reference at a time.\n"
+	       );
+
+  opt_reg_string(odb, "-warm:save",
+		 "save warm cache, TLB and page table state at end of run",
+		 &warm_save_opt, /* default */NULL,
+		 /* print */TRUE, NULL);
+  opt_reg_string(odb, "-warm:chkpt",
+		 "write EIO checkpoint of program state with -warm:save",
+		 &warm_chkpt_opt, /* default */NULL,
+		 /* print */TRUE, NULL);
+  opt_reg_string(odb, "-warm:load",
+		 "start from warm cache, TLB and page table state in file",
+		 &warm_load_opt, /* default */NULL,
+		 /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  A warm state file (see warm.h) holds the blocks and replacement state\n"
+"  of the caches and TLBs, and the page tables, of every hierarchy at the\n"
+"  end of a run, e.g., one stopped by -max:inst, so later runs can start\n"
+"  from warm caches at that point of the program.  With -warm:chkpt, an EIO\n"
+"  checkpoint of the program state at that point is written too, so that\n"
+"  sim-cache or sim-outorder runs restoring it with -chkpt can load the warm\n"
+"  state with -warm:load, e.g.,\n"
+"\n"
+"    sim-cache -max:inst 100000000 -warm:save w.gz -warm:chkpt c.eio p.eio\n"
+"    sim-outorder -chkpt c.eio -warm:load w.gz p.eio\n"
+"\n"
+"  The warm state must be loaded at the point it was saved, each cache, TLB\n"
+"  or page table is restored from the state saved under its name, and must\n"
+"  be organized like the one saved, those not in the file start cold.\n"
+"  Hierarchies simulated in slices cannot be saved or loaded.\n"
+	       );
+
   opt_reg_string_list(odb, "-pcstat",
 		      "profile stat(s) against text addr's (mult uses ok)",
 		      pcstat_vars, MAX_PCSTAT_VARS, &pcstat_nelt, NULL,
@@ -327,136 +935,609 @@ sim_reg_options(struct opt_odb_t *odb)	/* options database */
 
 }
 
-/* check simulator-specific option values */
-void
-sim_check_options(struct opt_odb_t *odb,	/* options database */
-		  int argc, char **argv)	/* command line arguments */
+/* return the name of cache NAME within hierarchy H */
+static char *
+hier_name(struct cache_hier_t *h, char *name)
+{
+  static char buf[256];
+
+  sprintf(buf, "%s%s", h->prefix, name);
+  return buf;
+}
+
+/* profile the reuse distances of the accesses to cache CP, the LEVEL
+   cache of its hierarchy, if not NULL it must exist */
+static void
+hier_reuse(struct cache_t *cp,		/* cache to profile */
+	   char *level)			/* level of cache */
+{
+  if (!cp)
+    fatal("cannot profile the %s cache as it's undefined", level);
+  cache_set_reuse(cp, reuse_create(cp->name, cp->bsize, cache_reuse_sample));
+}
+
+/* can hierarchy H be simulated in slices?  the sets of its caches and
+   TLBs must not see each other, so it may only have L1 caches and TLBs,
+   without buffers or prefetchers shared by the sets, and with replacement
+   that only depends on the accesses to the set */
+static int
+hier_sliceable(struct cache_hier_t *h)
+{
+  struct cache_t *caches[] = { h->il1, h->dl1, h->itlb, h->dtlb };
+  int i;
+
+  if (h->dl2 || h->il2 || h->pt || h->pwc || h->stlb
+      || h->pindex != pindex_none || h->classify
+      || mystricmp(h->reuse_opt, "none"))
+    return FALSE;
+
+  for (i=0; i<N_ELT(caches); i++)
+    {
+      if (!caches[i])
+	continue;
+      if (caches[i]->wbuf_size || caches[i]->victim_size || caches[i]->pf)
+	return FALSE;
+      if (caches[i]->policy == Random || caches[i]->policy == BRRIP
+	  || caches[i]->policy == DRRIP)
+	return FALSE;
+    }
+  return TRUE;
+}
+
+/* instantiate the caches and TLBs of hierarchy H */
+static void
+hier_create(struct cache_hier_t *h)
 {
-  char name[128], c;
+  char name[128], c, ix;
   int nsets, bsize, assoc;
 
   /* use a level 1 D-cache? */
-  if (!mystricmp(cache_dl1_opt, "none"))
+  if (!mystricmp(h->dl1_opt, "none"))
     {
-      cache_dl1 = NULL;
+      h->dl1 = NULL;
 
       /* the level 2 D-cache cannot be defined */
-      if (strcmp(cache_dl2_opt, "none"))
+      if (strcmp(h->dl2_opt, "none"))
 	fatal("the l1 data cache must defined if the l2 cache is defined");
-      cache_dl2 = NULL;
+      h->dl2 = NULL;
     }
   else /* dl1 is defined */
     {
-      if (sscanf(cache_dl1_opt, "%[^:]:%d:%d:%d:%c",
-		 name, &nsets, &bsize, &assoc, &c) != 5)
-	fatal("bad l1 D-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>");
-      cache_dl1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
-			       /* usize */0, assoc, cache_char2policy(c),
-			       dl1_access_fn, /* hit latency */1);
+      ix = 'b';
+      if (sscanf(h->dl1_opt, "%[^:]:%d:%d:%d:%c:%c",
+		 name, &nsets, &bsize, &assoc, &c, &ix) < 5)
+	fatal("bad l1 D-cache parms: "
+	      "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]");
+      h->dl1 = cache_create(hier_name(h, name), nsets, bsize,
+			     /* balloc */FALSE, /* usize */0, assoc,
+			     cache_char2policy(c),
+			     cache_str2wpolicy(h->dl1_wpolicy_opt),
+			     dl1_access_fn, /* hit latency */1,
+			     /* sample */h->slices);
+      cache_set_index(h->dl1, cache_char2index(ix));
+      if (h->dl1_wbuf)
+	cache_set_wbuf(h->dl1, h->dl1_wbuf);
+      cache_set_walloc(h->dl1, h->dl1_walloc);
+      if (h->dl1_victim)
+	cache_set_victim(h->dl1, h->dl1_victim, /* swap latency */1);
+      cache_set_prefetch(h->dl1, prefetch_parse(h->dl1_pf_opt, h->dl1));
 
       /* is the level 2 D-cache defined? */
-      if (!mystricmp(cache_dl2_opt, "none"))
-	cache_dl2 = NULL;
+      if (!mystricmp(h->dl2_opt, "none"))
+	h->dl2 = NULL;
       else
 	{
-	  if (sscanf(cache_dl2_opt, "%[^:]:%d:%d:%d:%c",
-		     name, &nsets, &bsize, &assoc, &c) != 5)
+	  ix = 'b';
+	  if (sscanf(h->dl2_opt, "%[^:]:%d:%d:%d:%c:%c",
+		     name, &nsets, &bsize, &assoc, &c, &ix) < 5)
 	    fatal("bad l2 D-cache parms: "
-		  "<name>:<nsets>:<bsize>:<assoc>:<repl>");
-	  cache_dl2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
-				   /* usize */0, assoc, cache_char2policy(c),
-				   dl2_access_fn, /* hit latency */1);
+		  "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]");
+	  h->dl2 = cache_create(hier_name(h, name), nsets, bsize,
+				 /* balloc */FALSE, /* usize */0, assoc,
+				 cache_char2policy(c),
+				 cache_str2wpolicy(h->dl2_wpolicy_opt),
+				 dl2_access_fn, /* hit latency */1,
+				 /* sample */h->sample);
+	  cache_set_index(h->dl2, cache_char2index(ix));
+	  if (h->dl2_wbuf)
+	    cache_set_wbuf(h->dl2, h->dl2_wbuf);
+	  cache_set_walloc(h->dl2, h->dl2_walloc);
+	  if (h->dl2_victim)
+	    cache_set_victim(h->dl2, h->dl2_victim, /* swap latency */1);
+	  cache_set_prefetch(h->dl2, prefetch_parse(h->dl2_pf_opt, h->dl2));
 	}
     }
 
   /* use a level 1 I-cache? */
-  if (!mystricmp(cache_il1_opt, "none"))
+  if (!mystricmp(h->il1_opt, "none"))
     {
-      cache_il1 = NULL;
+      h->il1 = NULL;
 
       /* the level 2 I-cache cannot be defined */
-      if (strcmp(cache_il2_opt, "none"))
+      if (strcmp(h->il2_opt, "none"))
 	fatal("the l1 inst cache must defined if the l2 cache is defined");
-      cache_il2 = NULL;
+      h->il2 = NULL;
     }
-  else if (!mystricmp(cache_il1_opt, "dl1"))
+  else if (!mystricmp(h->il1_opt, "dl1"))
     {
-      if (!cache_dl1)
+      if (!h->dl1)
 	fatal("I-cache l1 cannot access D-cache l1 as it's undefined");
-      cache_il1 = cache_dl1;
+      h->il1 = h->dl1;
 
       /* the level 2 I-cache cannot be defined */
-      if (strcmp(cache_il2_opt, "none"))
+      if (strcmp(h->il2_opt, "none"))
 	fatal("the l1 inst cache must defined if the l2 cache is defined");
-      cache_il2 = NULL;
+      h->il2 = NULL;
     }
-  else if (!mystricmp(cache_il1_opt, "dl2"))
+  else if (!mystricmp(h->il1_opt, "dl2"))
     {
-      if (!cache_dl2)
+      if (!h->dl2)
 	fatal("I-cache l1 cannot access D-cache l2 as it's undefined");
-      cache_il1 = cache_dl2;
+      h->il1 = h->dl2;
 
       /* the level 2 I-cache cannot be defined */
-      if (strcmp(cache_il2_opt, "none"))
+      if (strcmp(h->il2_opt, "none"))
 	fatal("the l1 inst cache must defined if the l2 cache is defined");
-      cache_il2 = NULL;
+      h->il2 = NULL;
     }
   else /* il1 is defined */
     {
-      if (sscanf(cache_il1_opt, "%[^:]:%d:%d:%d:%c",
-		 name, &nsets, &bsize, &assoc, &c) != 5)
-	fatal("bad l1 I-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>");
-      cache_il1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
-			       /* usize */0, assoc, cache_char2policy(c),
-			       il1_access_fn, /* hit latency */1);
+      ix = 'b';
+      if (sscanf(h->il1_opt, "%[^:]:%d:%d:%d:%c:%c",
+		 name, &nsets, &bsize, &assoc, &c, &ix) < 5)
+	fatal("bad l1 I-cache parms: "
+	      "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]");
+      h->il1 = cache_create(hier_name(h, name), nsets, bsize,
+			     /* balloc */FALSE, /* usize */0, assoc,
+			     cache_char2policy(c),
+			     /* wpolicy */WriteBack,
+			     il1_access_fn, /* hit latency */1,
+			     /* sample */h->slices);
+      cache_set_index(h->il1, cache_char2index(ix));
 
       /* is the level 2 D-cache defined? */
-      if (!mystricmp(cache_il2_opt, "none"))
-	cache_il2 = NULL;
-      else if (!mystricmp(cache_il2_opt, "dl2"))
+      if (!mystricmp(h->il2_opt, "none"))
+	h->il2 = NULL;
+      else if (!mystricmp(h->il2_opt, "dl2"))
 	{
-	  if (!cache_dl2)
+	  if (!h->dl2)
 	    fatal("I-cache l2 cannot access D-cache l2 as it's undefined");
-	  cache_il2 = cache_dl2;
+	  h->il2 = h->dl2;
 	}
       else
 	{
-	  if (sscanf(cache_il2_opt, "%[^:]:%d:%d:%d:%c",
-		     name, &nsets, &bsize, &assoc, &c) != 5)
+	  ix = 'b';
+	  if (sscanf(h->il2_opt, "%[^:]:%d:%d:%d:%c:%c",
+		     name, &nsets, &bsize, &assoc, &c, &ix) < 5)
 	    fatal("bad l2 I-cache parms: "
-		  "<name>:<nsets>:<bsize>:<assoc>:<repl>");
-	  cache_il2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
-				   /* usize */0, assoc, cache_char2policy(c),
-				   il2_access_fn, /* hit latency */1);
+		  "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]");
+	  h->il2 = cache_create(hier_name(h, name), nsets, bsize,
+				 /* balloc */FALSE, /* usize */0, assoc,
+				 cache_char2policy(c),
+				 /* wpolicy */WriteBack,
+				 il2_access_fn, /* hit latency */1,
+				 /* sample */h->sample);
+	  cache_set_index(h->il2, cache_char2index(ix));
 	}
     }
 
+  if (h->sample > 1 && !h->dl2 && !h->il2)
+    fatal("set sampling needs an L2 cache, see -cache:dl2 and -cache:il2");
+
   /* use an I-TLB? */
-  if (!mystricmp(itlb_opt, "none"))
-    itlb = NULL;
+  if (!mystricmp(h->itlb_opt, "none"))
+    h->itlb = NULL;
   else
     {
-      if (sscanf(itlb_opt, "%[^:]:%d:%d:%d:%c",
+      if (sscanf(h->itlb_opt, "%[^:]:%d:%d:%d:%c",
 		 name, &nsets, &bsize, &assoc, &c) != 5)
 	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>");
-      itlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
-			  /* usize */sizeof(md_addr_t), assoc,
-			  cache_char2policy(c), itlb_access_fn,
-			  /* hit latency */1);
+      h->itlb = cache_create(hier_name(h, name), nsets, bsize,
+			      /* balloc */FALSE, /* usize */sizeof(md_addr_t),
+			      assoc, cache_char2policy(c),
+			      /* wpolicy */WriteBack,
+			      itlb_access_fn, /* hit latency */1,
+			      /* sample */h->slices);
     }
 
   /* use a D-TLB? */
-  if (!mystricmp(dtlb_opt, "none"))
-    dtlb = NULL;
+  if (!mystricmp(h->dtlb_opt, "none"))
+    h->dtlb = NULL;
+  else
+    {
+      if (sscanf(h->dtlb_opt, "%[^:]:%d:%d:%d:%c",
+		 name, &nsets, &bsize, &assoc, &c) != 5)
+	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>");
+      h->dtlb = cache_create(hier_name(h, name), nsets, bsize,
+			      /* balloc */FALSE, /* usize */sizeof(md_addr_t),
+			      assoc, cache_char2policy(c),
+			      /* wpolicy */WriteBack,
+			      dtlb_access_fn, /* hit latency */1,
+			      /* sample */h->slices);
+    }
+
+  /* use a page table? */
+  if (!mystricmp(h->pt_opt, "none"))
+    h->pt = NULL;
+  else
+    {
+      int levels;
+
+      if (sscanf(h->pt_opt, "%d", &levels) != 1)
+	fatal("bad page table levels `%s', use <levels> or none", h->pt_opt);
+      h->pt = pt_create(hier_name(h, "pt"), levels);
+
+      if (!mystricmp(h->walk_opt, "none"))
+	h->walk_cache = NULL;
+      else if (!mystricmp(h->walk_opt, "dl1"))
+	{
+	  if (!h->dl1)
+	    fatal("page walker cannot read through dl1 as it's undefined");
+	  h->walk_cache = h->dl1;
+	}
+      else if (!mystricmp(h->walk_opt, "dl2"))
+	{
+	  if (!h->dl2)
+	    fatal("page walker cannot read through dl2 as it's undefined");
+	  h->walk_cache = h->dl2;
+	}
+      else
+	fatal("bad page walk cache `%s', use dl1, dl2 or none", h->walk_opt);
+    }
+
+  /* use physically indexed caches? */
+  if (!mystricmp(h->pindex_opt, "none"))
+    h->pindex = pindex_none;
+  else if (!mystricmp(h->pindex_opt, "l2"))
+    h->pindex = pindex_l2;
+  else if (!mystricmp(h->pindex_opt, "all"))
+    h->pindex = pindex_all;
+  else
+    fatal("bad physically indexed caches `%s', use none, l2 or all",
+	  h->pindex_opt);
+
+  /* map pages for the page table and the physically indexed caches */
+  h->pmap = h->pt;
+  if (!h->pmap && h->pindex != pindex_none)
+    h->pmap = pt_create(hier_name(h, "pmap"), /* levels */0);
+  if (h->pmap)
+    {
+      enum pt_alloc_t alloc = pt_parse_alloc(h->palloc_opt);
+      struct cache_t *cp = h->dl2 ? h->dl2 : h->dl1;
+      int colors = h->pcolors;
+
+      if (colors < 0)
+	fatal("number of page colors must be non-negative");
+      if (alloc == pt_color && !colors)
+	{
+	  if (!cp)
+	    fatal("page coloring without caches needs -mem:pcolors");
+	  colors = MAX(cp->nsets * cp->bsize / MD_PAGE_SIZE, 1);
+	}
+      pt_set_alloc(h->pmap, alloc, colors);
+    }
+
+  /* use a page walk cache? */
+  if (!mystricmp(h->pwc_opt, "none"))
+    h->pwc = NULL;
   else
     {
-      if (sscanf(dtlb_opt, "%[^:]:%d:%d:%d:%c",
+      if (!h->pt)
+	fatal("the page walk cache needs a page table, see -tlb:pt");
+      if (sscanf(h->pwc_opt, "%[^:]:%d:%d:%d:%c",
+		 name, &nsets, &bsize, &assoc, &c) != 5)
+	fatal("bad page walk cache parms: "
+	      "<name>:<nsets>:<bsize>:<assoc>:<repl>");
+      if (h->walk_cache && bsize > h->walk_cache->bsize)
+	fatal("page walk cache blocks must fit in `%s' blocks",
+	      h->walk_cache->name);
+      h->pwc = cache_create(hier_name(h, name), nsets, bsize,
+			     /* balloc */FALSE, /* usize */0, assoc,
+			     cache_char2policy(c), /* wpolicy */WriteBack,
+			     pwc_access_fn, /* hit latency */1,
+			     /* sample */1);
+    }
+
+  /* use a second level TLB? */
+  if (!mystricmp(h->stlb_opt, "none"))
+    h->stlb = NULL;
+  else
+    {
+      if (sscanf(h->stlb_opt, "%[^:]:%d:%d:%d:%c",
 		 name, &nsets, &bsize, &assoc, &c) != 5)
 	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>");
-      dtlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
-			  /* usize */sizeof(md_addr_t), assoc,
-			  cache_char2policy(c), dtlb_access_fn,
-			  /* hit latency */1);
+      h->stlb = cache_create(hier_name(h, name), nsets, bsize,
+			      /* balloc */FALSE, /* usize */sizeof(md_addr_t),
+			      assoc, cache_char2policy(c),
+			      /* wpolicy */WriteBack,
+			      stlb_access_fn, /* hit latency */1,
+			      /* sample */1);
+    }
+
+  /* classify the misses of all caches and TLBs? */
+  if (h->classify)
+    {
+      struct cache_t *caches[] = {
+	h->il1, h->il2, h->dl1, h->dl2, h->itlb, h->dtlb, h->pwc, h->stlb
+      };
+      int i, j;
+
+      for (i=0; i<N_ELT(caches); i++)
+	{
+	  /* shared caches get one shadow */
+	  for (j=0; j<i && caches[j] != caches[i]; j++)
+	    /* nada */;
+	  if (caches[i] && j == i)
+	    cache_set_classify(caches[i], TRUE);
+	}
+    }
+
+  /* profile the reuse distances of the accesses to a cache? */
+  if (!mystricmp(h->reuse_opt, "none"))
+    /* nada */;
+  else if (!mystricmp(h->reuse_opt, "dl1"))
+    hier_reuse(h->dl1, "dl1");
+  else if (!mystricmp(h->reuse_opt, "dl2"))
+    hier_reuse(h->dl2, "dl2");
+  else if (!mystricmp(h->reuse_opt, "il1"))
+    hier_reuse(h->il1, "il1");
+  else if (!mystricmp(h->reuse_opt, "il2"))
+    hier_reuse(h->il2, "il2");
+  else if (!mystricmp(h->reuse_opt, "all"))
+    {
+      struct cache_t *caches[] = { h->il1, h->il2, h->dl1, h->dl2 };
+      int i;
+
+      for (i=0; i<N_ELT(caches); i++)
+	if (caches[i] && !caches[i]->reuse)
+	  hier_reuse(caches[i], NULL);
+    }
+  else
+    fatal("bad reuse profiled cache `%s', use none, dl1, dl2, il1, il2 or all",
+	  h->reuse_opt);
+
+  /* simulate the hierarchy in slices? */
+  if (h->slices > 1)
+    {
+      if (!hier_sliceable(h))
+	fatal("cache hierarchy `%s' cannot be simulated in slices, see "
+	      "-cache:slices", *h->prefix ? h->prefix : "base");
+      if (h->dl1)
+	cache_set_slice(h->dl1, h->slice, h->slices);
+      if (h->il1 && h->il1 != h->dl1)
+	cache_set_slice(h->il1, h->slice, h->slices);
+      if (h->itlb)
+	cache_set_slice(h->itlb, h->slice, h->slices);
+      if (h->dtlb)
+	cache_set_slice(h->dtlb, h->slice, h->slices);
+    }
+}
+
+/* create the slices of hierarchy H, which is simulated in slices */
+static void
+hier_slice(struct cache_hier_t *h)
+{
+  int i;
+
+  h->slice_hiers = (struct cache_hier_t *)
+    calloc(h->slices, sizeof(struct cache_hier_t));
+  if (!h->slice_hiers)
+    fatal("out of virtual memory");
+
+  for (i=0; i<h->slices; i++)
+    {
+      h->slice_hiers[i] = *h;
+      h->slice_hiers[i].slice = i;
+      h->slice_hiers[i].slice_hiers = NULL;
+      hier_create(&h->slice_hiers[i]);
+    }
+}
+
+/* set the stats of the caches and TLBs of hierarchy H, simulated in
+   slices, to the totals of its slices */
+static void
+hier_merge(struct cache_hier_t *h)
+{
+  struct cache_t *slices[MAX_SLICES];
+  int i;
+
+#define HIER_MERGE(LEVEL)						\
+  do {									\
+    for (i=0; i<h->slices; i++)						\
+      slices[i] = h->slice_hiers[i].LEVEL;				\
+    cache_merge_slices(h->LEVEL, slices, h->slices);			\
+  } while (0)
+
+  if (h->dl1)
+    HIER_MERGE(dl1);
+  if (h->il1 && h->il1 != h->dl1)
+    HIER_MERGE(il1);
+  if (h->itlb)
+    HIER_MERGE(itlb);
+  if (h->dtlb)
+    HIER_MERGE(dtlb);
+
+#undef HIER_MERGE
+}
+
+/* set hierarchy H to the base configuration with the overrides in the
+   fanout argument ARG applied, i.e., <level>=<config>[,<level>=<config>] */
+static void
+hier_parse_fanout(struct cache_hier_t *h, char *arg)
+{
+  char *s, *level, *config;
+
+  *h = hiers[0];
+  for (s=strtok(mystrdup(arg), ","); s; s=strtok(NULL, ","))
+    {
+      level = s;
+      config = strchr(s, '=');
+      if (!config)
+	fatal("bad fanout config `%s', use <level>=<config>", s);
+      *config++ = '\0';
+
+      if (!mystricmp(level, "dl1"))
+	h->dl1_opt = config;
+      else if (!mystricmp(level, "dl1:wpolicy"))
+	h->dl1_wpolicy_opt = config;
+      else if (!mystricmp(level, "dl1:wbuf"))
+	h->dl1_wbuf = atoi(config);
+      else if (!mystricmp(level, "dl1:walloc"))
+	h->dl1_walloc = !!mystricmp(config, "false");
+      else if (!mystricmp(level, "dl1:victim"))
+	h->dl1_victim = atoi(config);
+      else if (!mystricmp(level, "dl1:pf"))
+	h->dl1_pf_opt = config;
+      else if (!mystricmp(level, "dl2"))
+	h->dl2_opt = config;
+      else if (!mystricmp(level, "dl2:wpolicy"))
+	h->dl2_wpolicy_opt = config;
+      else if (!mystricmp(level, "dl2:wbuf"))
+	h->dl2_wbuf = atoi(config);
+      else if (!mystricmp(level, "dl2:walloc"))
+	h->dl2_walloc = !!mystricmp(config, "false");
+      else if (!mystricmp(level, "dl2:victim"))
+	h->dl2_victim = atoi(config);
+      else if (!mystricmp(level, "dl2:pf"))
+	h->dl2_pf_opt = config;
+      else if (!mystricmp(level, "il1"))
+	h->il1_opt = config;
+      else if (!mystricmp(level, "il2"))
+	h->il2_opt = config;
+      else if (!mystricmp(level, "itlb"))
+	h->itlb_opt = config;
+      else if (!mystricmp(level, "dtlb"))
+	h->dtlb_opt = config;
+      else if (!mystricmp(level, "pt"))
+	h->pt_opt = config;
+      else if (!mystricmp(level, "walkcache"))
+	h->walk_opt = config;
+      else if (!mystricmp(level, "pwc"))
+	h->pwc_opt = config;
+      else if (!mystricmp(level, "stlb"))
+	h->stlb_opt = config;
+      else if (!mystricmp(level, "pindex"))
+	h->pindex_opt = config;
+      else if (!mystricmp(level, "palloc"))
+	h->palloc_opt = config;
+      else if (!mystricmp(level, "pcolors"))
+	h->pcolors = atoi(config);
+      else if (!mystricmp(level, "classify"))
+	h->classify = !!mystricmp(config, "false");
+      else if (!mystricmp(level, "reuse"))
+	h->reuse_opt = config;
+      else if (!mystricmp(level, "sample"))
+	h->sample = atoi(config);
+      else if (!mystricmp(level, "slices"))
+	h->slices = atoi(config);
+      else
+	fatal("bad fanout cache level `%s'", level);
+    }
+}
+
+/* check simulator-specific option values */
+void
+sim_check_options(struct opt_odb_t *odb,	/* options database */
+		  int argc, char **argv)	/* command line arguments */
+{
+  int i;
+  char buf[128];
+
+  /* the base hierarchy, its caches keep their configured names */
+  hiers[0].prefix = "";
+  hiers[0].dl1_opt = cache_dl1_opt;
+  hiers[0].dl1_wpolicy_opt = cache_dl1_wpolicy_opt;
+  hiers[0].dl1_wbuf = cache_dl1_wbuf;
+  hiers[0].dl1_walloc = cache_dl1_walloc;
+  hiers[0].dl1_victim = cache_dl1_victim;
+  hiers[0].dl1_pf_opt = cache_dl1_pf_opt;
+  hiers[0].dl2_opt = cache_dl2_opt;
+  hiers[0].dl2_wpolicy_opt = cache_dl2_wpolicy_opt;
+  hiers[0].dl2_wbuf = cache_dl2_wbuf;
+  hiers[0].dl2_walloc = cache_dl2_walloc;
+  hiers[0].dl2_victim = cache_dl2_victim;
+  hiers[0].dl2_pf_opt = cache_dl2_pf_opt;
+  hiers[0].il1_opt = cache_il1_opt;
+  hiers[0].il2_opt = cache_il2_opt;
+  hiers[0].itlb_opt = itlb_opt;
+  hiers[0].dtlb_opt = dtlb_opt;
+  hiers[0].pt_opt = tlb_pt_opt;
+  hiers[0].walk_opt = tlb_walk_opt;
+  hiers[0].pwc_opt = tlb_pwc_opt;
+  hiers[0].stlb_opt = tlb_stlb_opt;
+  hiers[0].pindex_opt = cache_pindex_opt;
+  hiers[0].palloc_opt = mem_palloc_opt;
+  hiers[0].pcolors = mem_pcolors;
+  hiers[0].classify = cache_classify;
+  hiers[0].reuse_opt = cache_reuse_opt;
+  hiers[0].sample = cache_sample;
+  hiers[0].slices = cache_slices;
+
+  /* additional hierarchies, their caches are named cfgN.<name> */
+  for (i=0; i<fanout_nelt; i++)
+    {
+      hier_parse_fanout(&hiers[i+1], fanout_vars[i]);
+      sprintf(buf, "cfg%d.", i+1);
+      hiers[i+1].prefix = mystrdup(buf);
+    }
+  n_hiers = fanout_nelt + 1;
+
+  for (i=0; i<n_hiers; i++)
+    {
+      if (hiers[i].slices <= 0 || hiers[i].slices > MAX_SLICES
+	  || (hiers[i].slices & (hiers[i].slices-1)) != 0)
+	fatal("number of slices must be a power of two, at most %d",
+	      MAX_SLICES);
+      hier_create(&hiers[i]);
+    }
+
+  /* the hierarchies simulated, with those in slices replaced by them */
+  sim_hiers = (struct cache_hier_t **)
+    calloc((MAX_FANOUT+1) * MAX_SLICES, sizeof(struct cache_hier_t *));
+  if (!sim_hiers)
+    fatal("out of virtual memory");
+  for (i=0; i<n_hiers; i++)
+    {
+      if (hiers[i].slices > 1)
+	{
+	  int j;
+
+	  hier_slice(&hiers[i]);
+	  for (j=0; j<hiers[i].slices; j++)
+	    sim_hiers[n_sim_hiers++] = &hiers[i].slice_hiers[j];
+	}
+      else
+	sim_hiers[n_sim_hiers++] = &hiers[i];
+    }
+
+  if (fanout_threads < 0)
+    fatal("number of fanout threads must be non-negative");
+  fanout_nworkers = MIN(fanout_threads, n_sim_hiers);
+
+  /* the stats of fanout threads and slices are only up to date after
+     fanout_drain(), -pcstat samples them after every instruction */
+  if (pcstat_nelt > 0 && (fanout_nworkers > 0 || n_sim_hiers > n_hiers))
+    fatal("-pcstat cannot be used with -fanout:threads or -cache:slices");
+
+  if (trace_out_opt && trace_in_opt)
+    fatal("cannot both record and replay a reference trace");
+  if (trace_out_opt)
+    trace_out = reftrace_open(trace_out_opt, /* writing */TRUE);
+  if (trace_in_opt)
+    trace_in = reftrace_open(trace_in_opt, /* writing */FALSE);
+
+  if (n_sim_hiers == 1 && !fanout_nworkers && !trace_out)
+    direct_hier = sim_hiers[0];
+
+  if (warm_chkpt_opt && !warm_save_opt)
+    fatal("-warm:chkpt needs -warm:save");
+  if (warm_chkpt_opt && trace_in)
+    fatal("cannot write a checkpoint of a reference trace replay");
+  if (warm_save_opt || warm_load_opt)
+    {
+      for (i=0; i<n_hiers; i++)
+	if (hiers[i].slices > 1)
+	  fatal("cannot save or load the warm state of a hierarchy in slices");
     }
 }
 
@@ -482,6 +1563,7 @@ cache_mstate_obj(FILE *stream,			/* output stream */
 		 struct mem_t *mem)		/* memory to access */
 {
   /* just dump intermediate stats */
+  fanout_drain();
   sim_print_stats(stream);
 
   /* no error */
@@ -497,6 +1579,9 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  if (warm_chkpt_opt && !sim_eio_fd)
+    fatal("checkpoints only supported while EIO tracing");
+
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, cache_mstate_obj);
 }
@@ -505,7 +1590,11 @@ sim_load_prog(char *fname,		/* program to load */
 void
 sim_aux_config(FILE *stream)		/* output stream */
 {
-  /* nada */
+  int i;
+
+  for (i=0; i<n_hiers; i++)
+    if (hiers[i].pmap)
+      pt_config(hiers[i].pmap, stream);
 }
 
 /* register simulator-specific statistics */
@@ -513,6 +1602,7 @@ void
 sim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
 {
   int i;
+  struct cache_hier_t *h;
 
   /* register baseline stats */
   stat_reg_counter(sdb, "sim_num_insn",
@@ -528,21 +1618,46 @@ sim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
 		   "simulation speed (in insts/sec)",
 		   "sim_num_insn / sim_elapsed_time", NULL);
 
-  /* register cache stats */
-  if (cache_il1
-      && (cache_il1 != cache_dl1 && cache_il1 != cache_dl2))
-    cache_reg_stats(cache_il1, sdb);
-  if (cache_il2
-      && (cache_il2 != cache_dl1 && cache_il2 != cache_dl2))
-    cache_reg_stats(cache_il2, sdb);
-  if (cache_dl1)
-    cache_reg_stats(cache_dl1, sdb);
-  if (cache_dl2)
-    cache_reg_stats(cache_dl2, sdb);
-  if (itlb)
-    cache_reg_stats(itlb, sdb);
-  if (dtlb)
-    cache_reg_stats(dtlb, sdb);
+  /* register reference trace stats */
+  if (trace_out || trace_in)
+    {
+      struct reftrace_t *t = trace_out ? trace_out : trace_in;
+
+      stat_reg_counter(sdb, "trace_num_refs",
+		       "total number of references traced",
+		       &t->refs, 0, NULL);
+      stat_reg_counter(sdb, "trace_num_bytes",
+		       "total number of bytes traced (before gzip)",
+		       &t->bytes, 0, NULL);
+      stat_reg_formula(sdb, "trace_bytes_per_ref",
+		       "bytes traced per reference",
+		       "trace_num_bytes / trace_num_refs", NULL);
+    }
+
+  /* register cache stats, one section per hierarchy */
+  for (h=hiers; h < hiers+n_hiers; h++)
+    {
+      if (h->il1
+	  && (h->il1 != h->dl1 && h->il1 != h->dl2))
+	cache_reg_stats(h->il1, sdb);
+      if (h->il2
+	  && (h->il2 != h->dl1 && h->il2 != h->dl2))
+	cache_reg_stats(h->il2, sdb);
+      if (h->dl1)
+	cache_reg_stats(h->dl1, sdb);
+      if (h->dl2)
+	cache_reg_stats(h->dl2, sdb);
+      if (h->itlb)
+	cache_reg_stats(h->itlb, sdb);
+      if (h->dtlb)
+	cache_reg_stats(h->dtlb, sdb);
+      if (h->stlb)
+	cache_reg_stats(h->stlb, sdb);
+      if (h->pwc)
+	cache_reg_stats(h->pwc, sdb);
+      if (h->pmap)
+	pt_reg_stats(h->pmap, sdb);
+    }
 
   for (i=0; i<pcstat_nelt; i++)
     {
@@ -585,11 +1700,161 @@ sim_aux_stats(FILE *stream)		/* output stream */
   /* nada */
 }
 
+/* maximum number of structures with warm state in a hierarchy */
+#define MAX_WARM_ENTS		10
+
+/* a structure of a hierarchy with warm state, a cache (or TLB) or a page
+   table */
+struct warm_ent_t
+{
+  struct cache_t *cp;		/* cache, or NULL */
+  struct pt_t *pt;		/* page table, or NULL */
+  int restored;			/* restored from the warm state file? */
+};
+
+/* return the caches, TLBs and page tables of hierarchy H in ENTS, each one
+   once, returns their number */
+static int
+hier_warm_ents(struct cache_hier_t *h,	/* hierarchy */
+	       struct warm_ent_t *ents)	/* structures of the hierarchy */
+{
+  struct cache_t *caches[8];
+  struct pt_t *pts[2];
+  int i, j, n = 0;
+
+  caches[0] = h->il1; caches[1] = h->il2;
+  caches[2] = h->dl1; caches[3] = h->dl2;
+  caches[4] = h->itlb; caches[5] = h->dtlb;
+  caches[6] = h->stlb; caches[7] = h->pwc;
+  for (i=0; i<8; i++)
+    {
+      for (j=0; j<i && caches[j] != caches[i]; j++)
+	/* nada */;
+      if (caches[i] && j == i)
+	{
+	  ents[n].cp = caches[i];
+	  ents[n].pt = NULL;
+	  ents[n++].restored = FALSE;
+	}
+    }
+
+  pts[0] = h->pt; pts[1] = h->pmap != h->pt ? h->pmap : NULL;
+  for (i=0; i<2; i++)
+    if (pts[i])
+      {
+	ents[n].cp = NULL;
+	ents[n].pt = pts[i];
+	ents[n++].restored = FALSE;
+      }
+
+  return n;
+}
+
+/* save the warm state of all hierarchies to the -warm:save file, with an
+   EIO checkpoint of the program state to the -warm:chkpt file */
+static void
+warm_save(void)
+{
+  struct warm_ent_t ents[MAX_WARM_ENTS];
+  struct warm_t *w;
+  FILE *fd;
+  int i, j, n;
+
+  if (warm_chkpt_opt)
+    {
+      myfprintf(stderr, "sim: writing checkpoint file `%s' @ inst %n...\n",
+		warm_chkpt_opt, sim_num_insn);
+      fd = eio_create(warm_chkpt_opt);
+      eio_write_chkpt(&regs, mem, fd);
+      eio_close(fd);
+    }
+
+  myfprintf(stderr, "sim: writing warm state file `%s' @ inst %n...\n",
+	    warm_save_opt, sim_num_insn);
+
+  /* a replay does not execute the program, its PC is not known */
+  w = warm_create(warm_save_opt, sim_num_insn, trace_in ? 0 : regs.regs_PC);
+  for (i=0; i<n_hiers; i++)
+    {
+      n = hier_warm_ents(&hiers[i], ents);
+      for (j=0; j<n; j++)
+	{
+	  if (ents[j].cp)
+	    cache_save(ents[j].cp, w);
+	  else
+	    pt_save(ents[j].pt, w);
+	}
+    }
+  warm_close(w);
+}
+
+/* restore the warm state of all hierarchies from the -warm:load file */
+static void
+warm_load(void)
+{
+  struct warm_ent_t ents[(MAX_FANOUT+1) * MAX_WARM_ENTS];
+  struct warm_t *w;
+  char *name;
+  int i, n = 0;
+
+  for (i=0; i<n_hiers; i++)
+    n += hier_warm_ents(&hiers[i], ents + n);
+
+  fprintf(stderr, "sim: loading warm state file: %s\n", warm_load_opt);
+  w = warm_open(warm_load_opt);
+  if (w->icnt != sim_num_insn || (w->pc && w->pc != regs.regs_PC))
+    fatal("warm state `%s' was saved @ inst %n, the run starts @ inst %n",
+	  warm_load_opt, w->icnt, sim_num_insn);
+
+  while ((name = warm_next(w)) != NULL)
+    {
+      for (i=0; i<n; i++)
+	{
+	  if (ents[i].restored
+	      || strcmp(ents[i].cp ? ents[i].cp->name : ents[i].pt->name, name))
+	    continue;
+
+	  if (ents[i].cp)
+	    cache_restore(ents[i].cp, w);
+	  else
+	    pt_restore(ents[i].pt, w);
+	  ents[i].restored = TRUE;
+	  break;
+	}
+    }
+  warm_close(w);
+
+  for (i=0; i<n; i++)
+    if (!ents[i].restored)
+      warn("`%s' is not in warm state `%s', it starts cold",
+	   ents[i].cp ? ents[i].cp->name : ents[i].pt->name, warm_load_opt);
+}
+
 /* un-initialize the simulator */
 void
 sim_uninit(void)
 {
-  /* nada */
+  int i;
+
+  if (fanout_workers)
+    {
+      fanout_drain();
+      __atomic_store_n(&fanout_done, TRUE, __ATOMIC_RELEASE);
+      for (i=0; i<fanout_nworkers; i++)
+	pthread_join(fanout_workers[i].thread, NULL);
+      free(fanout_workers);
+      fanout_workers = NULL;
+    }
+
+  /* flush the last block of the trace being recorded */
+  if (trace_out)
+    {
+      reftrace_close(trace_out);
+      trace_out = NULL;
+    }
+
+  if (warm_save_opt)
+    warm_save();
 }
 
 /*
@@ -646,16 +1911,465 @@ sim_uninit(void)
 #error No ISA target defined...
 #endif
 
+/* access the data TLB and l1 data cache of hierarchy H */
+static ALWAYS_INLINE void
+hier_daccess(struct cache_hier_t *h,	/* hierarchy to access */
+	     enum mem_cmd cmd,		/* access cmd, Read or Write */
+	     md_addr_t addr,		/* data address to access */
+	     int nbytes)		/* number of bytes to access */
+{
+  hier = h;
+
+  /* the TLB is only read, a store does not dirty its translation */
+  if (h->dtlb)
+    cache_access(h->dtlb, Read, addr, NULL, nbytes, 0, NULL, NULL);
+  if (h->dl1)
+    cache_access(h->dl1, cmd, CACHE_ADDR(h, addr, pindex_all), NULL, nbytes,
+		 0, NULL, NULL);
+}
+
+/* access the inst TLB and l1 inst cache of hierarchy H */
+static INLINE void
+hier_iaccess(struct cache_hier_t *h,	/* hierarchy to access */
+	     md_addr_t addr,		/* inst address to access */
+	     int nbytes)		/* number of bytes to access */
+{
+  hier = h;
+
+  /* data accesses are made by the instruction last fetched */
+  if (h->dl1)
+    h->dl1->pc = addr;
+
+  if (h->itlb)
+    cache_access(h->itlb, Read, addr, NULL, nbytes, 0, NULL, NULL);
+  if (h->il1)
+    cache_access(h->il1, Read, CACHE_ADDR(h, addr, pindex_all), NULL,
+		 nbytes, 0, NULL, NULL);
+}
+
+/* flush the data TLBs and data caches of hierarchy H */
+static void
+hier_flush(struct cache_hier_t *h)	/* hierarchy to flush */
+{
+  hier = h;
+  if (h->dtlb)
+    cache_flush(h->dtlb, 0);
+  if (h->stlb)
+    cache_flush(h->stlb, 0);
+  if (h->pwc)
+    cache_flush(h->pwc, 0);
+  if (h->dl1)
+    cache_flush(h->dl1, 0);
+  if (h->dl2)
+    cache_flush(h->dl2, 0);
+}
+
+/* can hierarchy H replay references in batches?  its L1 caches must only
+   see each other through the L2 caches, and nothing it simulates may
+   depend on the latency of an L2 access */
+static int
+hier_batchable(struct cache_hier_t *h)	/* hierarchy to replay */
+{
+  /* page walks read PTEs through the data caches, and the second level
+     TLB is shared by the I- and D-TLBs */
+  if (h->pt || h->stlb)
+    return FALSE;
+
+  /* the l1 inst cache is a data cache */
+  if (h->il1 && (h->il1 == h->dl1 || h->il1 == h->dl2))
+    return FALSE;
+
+  /* write buffer drain times depend on the latency of the l2 data cache */
+  if (h->dl1 && h->dl1->wbuf_size && h->dl2)
+    return FALSE;
+
+  /* queued misses reach the L2 caches at other times, which their write
+     buffers and prefetch timeliness depend on */
+  if (h->dl2 && (h->dl2->wbuf_size || h->dl2->pf))
+    return FALSE;
+  if (h->il2 && (h->il2->wbuf_size || h->il2->pf))
+    return FALSE;
+
+  return TRUE;
+}
+
+/* split the references FIRST..LAST-1 of REFS, which has no flushes, by L1
+   cache into HIER_SPLIT, data accesses are made by the instruction last
+   fetched */
+static void
+hier_split_refs(struct fanout_ref_t *refs,/* references to split */
+		int first, int last)	/* range of references */
+{
+  struct hier_stream_t *s;
+  struct cache_ref_t *r;
+  int i;
+
+  hier_split->inst.nrefs = hier_split->data.nrefs = 0;
+  for (i=first; i<last; i++)
+    {
+      if (refs[i].kind == fk_inst)
+	{
+	  s = &hier_split->inst;
+	  hier_split->pc = refs[i].addr;
+	}
+      else
+	s = &hier_split->data;
+
+      r = &s->refs[s->nrefs];
+      r->addr = refs[i].addr;
+      r->pc = hier_split->pc;
+      r->cmd = (enum mem_cmd)refs[i].cmd;
+      r->nbytes = refs[i].nbytes;
+      s->seq[s->nrefs++] = i;
+    }
+}
+
+/* simulate the references FIRST..LAST-1 of REFS, split in HIER_SPLIT, on
+   hierarchy H in batches, each TLB and L1 cache gets its references in one
+   batch, with the L1 misses queued, then the queued misses are made to
+   the L2 caches in the order of their references */
+static void
+hier_batch(struct cache_hier_t *h,	/* hierarchy to access */
+	   struct fanout_ref_t *refs,	/* references to simulate */
+	   int first, int last)		/* range of references */
+{
+  struct hier_stream_t *is = &hier_split->inst, *ds = &hier_split->data;
+  struct cache_ref_t *irefs = is->refs, *drefs = ds->refs;
+  struct hier_miss_t *im, *dm, *iend, *dend;
+  int i, ni, nd;
+
+  hier = h;
+
+  /* the TLBs do not miss to anything */
+  if (h->itlb)
+    cache_access_batch(h->itlb, is->refs, is->nrefs, 0, NULL);
+  if (h->dtlb)
+    {
+      /* the TLB is only read, see hier_daccess() */
+      for (i=0; i<ds->nrefs; i++)
+	{
+	  ds->trefs[i] = ds->refs[i];
+	  ds->trefs[i].cmd = Read;
+	}
+      cache_access_batch(h->dtlb, ds->trefs, ds->nrefs, 0, NULL);
+    }
+
+  /* physical pages are allocated in order of first touch, so translate
+     the L1 addresses in reference order */
+  if (h->pindex == pindex_all)
+    {
+      for (i=first, ni=0, nd=0; i<last; i++)
+	{
+	  if (refs[i].kind == fk_inst)
+	    {
+	      is->prefs[ni] = is->refs[ni];
+	      is->prefs[ni].addr = pt_map(h->pmap, is->refs[ni].addr);
+	      ni++;
+	    }
+	  else
+	    {
+	      ds->prefs[nd] = ds->refs[nd];
+	      ds->prefs[nd].addr = pt_map(h->pmap, ds->refs[nd].addr);
+	      nd++;
+	    }
+	}
+      irefs = is->prefs;
+      drefs = ds->prefs;
+    }
+
+  is->nmisses = ds->nmisses = 0;
+  hier_defer_misses = TRUE;
+  if (h->il1)
+    cache_access_batch(h->il1, irefs, is->nrefs, 0, NULL);
+  if (h->dl1)
+    cache_access_batch(h->dl1, drefs, ds->nrefs, 0, NULL);
+  hier_defer_misses = FALSE;
+
+  /* merge the queued misses of both L1 caches */
+  im = is->misses;
+  iend = is->misses + is->nmisses;
+  dm = ds->misses;
+  dend = ds->misses + ds->nmisses;
+  while (im < iend || dm < dend)
+    {
+      if (dm == dend || (im < iend && im->seq < dm->seq))
+	{
+	  il1_access_fn(im->cmd, im->baddr, im->bsize, NULL, 0);
+	  im++;
+	}
+      else
+	{
+	  h->dl1->pc = dm->pc;
+	  dl1_access_fn(dm->cmd, dm->baddr, dm->bsize, NULL, 0);
+	  dm++;
+	}
+    }
+
+  if (h->dl1)
+    h->dl1->pc = hier_split->pc;
+}
+
+/* simulate the references FIRST..LAST-1 of REFS on hierarchy H, one
+   reference at a time */
+static void
+hier_replay(struct cache_hier_t *h,	/* hierarchy to access */
+	    struct fanout_ref_t *refs,	/* references to simulate */
+	    int first, int last)	/* range of references */
+{
+  struct fanout_ref_t *ref;
+
+  for (ref=refs+first; ref < refs+last; ref++)
+    {
+      switch (ref->kind)
+	{
+	case fk_inst:
+	  hier_iaccess(h, ref->addr, ref->nbytes);
+	  break;
+	case fk_data:
+	  hier_daccess(h, (enum mem_cmd)ref->cmd, ref->addr, ref->nbytes);
+	  break;
+	case fk_flush:
+	  hier_flush(h);
+	  break;
+	default:
+	  panic("bogus fanout reference kind");
+	}
+    }
+}
+
+/* simulate the NREFS references REFS on the simulated hierarchies
+   SIM_HIERS[FIRST..LAST-1], the
+   hierarchies are independent, so each one simulates a run of references
+   in turn, in batches if the results are those of simulating one
+   reference at a time */
+static void
+chunk_replay(struct fanout_ref_t *refs,	/* references to simulate */
+	     int nrefs,			/* number of references */
+	     int first, int last)	/* range of hierarchies */
+{
+  int i, j, k;
+
+  if (!hier_split)
+    {
+      hier_split = (struct hier_split_t *)
+	calloc(1, sizeof(struct hier_split_t));
+      if (!hier_split)
+	fatal("out of virtual memory");
+    }
+
+  /* the flushes separate the batches */
+  for (i=0; i<nrefs; i=j+1)
+    {
+      for (j=i; j<nrefs && refs[j].kind != fk_flush; j++)
+	/* nada */;
+
+      hier_split_refs(refs, i, j);
+      for (k=first; k<last; k++)
+	{
+	  if (hier_batchable(sim_hiers[k]))
+	    hier_batch(sim_hiers[k], refs, i, j);
+	  else
+	    hier_replay(sim_hiers[k], refs, i, j);
+	  if (j < nrefs)
+	    hier_flush(sim_hiers[k]);
+	}
+    }
+}
+
+/* lowest chunk count consumed by all fanout workers */
+static unsigned long
+fanout_min_tail(void)
+{
+  int i;
+  unsigned long tail, min_tail = fanout_head;
+
+  for (i=0; i<fanout_nworkers; i++)
+    {
+      tail = __atomic_load_n(&fanout_workers[i].tail, __ATOMIC_ACQUIRE);
+      if (tail < min_tail)
+	min_tail = tail;
+    }
+  return min_tail;
+}
+
+/* publish the chunk being filled to the fanout workers, then wait for the
+   next chunk of the ring to be free */
+static void
+fanout_publish(void)
+{
+  __atomic_store_n(&fanout_head, fanout_head + 1, __ATOMIC_RELEASE);
+
+  while (fanout_head - fanout_min_tail() >= FANOUT_RING_SIZE)
+    sched_yield();
+  fanout_chunk = &fanout_ring[fanout_head % FANOUT_RING_SIZE];
+  fanout_chunk->nrefs = 0;
+}
+
+/* wait for the fanout workers to consume all references made so far, and
+   merge the stats of the hierarchies simulated in slices, the caches are
+   then up to date, e.g., for printing their stats */
+static void
+fanout_drain(void)
+{
+  int i;
+
+  if (fanout_workers)
+    {
+      if (fanout_chunk->nrefs > 0)
+	fanout_publish();
+      while (fanout_min_tail() != fanout_head)
+	sched_yield();
+    }
+
+  for (i=0; i<n_hiers; i++)
+    if (hiers[i].slices > 1)
+      hier_merge(&hiers[i]);
+}
+
+/* fanout worker thread, simulates SIM_HIERS[W->FIRST..W->LAST-1] */
+static void *
+fanout_worker(void *arg)		/* struct fanout_worker_t */
+{
+  struct fanout_worker_t *w = arg;
+  struct fanout_chunk_t *chunk;
+
+  while (TRUE)
+    {
+      if (w->tail == __atomic_load_n(&fanout_head, __ATOMIC_ACQUIRE))
+	{
+	  /* nothing to do, the producer publishes all its references
+	     before setting FANOUT_DONE */
+	  if (__atomic_load_n(&fanout_done, __ATOMIC_ACQUIRE))
+	    break;
+	  sched_yield();
+	  continue;
+	}
+
+      chunk = &fanout_ring[w->tail % FANOUT_RING_SIZE];
+      chunk_replay(chunk->refs, chunk->nrefs, w->first, w->last);
+      __atomic_store_n(&w->tail, w->tail + 1, __ATOMIC_RELEASE);
+    }
+  return NULL;
+}
+
+/* start the fanout worker threads, each gets a contiguous range of the
+   simulated hierarchies */
+static void
+fanout_start(void)
+{
+  int i;
+
+  if (!fanout_nworkers)
+    return;
+
+  fanout_ring = (struct fanout_chunk_t *)
+    calloc(FANOUT_RING_SIZE, sizeof(struct fanout_chunk_t));
+  fanout_workers = (struct fanout_worker_t *)
+    calloc(fanout_nworkers, sizeof(struct fanout_worker_t));
+  if (!fanout_ring || !fanout_workers)
+    fatal("out of virtual memory");
+
+  fanout_head = 0;
+  fanout_chunk = &fanout_ring[0];
+  fanout_chunk->nrefs = 0;
+
+  for (i=0; i<fanout_nworkers; i++)
+    {
+      fanout_workers[i].first = (i * n_sim_hiers) / fanout_nworkers;
+      fanout_workers[i].last = ((i+1) * n_sim_hiers) / fanout_nworkers;
+      fanout_workers[i].tail = 0;
+      if (pthread_create(&fanout_workers[i].thread, NULL,
+			 fanout_worker, &fanout_workers[i]) != 0)
+	fatal("cannot create fanout thread %d", i);
+    }
+}
+
+/* append a reference to the fanout stream */
+#define FANOUT_REF(KIND, CMD, ADDR, NBYTES)				\
+  do {									\
+    struct fanout_ref_t *ref = &fanout_chunk->refs[fanout_chunk->nrefs];\
+    ref->kind = (KIND); ref->cmd = (CMD);				\
+    ref->addr = (ADDR); ref->nbytes = (NBYTES);				\
+    if (++fanout_chunk->nrefs == FANOUT_CHUNK_SIZE)			\
+      fanout_publish();							\
+  } while (0)
+
+/* access the data TLB and l1 data cache of every hierarchy */
+static void
+hiers_daccess(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t addr,		/* data address to access */
+	      int nbytes,		/* number of bytes to access */
+	      int sys)			/* access made by a system call? */
+{
+  int i;
+
+  if (trace_out)
+    reftrace_write(trace_out, cmd == Read ? rt_read : rt_write, sys,
+		   addr, nbytes);
+
+  if (fanout_workers)
+    FANOUT_REF(fk_data, cmd, addr, nbytes);
+  else
+    for (i=0; i<n_sim_hiers; i++)
+      hier_daccess(sim_hiers[i], cmd, addr, nbytes);
+}
+
+/* access the data TLB and l1 data cache, inlined into the memory access
+   macros, a single hierarchy is accessed directly */
+static ALWAYS_INLINE void
+dcache_access(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t addr,		/* data address to access */
+	      int nbytes,		/* number of bytes to access */
+	      int sys)			/* access made by a system call? */
+{
+  if (direct_hier)
+    hier_daccess(direct_hier, cmd, addr, nbytes);
+  else
+    hiers_daccess(cmd, addr, nbytes, sys);
+}
+
+/* access the inst TLB and l1 inst cache of every hierarchy */
+static INLINE void
+icache_access(md_addr_t addr,		/* inst address to access */
+	      int nbytes)		/* number of bytes to access */
+{
+  int i;
+
+  if (direct_hier)
+    {
+      hier_iaccess(direct_hier, addr, nbytes);
+      return;
+    }
+
+  if (trace_out)
+    reftrace_write(trace_out, rt_inst, FALSE, addr, nbytes);
+
+  if (fanout_workers)
+    FANOUT_REF(fk_inst, Read, addr, nbytes);
+  else
+    for (i=0; i<n_sim_hiers; i++)
+      hier_iaccess(sim_hiers[i], addr, nbytes);
+}
+
+/* flush the data TLB and data caches of every hierarchy */
+static void
+dcache_flush(void)
+{
+  int i;
+
+  if (trace_out)
+    reftrace_write(trace_out, rt_flush, FALSE, 0, 0);
+
+  if (fanout_workers)
+    FANOUT_REF(fk_flush, Read, 0, 0);
+  else
+    for (i=0; i<n_sim_hiers; i++)
+      hier_flush(sim_hiers[i]);
+}
+
 /* precise architected memory state accessor macros */
 #define __READ_CACHE(addr, SRC_T)					\
-  ((dtlb								\
-    ? cache_access(dtlb, Read, (addr), NULL,				\
-		   sizeof(SRC_T), 0, NULL, NULL)			\
-    : 0),								\
-   (cache_dl1								\
-    ? cache_access(cache_dl1, Read, (addr), NULL,			\
-		   sizeof(SRC_T), 0, NULL, NULL)			\
-    : 0))
+  dcache_access(Read, (addr), sizeof(SRC_T), /* !sys */FALSE)
 
 #define READ_BYTE(SRC, FAULT)						\
   ((FAULT) = md_fault_none, addr = (SRC),				\
@@ -673,14 +2387,7 @@ sim_uninit(void)
 #endif /* HOST_HAS_QWORD */
 
 #define __WRITE_CACHE(addr, DST_T)					\
-  ((dtlb								\
-    ? cache_access(dtlb, Write, (addr), NULL,				\
-		   sizeof(DST_T), 0, NULL, NULL)			\
-    : 0),								\
-   (cache_dl1								\
-    ? cache_access(cache_dl1, Write, (addr), NULL,			\
-		   sizeof(DST_T), 0, NULL, NULL)			\
-    : 0))
+  dcache_access(Write, (addr), sizeof(DST_T), /* !sys */FALSE)
 
 #define WRITE_BYTE(SRC, DST, FAULT)					\
   ((FAULT) = md_fault_none, addr = (DST),				\
@@ -705,21 +2412,125 @@ dcache_access_fn(struct mem_t *mem,	/* memory space to access */
 		 void *p,		/* data input/output buffer */
 		 int nbytes)		/* number of bytes to access */
 {
-  if (dtlb)
-    cache_access(dtlb, cmd, addr, NULL, nbytes, 0, NULL, NULL);
-  if (cache_dl1)
-    cache_access(cache_dl1, cmd, addr, NULL, nbytes, 0, NULL, NULL);
+  dcache_access(cmd, addr, nbytes, /* sys */TRUE);
   return mem_access(mem, cmd, addr, p, nbytes);
 }
 
-/* system call handler macro */
+/* system call handler macro, the caches must be up to date when the
+   program exits, i.e., when the stats are printed, so the flush is
+   drained too */
 #define SYSCALL(INST)							\
   (flush_on_syscalls							\
-   ? ((dtlb ? cache_flush(dtlb, 0) : 0),				\
-      (cache_dl1 ? cache_flush(cache_dl1, 0) : 0),			\
-      (cache_dl2 ? cache_flush(cache_dl2, 0) : 0),			\
+   ? (dcache_flush(), fanout_drain(),					\
       sys_syscall(&regs, mem_access, mem, INST, TRUE))			\
-   : sys_syscall(&regs, dcache_access_fn, mem, INST, TRUE))
+   : (fanout_drain(),							\
+      sys_syscall(&regs, dcache_access_fn, mem, INST, TRUE)))
+
+/* chunk of replayed references not simulated yet, without fanout workers */
+static struct fanout_chunk_t *replay_chunk = NULL;
+
+/* simulate the replayed references of REPLAY_CHUNK, nothing observes the
+   caches between references of a replay */
+static void
+replay_drain(void)
+{
+  chunk_replay(replay_chunk->refs, replay_chunk->nrefs, 0, n_sim_hiers);
+  replay_chunk->nrefs = 0;
+}
+
+/* access DIRECT_HIER with a replayed reference, or append it to the fanout
+   stream, or to REPLAY_CHUNK */
+static INLINE void
+replay_ref(enum fanout_kind_t kind,	/* kind of reference */
+	   enum mem_cmd cmd,		/* access cmd, Read or Write */
+	   md_addr_t addr,		/* address to access */
+	   int nbytes)			/* number of bytes to access */
+{
+  struct fanout_ref_t *ref;
+
+  /* a single hierarchy is accessed as the trace is read, without the
+     copies of the references into a chunk and its streams */
+  if (direct_hier)
+    {
+      if (kind == fk_inst)
+	hier_iaccess(direct_hier, addr, nbytes);
+      else if (kind == fk_data)
+	hier_daccess(direct_hier, cmd, addr, nbytes);
+      else
+	hier_flush(direct_hier);
+      return;
+    }
+
+  if (fanout_workers)
+    {
+      FANOUT_REF(kind, cmd, addr, nbytes);
+      return;
+    }
+
+  ref = &replay_chunk->refs[replay_chunk->nrefs];
+  ref->kind = kind; ref->cmd = cmd;
+  ref->addr = addr; ref->nbytes = nbytes;
+  if (++replay_chunk->nrefs == FANOUT_CHUNK_SIZE)
+    replay_drain();
+}
+
+/* replay the reference trace, instead of executing the program, a block
+   of the trace at a time */
+static void
+trace_replay(void)
+{
+  struct reftrace_rec_t *recs, *rec, *last;
+  counter_t last_ref_insn = 0;
+  int n;
+
+  replay_chunk = (struct fanout_chunk_t *)
+    calloc(1, sizeof(struct fanout_chunk_t));
+  if (!replay_chunk)
+    fatal("out of virtual memory");
+
+  while ((n = reftrace_read_block(trace_in, &recs)) > 0)
+    {
+      for (rec=recs, last=recs+n; rec < last; rec++)
+	{
+	  /* finish early? */
+	  if (rec->kind == rt_inst && max_insts && sim_num_insn >= max_insts)
+	    break;
+
+	  switch (rec->kind)
+	    {
+	    case rt_inst:
+	      sim_num_insn++;
+	      replay_ref(fk_inst, Read, rec->addr, rec->nbytes);
+	      break;
+	    case rt_read:
+	    case rt_write:
+	      /* count loads and stores, not their accesses */
+	      if (!rec->sys && last_ref_insn != sim_num_insn)
+		{
+		  sim_num_refs++;
+		  last_ref_insn = sim_num_insn;
+		}
+	      replay_ref(fk_data, rec->kind == rt_read ? Read : Write,
+			 rec->addr, rec->nbytes);
+	      break;
+	    case rt_flush:
+	      replay_ref(fk_flush, Read, 0, 0);
+	      break;
+	    default:
+	      panic("bogus reference trace record");
+	    }
+	}
+
+      /* the references after the one that ended the replay were not
+	 read */
+      if (rec < last)
+	{
+	  trace_in->refs -= last - rec - 1;
+	  break;
+	}
+    }
+  replay_drain();
+}
 
 /* start simulation, program loaded, processor precise state initialized */
 void
@@ -732,6 +2543,22 @@ sim_main(void)
   register int is_write;
   enum md_fault_type fault;
 
+  /* restore the warm state, before any reference is made */
+  if (warm_load_opt)
+    warm_load();
+
+  /* start the fanout workers, if any */
+  fanout_start();
+
+  if (trace_in)
+    {
+      fprintf(stderr, "sim: ** replaying reference trace `%s' **\n",
+	      trace_in_opt);
+      trace_replay();
+      fanout_drain();
+      return;
+    }
+
   fprintf(stderr, "sim: ** starting functional simulation w/ caches **\n");
 
   /* set up initial default next PC */
@@ -751,12 +2578,7 @@ sim_main(void)
 #endif /* TARGET_ALPHA */
 
       /* get the next instruction to execute */
-      if (itlb)
-	cache_access(itlb, Read, IACOMPRESS(regs.regs_PC),
-		     NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL);
-      if (cache_il1)
-	cache_access(cache_il1, Read, IACOMPRESS(regs.regs_PC),
-		     NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL);
+      icache_access(IACOMPRESS(regs.regs_PC), ISCOMPRESS(sizeof(md_inst_t)));
       MD_FETCH_INST(inst, mem, regs.regs_PC);
 
       /* keep an instruction count */
@@ -828,6 +2650,9 @@ sim_main(void)
 
       /* finish early? */
       if (max_insts && sim_num_insn >= max_insts)
-	return;
+	{
+	  fanout_drain();
+	  return;
+	}
     }
 }
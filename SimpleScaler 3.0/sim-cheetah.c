@@ -0,0 +1,637 @@
+/* sim-cheetah.c - single-pass multi-configuration cache simulator */
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+#include "loader.h"
+#include "syscall.h"
+#include "dlite.h"
+#include "options.h"
+#include "stats.h"
+#include "sim.h"
+
+/*
+ * This file implements a single-pass, multi-configuration cache simulator.
+ * Instead of instantiating one cache per configuration, an LRU stack of
+ * block addresses is kept for every set of every (block size, number of
+ * sets) geometry.  The depth at which a reference is found in its set's
+ * stack decides at once whether it hits in each associativity of that
+ * geometry (all-associativity simulation, after Hill and Smith).  Each
+ * stack entry also carries one dirty bit per associativity, which yields
+ * the write-back counts of the same configurations.  Only LRU replacement
+ * is modeled, FIFO and Random replacement are not stack algorithms.
+ */
+
+/* simulated registers */
+static struct regs_t regs;
+
+/* simulated memory */
+static struct mem_t *mem = NULL;
+
+/* track number of insn and refs */
+static counter_t sim_num_refs = 0;
+
+/* maximum number of inst's to execute */
+static unsigned int max_insts;
+
+/* reference stream to analyze, i.e., {inst|data|unified} */
+static char *refs_opt;
+static int refs_inst, refs_data;
+
+/* smallest and largest number of sets simulated */
+static int min_sets;
+static int max_sets;
+
+/* largest associativity simulated, all power-of-two assoc's below it are
+   simulated as well */
+static int max_assoc;
+
+/* block sizes simulated */
+#define MAX_BSIZES		8
+static int bsize_nelt = 1;
+static int bsizes[MAX_BSIZES] = { 32 };
+
+/* convert 64-bit inst addresses to 32-bit inst equivalents */
+static int compress_icache_addrs;
+
+/* convert 64-bit inst text addresses to 32-bit inst equivalents */
+#ifdef TARGET_PISA
+#define IACOMPRESS(A)							\
+  (compress_icache_addrs ? ((((A) - ld_text_base) >> 1) + ld_text_base) : (A))
+#else /* !TARGET_PISA */
+#define IACOMPRESS(A)		(A)
+#endif /* TARGET_PISA */
+
+/* number of power-of-two associativities simulated, i.e., 1..MAX_ASSOC */
+#define MAX_ASSOC_LEVELS	16
+static int assoc_levels;
+
+/* an LRU stack geometry, one stack of MAX_ASSOC entries per set */
+struct sd_geom_t
+{
+  int nsets;			/* number of sets */
+  int bsize;			/* block size in bytes */
+  int blk_shift;		/* log2(bsize) */
+  md_addr_t set_mask;		/* use *after* shift */
+  md_addr_t *stack;		/* block addresses, MRU first, per set */
+  unsigned int *dirty;		/* dirty bits, bit K set if the entry is
+				   dirty in the 2^K-way cache */
+  int *depth;			/* number of valid stack entries per set */
+
+  /* per-geometry stats, indexed by log2(assoc) */
+  counter_t accesses;		/* total number of references */
+  counter_t hits[MAX_ASSOC_LEVELS];	/* hits per associativity */
+  counter_t writebacks[MAX_ASSOC_LEVELS];/* writebacks per associativity */
+};
+
+/* simulated geometries */
+static int n_geoms = 0;
+static struct sd_geom_t *geoms = NULL;
+
+/* register simulator-specific options */
+void
+sim_reg_options(struct opt_odb_t *odb)	/* options database */
+{
+  opt_reg_header(odb, 
+"sim-cheetah: This program implements a functional simulator driver for a\n"
+"single-pass, multi-configuration cache simulator.  One pass over the\n"
+"reference stream produces hit, miss and writeback counts for every LRU\n"
+"cache with the given block sizes, any power-of-two number of sets between\n"
+"the given bounds, and any power-of-two associativity up to the given\n"
+"maximum.  All caches are write-back with write allocation.\n"
+		 );
+
+  /* instruction limit */
+  opt_reg_uint(odb, "-max:inst", "maximum number of inst's to execute",
+	       &max_insts, /* default */0,
+	       /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-refs",
+		 "reference stream to analyze, i.e., {inst|data|unified}",
+		 &refs_opt, "data", /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-sets:min", "minimum number of sets to analyze",
+	      &min_sets, /* default */16,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-sets:max", "maximum number of sets to analyze",
+	      &max_sets, /* default */4096,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-assoc:max", "maximum associativity to analyze",
+	      &max_assoc, /* default */8,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int_list(odb, "-bsize", "block size(s) to analyze (in bytes)",
+		   bsizes, MAX_BSIZES, &bsize_nelt, bsizes,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_flag(odb, "-cache:icompress",
+	       "convert 64-bit inst addresses to 32-bit inst equivalents",
+	       &compress_icache_addrs, /* default */FALSE,
+	       /* print */TRUE, NULL);
+
+  opt_reg_note(odb,
+"  Statistics are named <refs>_<nsets>_<bsize>_<assoc>, following the\n"
+"  <nsets>:<bsize>:<assoc> order of the sim-cache cache configurations,\n"
+"  e.g., the data cache equivalent to `-cache:dl1 dl1:256:32:2:l' is\n"
+"  reported as data_256_32_2.*.\n"
+	       );
+}
+
+/* check simulator-specific option values */
+void
+sim_check_options(struct opt_odb_t *odb,	/* options database */
+		  int argc, char **argv)	/* command line arguments */
+{
+  int i, nsets, bsize;
+  struct sd_geom_t *g;
+
+  if (!mystricmp(refs_opt, "inst"))
+    refs_inst = TRUE, refs_data = FALSE;
+  else if (!mystricmp(refs_opt, "data"))
+    refs_inst = FALSE, refs_data = TRUE;
+  else if (!mystricmp(refs_opt, "unified"))
+    refs_inst = TRUE, refs_data = TRUE;
+  else
+    fatal("bad reference stream, `%s', use {inst|data|unified}", refs_opt);
+
+  if (min_sets <= 0 || (min_sets & (min_sets-1)) != 0)
+    fatal("minimum number of sets `%d' must be a power of two", min_sets);
+  if (max_sets < min_sets || (max_sets & (max_sets-1)) != 0)
+    fatal("maximum number of sets `%d' must be a power of two >= `%d'",
+	  max_sets, min_sets);
+  if (max_assoc <= 0 || (max_assoc & (max_assoc-1)) != 0)
+    fatal("maximum associativity `%d' must be a power of two", max_assoc);
+  assoc_levels = log_base2(max_assoc) + 1;
+  if (assoc_levels > MAX_ASSOC_LEVELS)
+    fatal("maximum associativity `%d' must be %d or less",
+	  max_assoc, 1 << (MAX_ASSOC_LEVELS-1));
+
+  for (i=0; i<bsize_nelt; i++)
+    {
+      if (bsizes[i] < 8 || (bsizes[i] & (bsizes[i]-1)) != 0)
+	fatal("block size (in bytes) `%d' must be a power of two >= 8",
+	      bsizes[i]);
+    }
+
+  n_geoms = bsize_nelt * (log_base2(max_sets) - log_base2(min_sets) + 1);
+  geoms = (struct sd_geom_t *)calloc(n_geoms, sizeof(struct sd_geom_t));
+  if (!geoms)
+    fatal("out of virtual memory");
+
+  for (g=geoms,i=0; i<bsize_nelt; i++)
+    {
+      bsize = bsizes[i];
+      for (nsets=min_sets; nsets <= max_sets; nsets <<= 1, g++)
+	{
+	  g->nsets = nsets;
+	  g->bsize = bsize;
+	  g->blk_shift = log_base2(bsize);
+	  g->set_mask = nsets-1;
+	  g->stack = (md_addr_t *)calloc(nsets * max_assoc, sizeof(md_addr_t));
+	  g->dirty =
+	    (unsigned int *)calloc(nsets * max_assoc, sizeof(unsigned int));
+	  g->depth = (int *)calloc(nsets, sizeof(int));
+	  if (!g->stack || !g->dirty || !g->depth)
+	    fatal("out of virtual memory");
+	}
+    }
+}
+
+/* print simulator-specific configuration information */
+void
+sim_aux_config(FILE *stream)		/* output stream */
+{
+  int i;
+
+  fprintf(stream, "sim-cheetah: %s refs, %d-%d sets, 1-%d way, block sizes:",
+	  refs_opt, min_sets, max_sets, max_assoc);
+  for (i=0; i<bsize_nelt; i++)
+    fprintf(stream, " %d", bsizes[i]);
+  fprintf(stream, "\n");
+}
+
+/* register simulator-specific statistics */
+void
+sim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
+{
+  int i, k;
+  char prefix[128], buf[512], buf1[512];
+  struct sd_geom_t *g;
+
+  stat_reg_counter(sdb, "sim_num_insn",
+		   "total number of instructions executed",
+		   &sim_num_insn, sim_num_insn, NULL);
+  stat_reg_counter(sdb, "sim_num_refs",
+		   "total number of loads and stores executed",
+		   &sim_num_refs, 0, NULL);
+  stat_reg_int(sdb, "sim_elapsed_time",
+	       "total simulation time in seconds",
+	       &sim_elapsed_time, 0, NULL);
+  stat_reg_formula(sdb, "sim_inst_rate",
+		   "simulation speed (in insts/sec)",
+		   "sim_num_insn / sim_elapsed_time", NULL);
+
+  for (i=0; i<n_geoms; i++)
+    {
+      g = &geoms[i];
+      sprintf(prefix, "%s_%d_%d", refs_opt, g->nsets, g->bsize);
+
+      sprintf(buf, "%s.accesses", prefix);
+      stat_reg_counter(sdb, buf, "total number of accesses",
+		       &g->accesses, 0, NULL);
+      for (k=0; k<assoc_levels; k++)
+	{
+	  sprintf(buf, "%s_%d.hits", prefix, 1 << k);
+	  stat_reg_counter(sdb, buf, "total number of hits",
+			   &g->hits[k], 0, NULL);
+	  sprintf(buf, "%s_%d.misses", prefix, 1 << k);
+	  sprintf(buf1, "%s.accesses - %s_%d.hits", prefix, prefix, 1 << k);
+	  stat_reg_formula(sdb, buf, "total number of misses", buf1, "%12.0f");
+	  sprintf(buf, "%s_%d.writebacks", prefix, 1 << k);
+	  stat_reg_counter(sdb, buf, "total number of writebacks",
+			   &g->writebacks[k], 0, NULL);
+	  sprintf(buf, "%s_%d.miss_rate", prefix, 1 << k);
+	  sprintf(buf1, "%s_%d.misses / %s.accesses", prefix, 1 << k, prefix);
+	  stat_reg_formula(sdb, buf, "miss rate (i.e., misses/ref)", buf1, NULL);
+	}
+    }
+  ld_reg_stats(sdb);
+  mem_reg_stats(mem, sdb);
+}
+
+/* initialize the simulator */
+void
+sim_init(void)
+{
+  sim_num_refs = 0;
+
+  /* allocate and initialize register file */
+  regs_init(&regs);
+
+  /* allocate and initialize memory space */
+  mem = mem_create("mem");
+  mem_init(mem);
+}
+
+/* load program into simulated state */
+void
+sim_load_prog(char *fname,		/* program to load */
+	      int argc, char **argv,	/* program arguments */
+	      char **envp)		/* program environment */
+{
+  /* load program text and data, set up environment, memory, and regs */
+  ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
+
+  /* initialize the DLite debugger */
+  dlite_init(md_reg_obj, dlite_mem_obj, dlite_mstate_obj);
+}
+
+/* dump simulator-specific auxiliary simulator statistics */
+void
+sim_aux_stats(FILE *stream)		/* output stream */
+{
+  /* nada */
+}
+
+/* un-initialize simulator-specific state */
+void
+sim_uninit(void)
+{
+  /* nada */
+}
+
+/* access the LRU stacks of geometry G with a reference to ADDR, a hit at
+   stack depth P is a hit in every cache with more than P ways and a miss in
+   all others, entries above P are pushed down one position, which evicts
+   the entry at depth Q from the (Q+1)-way cache */
+static void
+sd_access(struct sd_geom_t *g,		/* geometry to access */
+	  md_addr_t addr,		/* address of access */
+	  int is_write)			/* non-zero for stores */
+{
+  md_addr_t baddr = addr >> g->blk_shift;
+  int set = baddr & g->set_mask;
+  md_addr_t *stack = g->stack + set * max_assoc;
+  unsigned int *dirty = g->dirty + set * max_assoc;
+  int p, q, k, last, n = g->depth[set];
+  unsigned int mask;
+
+  g->accesses++;
+
+  for (p=0; p<n; p++)
+    if (stack[p] == baddr)
+      break;
+
+  if (p < n)
+    {
+      /* hit in all caches with more than P ways */
+      for (k=assoc_levels-1; k >= 0 && (1 << k) > p; k--)
+	g->hits[k]++;
+
+      /* the smaller caches missed, and refetched the block clean */
+      mask = dirty[p] & ~((1U << (k+1)) - 1);
+      last = p;
+    }
+  else
+    {
+      /* miss in all caches, the LRU entry of a full set leaves the stack */
+      if (n == max_assoc)
+	{
+	  k = assoc_levels - 1;
+	  if (dirty[n-1] & (1U << k))
+	    g->writebacks[k]++;
+	  last = n-1;
+	}
+      else
+	{
+	  g->depth[set]++;
+	  last = n;
+	}
+      mask = 0;
+    }
+
+  for (q=last-1; q >= 0; q--)
+    {
+      if (((q+1) & q) == 0)
+	{
+	  /* entry Q falls out of the (Q+1)-way cache */
+	  k = log_base2(q+1);
+	  if (dirty[q] & (1U << k))
+	    {
+	      g->writebacks[k]++;
+	      dirty[q] &= ~(1U << k);
+	    }
+	}
+      stack[q+1] = stack[q];
+      dirty[q+1] = dirty[q];
+    }
+
+  stack[0] = baddr;
+  dirty[0] = is_write ? ((1U << assoc_levels) - 1) : mask;
+}
+
+/* pass a reference to all simulated geometries */
+static void
+sd_ref(md_addr_t addr, int is_write)
+{
+  int i;
+
+  for (i=0; i<n_geoms; i++)
+    sd_access(&geoms[i], addr, is_write);
+}
+
+/*
+ * configure the execution engine
+ */
+
+/*
+ * precise architected register accessors
+ */
+
+/* next program counter */
+#define SET_NPC(EXPR)		(regs.regs_NPC = (EXPR))
+
+/* current program counter */
+#define CPC			(regs.regs_PC)
+
+/* general purpose registers */
+#define GPR(N)			(regs.regs_R[N])
+#define SET_GPR(N,EXPR)		(regs.regs_R[N] = (EXPR))
+
+#if defined(TARGET_PISA)
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_L(N)		(regs.regs_F.l[(N)])
+#define SET_FPR_L(N,EXPR)	(regs.regs_F.l[(N)] = (EXPR))
+#define FPR_F(N)		(regs.regs_F.f[(N)])
+#define SET_FPR_F(N,EXPR)	(regs.regs_F.f[(N)] = (EXPR))
+#define FPR_D(N)		(regs.regs_F.d[(N) >> 1])
+#define SET_FPR_D(N,EXPR)	(regs.regs_F.d[(N) >> 1] = (EXPR))
+
+/* miscellaneous register accessors */
+#define SET_HI(EXPR)		(regs.regs_C.hi = (EXPR))
+#define HI			(regs.regs_C.hi)
+#define SET_LO(EXPR)		(regs.regs_C.lo = (EXPR))
+#define LO			(regs.regs_C.lo)
+#define FCC			(regs.regs_C.fcc)
+#define SET_FCC(EXPR)		(regs.regs_C.fcc = (EXPR))
+
+#elif defined(TARGET_ALPHA)
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_Q(N)		(regs.regs_F.q[N])
+#define SET_FPR_Q(N,EXPR)	(regs.regs_F.q[N] = (EXPR))
+#define FPR(N)			(regs.regs_F.d[N])
+#define SET_FPR(N,EXPR)		(regs.regs_F.d[N] = (EXPR))
+
+/* miscellaneous register accessors */
+#define FPCR			(regs.regs_C.fpcr)
+#define SET_FPCR(EXPR)		(regs.regs_C.fpcr = (EXPR))
+#define UNIQ			(regs.regs_C.uniq)
+#define SET_UNIQ(EXPR)		(regs.regs_C.uniq = (EXPR))
+
+#else
+#error No ISA target defined...
+#endif
+
+/* precise architected memory state accessor macros */
+#define __READ_CACHE(addr)						\
+  (refs_data ? sd_ref((addr), /* !is_write */FALSE) : (void)0)
+
+#define READ_BYTE(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   __READ_CACHE(addr), MEM_READ_BYTE(mem, addr))
+#define READ_HALF(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   __READ_CACHE(addr), MEM_READ_HALF(mem, addr))
+#define READ_WORD(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   __READ_CACHE(addr), MEM_READ_WORD(mem, addr))
+#ifdef HOST_HAS_QWORD
+#define READ_QWORD(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   __READ_CACHE(addr), MEM_READ_QWORD(mem, addr))
+#endif /* HOST_HAS_QWORD */
+
+#define __WRITE_CACHE(addr)						\
+  (refs_data ? sd_ref((addr), /* is_write */TRUE) : (void)0)
+
+#define WRITE_BYTE(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   __WRITE_CACHE(addr), MEM_WRITE_BYTE(mem, addr, (SRC)))
+#define WRITE_HALF(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   __WRITE_CACHE(addr), MEM_WRITE_HALF(mem, addr, (SRC)))
+#define WRITE_WORD(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   __WRITE_CACHE(addr), MEM_WRITE_WORD(mem, addr, (SRC)))
+#ifdef HOST_HAS_QWORD
+#define WRITE_QWORD(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   __WRITE_CACHE(addr), MEM_WRITE_QWORD(mem, addr, (SRC)))
+#endif /* HOST_HAS_QWORD */
+
+/* system call memory access function */
+static enum md_fault_type
+dcache_access_fn(struct mem_t *mem,	/* memory space to access */
+		 enum mem_cmd cmd,	/* memory access cmd, Read or Write */
+		 md_addr_t addr,	/* data address to access */
+		 void *p,		/* data input/output buffer */
+		 int nbytes)		/* number of bytes to access */
+{
+  if (refs_data)
+    sd_ref(addr, cmd == Write);
+  return mem_access(mem, cmd, addr, p, nbytes);
+}
+
+/* system call handler macro */
+#define SYSCALL(INST)							\
+  sys_syscall(&regs, dcache_access_fn, mem, INST, TRUE)
+
+/* start simulation, program loaded, processor precise state initialized */
+void
+sim_main(void)
+{
+  md_inst_t inst;
+  register md_addr_t addr;
+  enum md_opcode op;
+  register int is_write;
+  enum md_fault_type fault;
+
+  fprintf(stderr, "sim: ** starting functional simulation w/ cheetah **\n");
+
+  /* set up initial default next PC */
+  regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
+
+  /* check for DLite debugger entry condition */
+  if (dlite_check_break(regs.regs_PC, /* no access */0, /* addr */0, 0, 0))
+    dlite_main(regs.regs_PC - sizeof(md_inst_t), regs.regs_PC,
+	       sim_num_insn, &regs, mem);
+
+  while (TRUE)
+    {
+      /* maintain $r0 semantics */
+      regs.regs_R[MD_REG_ZERO] = 0;
+#ifdef TARGET_ALPHA
+      regs.regs_F.d[MD_REG_ZERO] = 0.0;
+#endif /* TARGET_ALPHA */
+
+      /* get the next instruction to execute */
+      if (refs_inst)
+	sd_ref(IACOMPRESS(regs.regs_PC), /* !is_write */FALSE);
+      MD_FETCH_INST(inst, mem, regs.regs_PC);
+
+      /* keep an instruction count */
+      sim_num_insn++;
+
+      /* set default reference address and access mode */
+      addr = 0; is_write = FALSE;
+
+      /* set default fault - none */
+      fault = md_fault_none;
+
+      /* decode the instruction */
+      MD_SET_OPCODE(op, inst);
+
+      /* execute the instruction */
+      switch (op)
+	{
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+	case OP:							\
+          SYMCAT(OP,_IMPL);						\
+          break;
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+        case OP:							\
+          panic("attempted to execute a linking opcode");
+#define CONNECT(OP)
+#define DECLARE_FAULT(FAULT)						\
+	  { fault = (FAULT); break; }
+#include "machine.def"
+	default:
+          panic("attempted to execute a bogus opcode");
+	}
+
+      if (fault != md_fault_none)
+	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
+
+      if (MD_OP_FLAGS(op) & F_MEM)
+	{
+	  sim_num_refs++;
+	  if (MD_OP_FLAGS(op) & F_STORE)
+	    is_write = TRUE;
+	}
+
+      /* check for DLite debugger entry condition */
+      if (dlite_check_break(regs.regs_NPC,
+			    is_write ? ACCESS_WRITE : ACCESS_READ,
+			    addr, sim_num_insn, sim_num_insn))
+	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
+
+      /* go to the next instruction */
+      regs.regs_PC = regs.regs_NPC;
+      regs.regs_NPC += sizeof(md_inst_t);
+
+      /* finish early? */
+      if (max_insts && sim_num_insn >= max_insts)
+	return;
+    }
+}
@@ -61,6 +61,11 @@
 #include "regs.h"
 #include "memory.h"
 #include "cache.h"
+#include "prefetch.h"
+#include "dram.h"
+#include "bus.h"
+#include "pt.h"
+#include "warm.h"
 #include "loader.h"
 #include "syscall.h"
 #include "bpred.h"
@@ -160,15 +165,63 @@ static int LSQ_size = 4;
 /* l1 data cache config, i.e., {<config>|none} */
 static char *cache_dl1_opt;
 
+/* l1 data cache write policy, i.e., {wb|wt} */
+static char *cache_dl1_wpolicy_opt;
+
 /* l1 data cache hit latency (in cycles) */
 static int cache_dl1_lat;
 
+/* l1 data cache write buffer entries (write-through only, 0 = none) */
+static int cache_dl1_wbuf;
+
+/* allocate l1 data cache blocks on write misses? */
+static int cache_dl1_walloc;
+
+/* l1 data cache victim buffer entries (0 = none) */
+static int cache_dl1_victim;
+
+/* l1 data cache victim buffer swap latency (in cycles) */
+static int cache_dl1_victim_lat;
+
+/* l1 data cache prefetcher, i.e., {none|<type>[:<degree>[:<distance>]]} */
+static char *cache_dl1_pf_opt;
+
+/* l1 data cache MSHRs (0 = unlimited outstanding misses) */
+static int cache_dl1_mshr;
+
+/* l1 data cache accesses merged per MSHR */
+static int cache_dl1_mshr_targets;
+
 /* l2 data cache config, i.e., {<config>|none} */
 static char *cache_dl2_opt;
 
+/* l2 data cache write policy, i.e., {wb|wt} */
+static char *cache_dl2_wpolicy_opt;
+
 /* l2 data cache hit latency (in cycles) */
 static int cache_dl2_lat;
 
+/* l2 data cache write buffer entries (write-through only, 0 = none) */
+static int cache_dl2_wbuf;
+
+/* allocate l2 data cache blocks on write misses? */
+static int cache_dl2_walloc;
+
+/* l2 data cache victim buffer entries (0 = none) */
+static int cache_dl2_victim;
+
+/* l2 data cache victim buffer swap latency (in cycles) */
+static int cache_dl2_victim_lat;
+
+/* l2 data cache prefetcher, i.e., {none|<type>[:<degree>[:<distance>]]} */
+static char *cache_dl2_pf_opt;
+
+/* l2 data cache MSHRs (0 = unlimited outstanding misses) */
+static int cache_dl2_mshr;
+
+/* l2 data cache accesses merged per MSHR */
+static int cache_dl2_mshr_targets;
+
 /* l1 instruction cache config, i.e., {<config>|dl1|dl2|none} */
 static char *cache_il1_opt;
 
@@ -195,6 +248,23 @@ static int mem_lat[2] =
 /* memory access bus width (in bytes) */
 static int mem_bus_width;
 
+/* L1 to L2 cache bus config, i.e., {<chans>:<width>:<occupancy>:<queue>|none} */
+static char *bus_l2_opt;
+
+/* cache to memory bus config, i.e., {<chans>:<width>:<occupancy>:<queue>|none} */
+static char *bus_mem_opt;
+
+/* DRAM config, i.e., {<channels>:<ranks>:<banks>:<row_size>|none} */
+static char *mem_dram_opt;
+
+/* DRAM row buffer policy, i.e., {open|closed} */
+static char *mem_dram_policy;
+
+/* DRAM timing (<tRCD> <tCAS> <tRP>) */
+static int mem_dram_nelt = 3;
+static int mem_dram_timing[3] =
+  { /* activate */10, /* column access */10, /* precharge */10 };
+
 /* instruction TLB config, i.e., {<config>|none} */
 static char *itlb_opt;
 
@@ -204,6 +274,39 @@ static char *dtlb_opt;
 /* inst/data TLB miss latency (in cycles) */
 static int tlb_miss_lat;
 
+/* page table levels, i.e., {<levels>|none} */
+static char *tlb_pt_opt;
+
+/* cache the page walker reads PTEs through, i.e., {dl1|dl2|none} */
+static char *tlb_walk_opt;
+
+/* page walker latency per level (in cycles) */
+static int tlb_walk_lat;
+
+/* page walk cache config, i.e., {<config>|none} */
+static char *tlb_pwc_opt;
+
+/* second level TLB config, i.e., {<config>|none} */
+static char *tlb_stlb_opt;
+
+/* second level TLB hit latency (in cycles) */
+static int tlb_stlb_lat;
+
+/* physically indexed caches, i.e., {none|l2|all} */
+static char *cache_pindex_opt;
+
+/* physical page allocation policy, i.e., {seq|random|color} */
+static char *mem_palloc_opt;
+
+/* page colors, for the color policy (0 = page-sized sets of the L2) */
+static int mem_pcolors;
+
+/* classify cache misses as compulsory, capacity or conflict misses */
+static int cache_classify;
+
+/* L2 caches model 1 in this many sets */
+static int cache_sample;
+
 /* total number of integer ALU's available */
 static int res_ialu;
 
@@ -219,6 +322,10 @@ static int res_fpalu;
 /* total number of floating point multiplier/dividers available */
 static int res_fpmult;
 
+/* warm state options */
+static char *warm_save_opt /* = NULL */;
+static char *warm_load_opt /* = NULL */;
+
 /* text-based stat profiles */
 #define MAX_PCSTAT_VARS 8
 static int pcstat_nelt = 0;
@@ -341,6 +448,9 @@ static counter_t LSQ_fcount;		/* cumulative LSQ full count */
 /* total non-speculative bogus addresses seen (debug var) */
 static counter_t sim_invalid_addrs;
 
+/* total number of load issue stalls on full l1 data cache MSHRs */
+static counter_t sim_mshr_stalls;
+
 /*
  * simulator state variables
  */
@@ -385,6 +495,34 @@ static struct cache_t *itlb;
 /* data TLB */
 static struct cache_t *dtlb;
 
+/* second level TLB, shared by the I- and D-TLBs */
+static struct cache_t *stlb;
+
+/* page table walked on TLB misses, NULL for the fixed -tlb:lat latency */
+static struct pt_t *page_table;
+
+/* page walk cache, holds the upper level PTEs of the page table */
+static struct cache_t *pwc;
+
+/* cache the page walker reads PTEs through, NULL for memory */
+static struct cache_t *walk_cache;
+
+/* total cycles spent walking the page table */
+static counter_t tlb_walk_cycles = 0;
+
+/* caches indexed with physical addresses, the L1 caches see virtual
+   addresses unless all caches are physically indexed */
+static enum { pindex_none, pindex_all, pindex_l2 } cache_pindex;
+
+/* page mapper of physically indexed caches, the page table if there is
+   one, so the caches and the TLBs see the same translation */
+static struct pt_t *pmap;
+
+/* address ADDR as seen by the caches at level LEVEL (pindex_all for the L1
+   caches, pindex_l2 for the L2 caches and memory) */
+#define CACHE_ADDR(ADDR, LEVEL)						\
+  (cache_pindex == (LEVEL) ? pt_map(pmap, (ADDR)) : (ADDR))
+
 /* branch predictor */
 static struct bpred_t *pred;
 
@@ -407,12 +545,26 @@ static struct stat_stat_t *pcstat_sdists[MAX_PCSTAT_VARS];
 	 : (panic("bad stat class"), 0))))
 
 
+/* banked DRAM model, NULL if the flat memory latency is used */
+static struct dram_t *dram = NULL;
+
+/* interconnects between the L1 and L2 caches, and the caches and memory,
+   NULL if the caches use their single-port bus model */
+static struct bus_t *bus_l2 = NULL;
+static struct bus_t *bus_mem = NULL;
+
 /* memory access latency, assumed to not cross a page boundary */
 static unsigned int			/* total latency of access */
-mem_access_latency(int blk_sz)		/* block size accessed */
+mem_access_latency(enum mem_cmd cmd,	/* Read or Write */
+		   md_addr_t baddr,	/* block address accessed */
+		   int blk_sz,		/* block size accessed */
+		   tick_t now)		/* time of access */
 {
   int chunks = (blk_sz + (mem_bus_width - 1)) / mem_bus_width;
 
+  if (dram)
+    return dram_access(dram, cmd, baddr, blk_sz, now);
+
   assert(chunks > 0);
 
   return (/* first chunk latency */mem_lat[0] +
@@ -434,9 +586,11 @@ dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 {
   unsigned int lat;
 
+  baddr = CACHE_ADDR(baddr, pindex_l2);
   if (cache_dl2)
     {
       /* access next level of data cache hierarchy */
+      cache_dl2->pc = cache_dl1->pc;
       lat = cache_access(cache_dl2, cmd, baddr, NULL, bsize,
 			 /* now */now, /* pudata */NULL, /* repl addr */NULL);
       if (cmd == Read)
@@ -449,9 +603,10 @@ dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
     }
   else
     {
-      /* access main memory */
+      /* access main memory, writes still occupy the DRAM */
+      lat = mem_access_latency(cmd, baddr, bsize, now);
       if (cmd == Read)
-	return mem_access_latency(bsize);
+	return lat;
       else
 	{
 	  /* FIXME: unlimited write buffers */
@@ -468,9 +623,13 @@ dl2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
 	      tick_t now)		/* time of access */
 {
-  /* this is a miss to the lowest level, so access main memory */
+  unsigned int lat;
+
+  /* this is a miss to the lowest level, so access main memory, writes
+     still occupy the DRAM */
+  lat = mem_access_latency(cmd, baddr, bsize, now);
   if (cmd == Read)
-    return mem_access_latency(bsize);
+    return lat;
   else
     {
       /* FIXME: unlimited write buffers */
@@ -491,6 +650,8 @@ il1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 if (cache_il2)
     {
       /* access next level of inst cache hierarchy */
+      cache_il2->pc = baddr;
+      baddr = CACHE_ADDR(baddr, pindex_l2);
       lat = cache_access(cache_il2, cmd, baddr, NULL, bsize,
 			 /* now */now, /* pudata */NULL, /* repl addr */NULL);
       if (cmd == Read)
@@ -502,7 +663,8 @@ if (cache_il2)
     {
       /* access main memory */
       if (cmd == Read)
-	return mem_access_latency(bsize);
+	return mem_access_latency(cmd, CACHE_ADDR(baddr, pindex_l2),
+				  bsize, now);
       else
 	panic("writes to instruction memory not supported");
     }
@@ -518,7 +680,7 @@ il2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 {
   /* this is a miss to the lowest level, so access main memory */
   if (cmd == Read)
-    return mem_access_latency(bsize);
+    return mem_access_latency(cmd, baddr, bsize, now);
   else
     panic("writes to instruction memory not supported");
 }
@@ -528,6 +690,91 @@ il2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
  * TLB miss handlers
  */
 
+/* read the PTE at ADDR for the page walker at NOW, returns the latency of
+   the read */
+static unsigned int			/* latency of PTE read */
+walk_read(md_addr_t addr,		/* address of PTE */
+	  int nbytes,			/* bytes to read */
+	  tick_t now)			/* time of read */
+{
+  if (walk_cache)
+    {
+      walk_cache->pc = 0;
+      return cache_access(walk_cache, Read, addr, NULL, nbytes,
+			  now, NULL, NULL);
+    }
+  else
+    return mem_access_latency(Read, addr, nbytes, now);
+}
+
+/* page walk cache block miss handler function */
+static unsigned int			/* latency of block access */
+pwc_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t baddr,		/* block address to access */
+	      int bsize,		/* size of block to access */
+	      struct cache_blk_t *blk,	/* ptr to block in upper level */
+	      tick_t now)		/* time of access */
+{
+  if (cmd == Read)
+    return walk_read(baddr, bsize, now);
+  else
+    panic("writes to the page walk cache not supported");
+}
+
+/* translate VADDR for a TLB miss at NOW, walking the page table if there is
+   one, returns the latency of the translation, the physical page address
+   is returned in *PHY_PAGE */
+static unsigned int			/* latency of translation */
+tlb_walk(md_addr_t vaddr,		/* virtual address to translate */
+	 tick_t now,			/* time of miss */
+	 md_addr_t *phy_page)		/* physical page address */
+{
+  md_addr_t addrs[PT_MAX_LEVELS];
+  unsigned int lat = 0;
+  int i;
+
+  if (!page_table)
+    {
+      /* fake translation */
+      *phy_page = 0;
+      return tlb_miss_lat;
+    }
+
+  /* read the PTE of each level, upper levels through the page walk cache */
+  *phy_page = pt_translate(page_table, vaddr, addrs);
+  for (i=0; i<page_table->levels; i++)
+    {
+      lat += tlb_walk_lat;
+      if (pwc && i < page_table->levels - 1)
+	lat += cache_access(pwc, Read, addrs[i], NULL, sizeof(md_addr_t),
+			    now+lat, NULL, NULL);
+      else
+	lat += walk_read(addrs[i], sizeof(md_addr_t), now+lat);
+    }
+  tlb_walk_cycles += lat;
+
+  return lat;
+}
+
+/* translate VADDR for a first level TLB miss at NOW, through the second
+   level TLB if there is one */
+static unsigned int			/* latency of translation */
+tlb_miss(md_addr_t vaddr,		/* virtual address to translate */
+	 tick_t now,			/* time of miss */
+	 md_addr_t *phy_page)		/* physical page address */
+{
+  unsigned int lat;
+  byte_t *udata;
+
+  if (!stlb)
+    return tlb_walk(vaddr, now, phy_page);
+
+  lat = cache_access(stlb, Read, vaddr & ~(md_addr_t)(sizeof(md_addr_t)-1),
+		     NULL, sizeof(md_addr_t), now, &udata, NULL);
+  *phy_page = *(md_addr_t *)udata;
+  return lat;
+}
+
 /* inst cache block miss handler function */
 static unsigned int			/* latency of block access */
 itlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
@@ -538,14 +785,16 @@ itlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
 {
   md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
 
+  /* a TLB block is never dirty, an eviction writes nothing back, so it
+     must not start a walk */
+  if (cmd == Write)
+    return 0;
+
   /* no real memory access, however, should have user data space attached */
   assert(phy_page_ptr);
 
-  /* fake translation, for now... */
-  *phy_page_ptr = 0;
-
   /* return tlb miss latency */
-  return tlb_miss_lat;
+  return tlb_miss(baddr, now, phy_page_ptr);
 }
 
 /* data cache block miss handler function */
@@ -558,14 +807,38 @@ dtlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
 {
   md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
 
+  /* a TLB block is never dirty, an eviction writes nothing back, so it
+     must not start a walk */
+  if (cmd == Write)
+    return 0;
+
   /* no real memory access, however, should have user data space attached */
   assert(phy_page_ptr);
 
-  /* fake translation, for now... */
-  *phy_page_ptr = 0;
-
   /* return tlb miss latency */
-  return tlb_miss_lat;
+  return tlb_miss(baddr, now, phy_page_ptr);
+}
+
+/* second level TLB block miss handler function */
+static unsigned int			/* latency of block access */
+stlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
+	       md_addr_t baddr,		/* block address to access */
+	       int bsize,		/* size of block to access */
+	       struct cache_blk_t *blk,	/* ptr to block in upper level */
+	       tick_t now)		/* time of access */
+{
+  md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
+
+  /* a TLB block is never dirty, an eviction writes nothing back, so it
+     must not start a walk */
+  if (cmd == Write)
+    return 0;
+
+  /* no real memory access, however, should have user data space attached */
+  assert(phy_page_ptr);
+
+  /* return page walk latency */
+  return tlb_walk(baddr, now, phy_page_ptr);
 }
 
 
@@ -616,6 +889,29 @@ sim_reg_options(struct opt_odb_t *odb)
 "                -ptrace FOOBAR.trc @main:+278\n"
 	       );
 
+  opt_reg_string(odb, "-warm:save",
+		 "save warm cache, TLB, page table and predictor state at end",
+		 &warm_save_opt, /* default */NULL,
+		 /* print */TRUE, NULL);
+  opt_reg_string(odb, "-warm:load",
+		 "start timing from warm cache, TLB, page table and predictor "
+		 "state",
+		 &warm_load_opt, /* default */NULL,
+		 /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  A warm state file (see warm.h) holds the blocks and replacement state\n"
+"  of the caches and TLBs, the page tables, and the branch predictor tables,\n"
+"  BTB and return-address stack, of the instruction the run stopped at (or\n"
+"  was stopped at by -max:inst), so later runs can start timing simulation\n"
+"  there from warm structures.  The warm state must be loaded at the point\n"
+"  it was saved, i.e., after restoring an EIO checkpoint (-chkpt) or fast\n"
+"  forwarding (-fastfwd) to the same instruction, each structure is restored\n"
+"  from the state saved under its name and must be organized like the one\n"
+"  saved, those not in the file start cold.  Warm state saved by sim-cache,\n"
+"  with an EIO checkpoint of the same point (see its -warm:chkpt option),\n"
+"  warms the caches, TLBs and page tables.\n"
+	       );
+
   /* ifetch options */
 
   opt_reg_int(odb, "-fetch:ifqsize", "instruction fetch queue size (in insts)",
@@ -743,15 +1039,22 @@ sim_reg_options(struct opt_odb_t *odb)
   opt_reg_note(odb,
 "  The cache config parameter <config> has the following format:\n"
 "\n"
-"    <name>:<nsets>:<bsize>:<assoc>:<repl>\n"
+"    <name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]\n"
 "\n"
 "    <name>   - name of the cache being defined\n"
 "    <nsets>  - number of sets in the cache\n"
 "    <bsize>  - block size of the cache\n"
 "    <assoc>  - associativity of the cache\n"
-"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random\n"
+"    <repl>   - block replacement strategy, 'l'-LRU, 'f'-FIFO, 'r'-random,\n"
+"               't'-tree pseudo-LRU, 'b'-bit pseudo-LRU, 's'-SRRIP,\n"
+"               'i'-BRRIP, 'd'-DRRIP (set dueling SRRIP/BRRIP)\n"
+"    <index>  - set index function (caches only), 'b'-address bits (the\n"
+"               default), 'x'-bits XOR tag bits, 'p'-block address modulo\n"
+"               the largest prime <= <nsets>, 's'-skewed-associative, each\n"
+"               way with its own XOR hash (needs 'l', 'f' or 'r' <repl>)\n"
 "\n"
 "    Examples:   -cache:dl1 dl1:4096:32:1:l\n"
+"                -cache:dl1 dl1:128:32:4:l:s\n"
 "                -dtlb dtlb:128:4096:32:r\n"
 	       );
 
@@ -760,6 +1063,46 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &cache_dl1_lat, /* default */1,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_string(odb, "-cache:dl1:wpolicy",
+		 "l1 data cache write policy, i.e., {wb|wt} (wt = old default)",
+		 &cache_dl1_wpolicy_opt, "wb",
+		 /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-cache:dl1:wbuf",
+	      "l1 data cache write buffer entries (wt only, 0 = none)",
+	      &cache_dl1_wbuf, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_flag(odb, "-cache:dl1:walloc",
+	       "allocate l1 data cache blocks on write misses",
+	       &cache_dl1_walloc, /* default */TRUE,
+	       /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-cache:dl1:victim",
+	      "l1 data cache victim buffer entries (0 = none)",
+	      &cache_dl1_victim, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:dl1:victimlat",
+	      "l1 data cache victim buffer swap latency (in cycles)",
+	      &cache_dl1_victim_lat, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-cache:dl1:pf",
+		 "l1 data cache prefetcher, i.e., {none|<type>[:<degree>[:<distance>]]}",
+		 &cache_dl1_pf_opt, "none",
+		 /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-cache:dl1:mshr",
+	      "l1 data cache MSHRs (0 = unlimited outstanding misses)",
+	      &cache_dl1_mshr, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:dl1:mshrtargets",
+	      "l1 data cache accesses merged per MSHR",
+	      &cache_dl1_mshr_targets, /* default */4,
+	      /* print */TRUE, /* format */NULL);
+
   opt_reg_string(odb, "-cache:dl2",
 		 "l2 data cache config, i.e., {<config>|none}",
 		 &cache_dl2_opt, "ul2:1024:64:4:l",
@@ -770,6 +1113,53 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &cache_dl2_lat, /* default */6,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_string(odb, "-cache:dl2:wpolicy",
+		 "l2 data cache write policy, i.e., {wb|wt} (wt = old default)",
+		 &cache_dl2_wpolicy_opt, "wb",
+		 /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-cache:dl2:wbuf",
+	      "l2 data cache write buffer entries (wt only, 0 = none)",
+	      &cache_dl2_wbuf, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_flag(odb, "-cache:dl2:walloc",
+	       "allocate l2 data cache blocks on write misses",
+	       &cache_dl2_walloc, /* default */TRUE,
+	       /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-cache:dl2:victim",
+	      "l2 data cache victim buffer entries (0 = none)",
+	      &cache_dl2_victim, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:dl2:victimlat",
+	      "l2 data cache victim buffer swap latency (in cycles)",
+	      &cache_dl2_victim_lat, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-cache:dl2:pf",
+		 "l2 data cache prefetcher, i.e., {none|<type>[:<degree>[:<distance>]]}",
+		 &cache_dl2_pf_opt, "none",
+		 /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-cache:dl2:mshr",
+	      "l2 data cache MSHRs (0 = unlimited outstanding misses)",
+	      &cache_dl2_mshr, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_int(odb, "-cache:dl2:mshrtargets",
+	      "l2 data cache accesses merged per MSHR",
+	      &cache_dl2_mshr_targets, /* default */4,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  The prefetcher <type> is nextline (tagged next-line), stride (PC-indexed\n"
+"  stride table) or stream (multi-stream detector), up to <degree> (default\n"
+"  1) blocks are prefetched per trigger, starting <distance> (default 1)\n"
+"  strides ahead of the triggering access, e.g., -cache:dl1:pf stride:2:4\n"
+	       );
+
   opt_reg_string(odb, "-cache:il1",
 		 "l1 inst cache config, i.e., {<config>|dl1|dl2|none}",
 		 &cache_il1_opt, "il1:512:32:1:l",
@@ -812,6 +1202,29 @@ sim_reg_options(struct opt_odb_t *odb)
 	       &compress_icache_addrs, /* default */FALSE,
 	       /* print */TRUE, NULL);
 
+  /* bus options */
+  opt_reg_string(odb, "-bus:l2",
+		 "L1 to L2 cache bus config, i.e., "
+		 "{<channels>:<width>:<occupancy>:<queue>|none}",
+		 &bus_l2_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_string(odb, "-bus:mem",
+		 "cache to memory bus config, i.e., "
+		 "{<channels>:<width>:<occupancy>:<queue>|none}",
+		 &bus_mem_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_note(odb,
+"  The bus options replace the default single-port model, where a miss\n"
+"  holds the bus to the next level for one cycle, with a contended\n"
+"  interconnect.  A transfer of a block takes the first free of <channels>\n"
+"  channels for <occupancy> cycles per <width> bytes, with up to <queue>\n"
+"  transfers waiting per channel (0 for unlimited).  Fills, writebacks and\n"
+"  write-throughs all use the bus.  The L1 caches use -bus:l2 (or -bus:mem\n"
+"  if they have no L2), the L2 caches -bus:mem.  For example:\n"
+"\n"
+"    -bus:l2 1:16:1:4 -bus:mem 2:8:2:8\n"
+	       );
+
   /* mem options */
   opt_reg_int_list(odb, "-mem:lat",
 		   "memory access latency (<first_chunk> <inter_chunk>)",
@@ -822,6 +1235,31 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &mem_bus_width, /* default */8,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_string(odb, "-mem:dram",
+		 "banked DRAM config, i.e., "
+		 "{<channels>:<ranks>:<banks>:<row_size>|none}",
+		 &mem_dram_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_string(odb, "-mem:dram:policy",
+		 "DRAM row buffer policy, i.e., {open|closed}",
+		 &mem_dram_policy, "open", /* print */TRUE, NULL);
+
+  opt_reg_int_list(odb, "-mem:dram:timing",
+		   "DRAM timing in cycles (<tRCD> <tCAS> <tRP>)",
+		   mem_dram_timing, mem_dram_nelt, &mem_dram_nelt,
+		   mem_dram_timing,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_note(odb,
+"  The banked DRAM model (-mem:dram) replaces the fixed -mem:lat latency.\n"
+"  Row hits pay tCAS, accesses to a precharged bank tRCD+tCAS, and row\n"
+"  conflicts tRP+tRCD+tCAS, then each -mem:width bytes transferred occupy\n"
+"  the channel's data bus for <inter_chunk> (-mem:lat) cycles.  Rows are\n"
+"  interleaved across channels, then banks, then ranks.  For example:\n"
+"\n"
+"    -mem:dram 2:1:8:2048 -mem:dram:policy open -mem:dram:timing 12 12 12\n"
+	       );
+
   /* TLB options */
 
   opt_reg_string(odb, "-tlb:itlb",
@@ -837,6 +1275,98 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &tlb_miss_lat, /* default */30,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_string(odb, "-tlb:pt",
+		 "page table walked on TLB misses, i.e., {<levels>|none}",
+		 &tlb_pt_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_string(odb, "-tlb:walkcache",
+		 "cache the page walker reads PTEs through, i.e., "
+		 "{dl1|dl2|none}",
+		 &tlb_walk_opt, "dl1", /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-tlb:walklat",
+	      "page walker latency per level (in cycles)",
+	      &tlb_walk_lat, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-tlb:pwc",
+		 "page walk cache config, i.e., {<config>|none}",
+		 &tlb_pwc_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_string(odb, "-tlb:stlb",
+		 "second level TLB config, i.e., {<config>|none}",
+		 &tlb_stlb_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-tlb:stlblat",
+	      "second level TLB hit latency (in cycles)",
+	      &tlb_stlb_lat, /* default */6,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  By default a TLB miss costs -tlb:lat cycles and translates every page to\n"
+"  physical page 0.  With -tlb:pt, misses walk a page table of <levels>\n"
+"  levels (0 for as many as the address space needs), physical pages are\n"
+"  assigned in order of first touch, and each level costs -tlb:walklat\n"
+"  cycles plus a read of its PTE through -tlb:walkcache (none reads from\n"
+"  memory).  The upper level PTEs may be held in a page walk cache\n"
+"  (-tlb:pwc, a cache config with 1 cycle hits, e.g., pwc:1:8:16:l for 16\n"
+"  8-byte blocks).  The I- and D-TLBs may share a second level TLB that\n"
+"  is looked up before walking (-tlb:stlb, e.g., stlb:128:4096:4:l).\n"
+	       );
+
+  opt_reg_string(odb, "-cache:pindex",
+		 "physically indexed caches, i.e., {none|l2|all}",
+		 &cache_pindex_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_string(odb, "-mem:palloc",
+		 "physical page allocation policy, i.e., {seq|random|color}",
+		 &mem_palloc_opt, "seq", /* print */TRUE, NULL);
+
+  opt_reg_int(odb, "-mem:pcolors",
+	      "page colors of the color policy (0 = sets of the L2 per page)",
+	      &mem_pcolors, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  By default all caches are indexed and tagged with virtual addresses.\n"
+"  With -cache:pindex l2, the L2 caches and memory see physical addresses,\n"
+"  with -cache:pindex all, the L1 caches do too.  Physical pages are\n"
+"  assigned on first touch by -mem:palloc, which also maps the pages of\n"
+"  -tlb:pt: seq numbers them in order, random draws them at random, and\n"
+"  color gives each virtual page the next physical page of its own color\n"
+"  (VPN modulo -mem:pcolors), e.g.,\n"
+"\n"
+"    -cache:pindex l2 -mem:palloc random -cache:dl2 ul2:4096:64:1:l\n"
+	       );
+
+  opt_reg_flag(odb, "-cache:classify",
+	       "classify cache misses as compulsory, capacity or conflict",
+	       &cache_classify, /* default */FALSE, /* print */TRUE, NULL);
+
+  opt_reg_note(odb,
+"  With -cache:classify, each cache and TLB runs a fully-associative LRU\n"
+"  shadow cache of the same capacity next to it.  A miss to a block never\n"
+"  touched before is compulsory, else a miss of the shadow cache too is a\n"
+"  capacity miss, else it is a conflict miss, see <cache>.compulsory_misses,\n"
+"  <cache>.capacity_misses and <cache>.conflict_misses.  The shadow cache\n"
+"  is flushed and invalidated with its cache, but remembers the blocks\n"
+"  touched, so a miss after a flush is a capacity miss.\n"
+	       );
+
+  opt_reg_int(odb, "-cache:sample",
+	      "L2 caches model 1 in <n> sets (a power of two)",
+	      &cache_sample, /* default */1,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  With -cache:sample <n>, the L2 caches only model 1 in <n> of their sets,\n"
+"  chosen by a hash of the set index, the accesses to the other sets are\n"
+"  skipped and take the mean latency of the accesses modelled, which cuts\n"
+"  the memory and time of a large L2 cache by about <n>.  See\n"
+"  <cache>.miss_rate_ci for the 95% confidence interval of the miss rate,\n"
+"  and <cache>.est_misses for the misses extrapolated to all sets.\n"
+	       );
+
   /* resource configuration */
 
   opt_reg_int(odb, "-res:ialu",
@@ -879,7 +1409,7 @@ void
 sim_check_options(struct opt_odb_t *odb,        /* options database */
 		  int argc, char **argv)        /* command line arguments */
 {
-  char name[128], c;
+  char name[128], c, ix;
   int nsets, bsize, assoc;
 
   if (fastfwd_count < 0 || fastfwd_count >= 2147483647)
@@ -1011,25 +1541,52 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
     }
   else /* dl1 is defined */
     {
-      if (sscanf(cache_dl1_opt, "%[^:]:%d:%d:%d:%c",
-		 name, &nsets, &bsize, &assoc, &c) != 5)
-	fatal("bad l1 D-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>");
+      ix = 'b';
+      if (sscanf(cache_dl1_opt, "%[^:]:%d:%d:%d:%c:%c",
+		 name, &nsets, &bsize, &assoc, &c, &ix) < 5)
+	fatal("bad l1 D-cache parms: "
+	      "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]");
       cache_dl1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			       /* usize */0, assoc, cache_char2policy(c),
-			       dl1_access_fn, /* hit lat */cache_dl1_lat);
+			       cache_str2wpolicy(cache_dl1_wpolicy_opt),
+			       dl1_access_fn, /* hit lat */cache_dl1_lat,
+			       /* sample */1);
+      cache_set_index(cache_dl1, cache_char2index(ix));
+      if (cache_dl1_wbuf)
+	cache_set_wbuf(cache_dl1, cache_dl1_wbuf);
+      cache_set_walloc(cache_dl1, cache_dl1_walloc);
+      if (cache_dl1_victim)
+	cache_set_victim(cache_dl1, cache_dl1_victim, cache_dl1_victim_lat);
+      cache_set_prefetch(cache_dl1, prefetch_parse(cache_dl1_pf_opt, cache_dl1));
+      if (cache_dl1_mshr)
+	cache_set_mshr(cache_dl1, cache_dl1_mshr, cache_dl1_mshr_targets);
 
       /* is the level 2 D-cache defined? */
       if (!mystricmp(cache_dl2_opt, "none"))
 	cache_dl2 = NULL;
       else
 	{
-	  if (sscanf(cache_dl2_opt, "%[^:]:%d:%d:%d:%c",
-		     name, &nsets, &bsize, &assoc, &c) != 5)
+	  ix = 'b';
+	  if (sscanf(cache_dl2_opt, "%[^:]:%d:%d:%d:%c:%c",
+		     name, &nsets, &bsize, &assoc, &c, &ix) < 5)
 	    fatal("bad l2 D-cache parms: "
-		  "<name>:<nsets>:<bsize>:<assoc>:<repl>");
+		  "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]");
 	  cache_dl2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 				   /* usize */0, assoc, cache_char2policy(c),
-				   dl2_access_fn, /* hit lat */cache_dl2_lat);
+				   cache_str2wpolicy(cache_dl2_wpolicy_opt),
+				   dl2_access_fn, /* hit lat */cache_dl2_lat,
+				   /* sample */cache_sample);
+	  cache_set_index(cache_dl2, cache_char2index(ix));
+	  if (cache_dl2_wbuf)
+	    cache_set_wbuf(cache_dl2, cache_dl2_wbuf);
+	  cache_set_walloc(cache_dl2, cache_dl2_walloc);
+	  if (cache_dl2_victim)
+	    cache_set_victim(cache_dl2, cache_dl2_victim,
+			     cache_dl2_victim_lat);
+	  cache_set_prefetch(cache_dl2,
+			     prefetch_parse(cache_dl2_pf_opt, cache_dl2));
+	  if (cache_dl2_mshr)
+	    cache_set_mshr(cache_dl2, cache_dl2_mshr, cache_dl2_mshr_targets);
 	}
     }
 
@@ -1067,12 +1624,17 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
     }
   else /* il1 is defined */
     {
-      if (sscanf(cache_il1_opt, "%[^:]:%d:%d:%d:%c",
-		 name, &nsets, &bsize, &assoc, &c) != 5)
-	fatal("bad l1 I-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>");
+      ix = 'b';
+      if (sscanf(cache_il1_opt, "%[^:]:%d:%d:%d:%c:%c",
+		 name, &nsets, &bsize, &assoc, &c, &ix) < 5)
+	fatal("bad l1 I-cache parms: "
+	      "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]");
       cache_il1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			       /* usize */0, assoc, cache_char2policy(c),
-			       il1_access_fn, /* hit lat */cache_il1_lat);
+			       /* wpolicy */WriteBack,
+			       il1_access_fn, /* hit lat */cache_il1_lat,
+			       /* sample */1);
+      cache_set_index(cache_il1, cache_char2index(ix));
 
       /* is the level 2 D-cache defined? */
       if (!mystricmp(cache_il2_opt, "none"))
@@ -1085,16 +1647,38 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 	}
       else
 	{
-	  if (sscanf(cache_il2_opt, "%[^:]:%d:%d:%d:%c",
-		     name, &nsets, &bsize, &assoc, &c) != 5)
+	  ix = 'b';
+	  if (sscanf(cache_il2_opt, "%[^:]:%d:%d:%d:%c:%c",
+		     name, &nsets, &bsize, &assoc, &c, &ix) < 5)
 	    fatal("bad l2 I-cache parms: "
-		  "<name>:<nsets>:<bsize>:<assoc>:<repl>");
+		  "<name>:<nsets>:<bsize>:<assoc>:<repl>[:<index>]");
 	  cache_il2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 				   /* usize */0, assoc, cache_char2policy(c),
-				   il2_access_fn, /* hit lat */cache_il2_lat);
+				   /* wpolicy */WriteBack,
+				   il2_access_fn, /* hit lat */cache_il2_lat,
+				   /* sample */cache_sample);
+	  cache_set_index(cache_il2, cache_char2index(ix));
 	}
     }
 
+  if (cache_sample > 1 && !cache_dl2 && !cache_il2)
+    fatal("set sampling needs an L2 cache, see -cache:dl2 and -cache:il2");
+
+  /* connect the caches to their next level, the L1 caches use the L2 bus
+     (or the memory bus if they have no L2), the L2 caches the memory bus */
+  bus_l2 = bus_parse("bus_l2", bus_l2_opt);
+  bus_mem = bus_parse("bus_mem", bus_mem_opt);
+  if (bus_l2 && !cache_dl2 && !cache_il2)
+    fatal("the L2 bus is defined but there are no l2 caches");
+  if (cache_dl1)
+    cache_set_bus(cache_dl1, cache_dl2 ? bus_l2 : bus_mem);
+  if (cache_il1 && cache_il1 != cache_dl1 && cache_il1 != cache_dl2)
+    cache_set_bus(cache_il1, cache_il2 ? bus_l2 : bus_mem);
+  if (cache_dl2)
+    cache_set_bus(cache_dl2, bus_mem);
+  if (cache_il2 && cache_il2 != cache_dl2)
+    cache_set_bus(cache_il2, bus_mem);
+
   /* use an I-TLB? */
   if (!mystricmp(itlb_opt, "none"))
     itlb = NULL;
@@ -1105,8 +1689,9 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>");
       itlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			  /* usize */sizeof(md_addr_t), assoc,
-			  cache_char2policy(c), itlb_access_fn,
-			  /* hit latency */1);
+			  cache_char2policy(c), /* wpolicy */WriteBack,
+			  itlb_access_fn, /* hit latency */1,
+			  /* sample */1);
     }
 
   /* use a D-TLB? */
@@ -1119,8 +1704,9 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>");
       dtlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			  /* usize */sizeof(md_addr_t), assoc,
-			  cache_char2policy(c), dtlb_access_fn,
-			  /* hit latency */1);
+			  cache_char2policy(c), /* wpolicy */WriteBack,
+			  dtlb_access_fn, /* hit latency */1,
+			  /* sample */1);
     }
 
   if (cache_dl1_lat < 1)
@@ -1144,9 +1730,145 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (mem_bus_width < 1 || (mem_bus_width & (mem_bus_width-1)) != 0)
     fatal("memory bus width must be positive non-zero and a power of two");
 
+  if (mystricmp(mem_dram_opt, "none"))
+    {
+      int channels, ranks, banks, row_size;
+
+      if (mem_dram_nelt != 3)
+	fatal("bad DRAM timing (<tRCD> <tCAS> <tRP>)");
+
+      if (sscanf(mem_dram_opt, "%d:%d:%d:%d",
+		 &channels, &ranks, &banks, &row_size) != 4)
+	fatal("bad DRAM config `%s', "
+	      "use <channels>:<ranks>:<banks>:<row_size>", mem_dram_opt);
+      dram = dram_create(channels, ranks, banks, row_size,
+			 dram_parse_policy(mem_dram_policy),
+			 mem_dram_timing[0], mem_dram_timing[1],
+			 mem_dram_timing[2], mem_bus_width, mem_lat[1]);
+    }
+
   if (tlb_miss_lat < 1)
     fatal("TLB miss latency must be greater than zero");
 
+  /* use a page table? */
+  if (!mystricmp(tlb_pt_opt, "none"))
+    page_table = NULL;
+  else
+    {
+      int levels;
+
+      if (sscanf(tlb_pt_opt, "%d", &levels) != 1)
+	fatal("bad page table levels `%s', use <levels> or none", tlb_pt_opt);
+      page_table = pt_create("pt", levels);
+
+      if (!mystricmp(tlb_walk_opt, "none"))
+	walk_cache = NULL;
+      else if (!mystricmp(tlb_walk_opt, "dl1"))
+	{
+	  if (!cache_dl1)
+	    fatal("page walker cannot read through dl1 as it's undefined");
+	  walk_cache = cache_dl1;
+	}
+      else if (!mystricmp(tlb_walk_opt, "dl2"))
+	{
+	  if (!cache_dl2)
+	    fatal("page walker cannot read through dl2 as it's undefined");
+	  walk_cache = cache_dl2;
+	}
+      else
+	fatal("bad page walk cache `%s', use dl1, dl2 or none", tlb_walk_opt);
+
+      if (tlb_walk_lat < 0)
+	fatal("page walk latency must be positive");
+    }
+
+  /* use physically indexed caches? */
+  if (!mystricmp(cache_pindex_opt, "none"))
+    cache_pindex = pindex_none;
+  else if (!mystricmp(cache_pindex_opt, "l2"))
+    cache_pindex = pindex_l2;
+  else if (!mystricmp(cache_pindex_opt, "all"))
+    cache_pindex = pindex_all;
+  else
+    fatal("bad physically indexed caches `%s', use none, l2 or all",
+	  cache_pindex_opt);
+
+  /* map pages for the page table and the physically indexed caches */
+  pmap = page_table;
+  if (!pmap && cache_pindex != pindex_none)
+    pmap = pt_create("pmap", /* levels */0);
+  if (pmap)
+    {
+      enum pt_alloc_t alloc = pt_parse_alloc(mem_palloc_opt);
+      struct cache_t *cp = cache_dl2 ? cache_dl2 : cache_dl1;
+
+      if (mem_pcolors < 0)
+	fatal("number of page colors must be non-negative");
+      if (alloc == pt_color && !mem_pcolors)
+	{
+	  if (!cp)
+	    fatal("page coloring without caches needs -mem:pcolors");
+	  mem_pcolors = MAX(cp->nsets * cp->bsize / MD_PAGE_SIZE, 1);
+	}
+      pt_set_alloc(pmap, alloc, mem_pcolors);
+    }
+
+  /* use a page walk cache? */
+  if (!mystricmp(tlb_pwc_opt, "none"))
+    pwc = NULL;
+  else
+    {
+      if (!page_table)
+	fatal("the page walk cache needs a page table, see -tlb:pt");
+      if (sscanf(tlb_pwc_opt, "%[^:]:%d:%d:%d:%c",
+		 name, &nsets, &bsize, &assoc, &c) != 5)
+	fatal("bad page walk cache parms: "
+	      "<name>:<nsets>:<bsize>:<assoc>:<repl>");
+      if (walk_cache && bsize > walk_cache->bsize)
+	fatal("page walk cache blocks must fit in `%s' blocks",
+	      walk_cache->name);
+      pwc = cache_create(name, nsets, bsize, /* balloc */FALSE,
+			 /* usize */0, assoc, cache_char2policy(c),
+			 /* wpolicy */WriteBack,
+			 pwc_access_fn, /* hit latency */1,
+			 /* sample */1);
+    }
+
+  /* use a second level TLB? */
+  if (!mystricmp(tlb_stlb_opt, "none"))
+    stlb = NULL;
+  else
+    {
+      if (sscanf(tlb_stlb_opt, "%[^:]:%d:%d:%d:%c",
+		 name, &nsets, &bsize, &assoc, &c) != 5)
+	fatal("bad TLB parms: <name>:<nsets>:<page_size>:<assoc>:<repl>");
+      if (tlb_stlb_lat < 1)
+	fatal("second level TLB latency must be greater than zero");
+      stlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
+			  /* usize */sizeof(md_addr_t), assoc,
+			  cache_char2policy(c), /* wpolicy */WriteBack,
+			  stlb_access_fn, /* hit latency */tlb_stlb_lat,
+			  /* sample */1);
+    }
+
+  /* classify the misses of all caches and TLBs? */
+  if (cache_classify)
+    {
+      struct cache_t *caches[] = {
+	cache_il1, cache_il2, cache_dl1, cache_dl2, itlb, dtlb, pwc, stlb
+      };
+      int i, j;
+
+      for (i=0; i<N_ELT(caches); i++)
+	{
+	  /* shared caches get one shadow */
+	  for (j=0; j<i && caches[j] != caches[i]; j++)
+	    /* nada */;
+	  if (caches[i] && j == i)
+	    cache_set_classify(caches[i], TRUE);
+	}
+    }
+
   if (res_ialu < 1)
     fatal("number of integer ALU's must be greater than zero");
   if (res_ialu > MAX_INSTS_PER_CLASS)
@@ -1182,7 +1904,14 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 void
 sim_aux_config(FILE *stream)            /* output stream */
 {
-  /* nada */
+  if (pmap)
+    pt_config(pmap, stream);
+  if (bus_l2)
+    bus_config(bus_l2, stream);
+  if (bus_mem)
+    bus_config(bus_mem, stream);
+  if (dram)
+    dram_config(dram, stream);
 }
 
 /* register simulator-specific statistics */
@@ -1190,6 +1919,8 @@ void
 sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
 {
   int i;
+  char buf[512], buf1[512];
+
   stat_reg_counter(sdb, "sim_num_insn",
 		   "total number of instructions committed",
 		   &sim_num_insn, sim_num_insn, NULL);
@@ -1312,6 +2043,73 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
     cache_reg_stats(itlb, sdb);
   if (dtlb)
     cache_reg_stats(dtlb, sdb);
+  if (stlb)
+    cache_reg_stats(stlb, sdb);
+  if (pwc)
+    cache_reg_stats(pwc, sdb);
+
+  /* page walks */
+  if (page_table)
+    {
+      pt_reg_stats(page_table, sdb);
+      stat_reg_counter(sdb, "tlb_walk_cycles",
+		       "total cycles spent walking the page table",
+		       &tlb_walk_cycles, /* initial value */0, /* format */NULL);
+      stat_reg_formula(sdb, "tlb_avg_walk_lat",
+		       "average page walk latency (in cycles)",
+		       "tlb_walk_cycles / pt.walks", NULL);
+    }
+  else if (pmap)
+    pt_reg_stats(pmap, sdb);
+
+  /* MSHR occupancy over the whole run */
+  if (cache_dl1 && cache_dl1->mshr)
+    {
+      stat_reg_counter(sdb, "sim_mshr_stalls",
+		       "total load issue stalls on full dl1 MSHRs",
+		       &sim_mshr_stalls, /* initial value */0, /* format */NULL);
+      sprintf(buf, "%s.mshr_avg_occupancy", cache_dl1->name);
+      sprintf(buf1, "%s.mshr_busy_cycles / sim_cycle", cache_dl1->name);
+      stat_reg_formula(sdb, buf, "average MSHRs in use per cycle", buf1, NULL);
+    }
+  if (cache_dl2 && cache_dl2->mshr)
+    {
+      sprintf(buf, "%s.mshr_avg_occupancy", cache_dl2->name);
+      sprintf(buf1, "%s.mshr_busy_cycles / sim_cycle", cache_dl2->name);
+      stat_reg_formula(sdb, buf, "average MSHRs in use per cycle", buf1, NULL);
+    }
+
+  /* bus utilization over the whole run */
+  if (bus_l2)
+    {
+      bus_reg_stats(bus_l2, sdb);
+      sprintf(buf1, "bus_l2.busy_cycles / (sim_cycle * %d)", bus_l2->channels);
+      stat_reg_formula(sdb, "bus_l2.util",
+		       "fraction of cycles the L2 bus channels were busy",
+		       buf1, NULL);
+    }
+  if (bus_mem)
+    {
+      bus_reg_stats(bus_mem, sdb);
+      sprintf(buf1, "bus_mem.busy_cycles / (sim_cycle * %d)",
+	      bus_mem->channels);
+      stat_reg_formula(sdb, "bus_mem.util",
+		       "fraction of cycles the memory bus channels were busy",
+		       buf1, NULL);
+    }
+
+  /* DRAM bandwidth and utilization over the whole run */
+  if (dram)
+    {
+      dram_reg_stats(dram, sdb);
+      stat_reg_formula(sdb, "dram.bandwidth",
+		       "DRAM bandwidth, in bytes per cycle",
+		       "dram.bytes / sim_cycle", NULL);
+      sprintf(buf1, "dram.bus_cycles / (sim_cycle * %d)", dram->channels);
+      stat_reg_formula(sdb, "dram.bus_util",
+		       "fraction of cycles the DRAM data buses were busy",
+		       buf1, NULL);
+    }
 
   /* debug variable(s) */
   stat_reg_counter(sdb, "sim_invalid_addrs",
@@ -1446,12 +2244,17 @@ sim_aux_stats(FILE *stream)             /* output stream */
   /* nada */
 }
 
+static void warm_save(void);
+
 /* un-initialize the simulator */
 void
 sim_uninit(void)
 {
   if (ptrace_nelt > 0)
     ptrace_close();
+
+  if (warm_save_opt)
+    warm_save();
 }
 
 
@@ -2185,8 +2988,11 @@ ruu_commit(void)
 		  if (cache_dl1)
 		    {
 		      /* commit store value to D-cache */
+		      cache_dl1->pc = LSQ[LSQ_head].PC;
 		      lat =
-			cache_access(cache_dl1, Write, (LSQ[LSQ_head].addr&~3),
+			cache_access(cache_dl1, Write,
+				     CACHE_ADDR(LSQ[LSQ_head].addr&~3,
+						pindex_all),
 				     NULL, 4, sim_cycle, NULL, NULL);
 		      if (lat > cache_dl1_lat)
 			events |= PEV_CACHEMISS;
@@ -2596,6 +3402,28 @@ lsq_refresh(void)
 }
 
 
+/* return non-zero if load RS would have to wait for an l1 data cache MSHR
+   (or MSHR target), such loads are held back in the ready queue */
+static int
+ruu_load_mshr_stall(struct RUU_station *rs)	/* load to issue */
+{
+  int i;
+
+  if (!cache_dl1 || !MD_VALID_ADDR(rs->addr)
+      || cache_mshr_avail(cache_dl1, (rs->addr & ~3), sim_cycle))
+    return FALSE;
+
+  /* loads forwarded from a store in the LSQ do not access the cache */
+  for (i = (rs - LSQ); i != LSQ_head; )
+    {
+      i = (i + (LSQ_size-1)) % LSQ_size;
+      if ((MD_OP_FLAGS(LSQ[i].op) & F_STORE) && (LSQ[i].addr == rs->addr))
+	return FALSE;
+    }
+  return TRUE;
+}
+
+
 /*
  *  RUU_ISSUE() - issue instructions to functional units
  */
@@ -2667,6 +3495,15 @@ ruu_issue(void)
 	      /* one more inst issued */
 	      n_issued++;
 	    }
+	  else if (rs->in_LSQ
+		   && ((MD_OP_FLAGS(rs->op) & (F_MEM|F_LOAD)) == (F_MEM|F_LOAD))
+		   && ruu_load_mshr_stall(rs))
+	    {
+	      /* no MSHR for the load, put it back onto the ready list, we'll
+		 try to issue it again next cycle */
+	      sim_mshr_stalls++;
+	      readyq_enqueue(rs);
+	    }
 	  else
 	    {
 	      /* issue the instruction to a functional unit */
@@ -2730,10 +3567,13 @@ ruu_issue(void)
 			      if (cache_dl1 && valid_addr)
 				{
 				  /* access the cache if non-faulting */
+				  cache_dl1->pc = rs->PC;
 				  load_lat =
 				    cache_access(cache_dl1, Read,
-						 (rs->addr & ~3), NULL, 4,
-						 sim_cycle, NULL, NULL);
+						 CACHE_ADDR(rs->addr & ~3,
+							    pindex_all),
+						 NULL, 4, sim_cycle,
+						 NULL, NULL);
 				  if (load_lat > cache_dl1_lat)
 				    events |= PEV_CACHEMISS;
 				}
@@ -4231,7 +5071,9 @@ ruu_fetch(void)
 	    {
 	      /* access the I-cache */
 	      lat =
-		cache_access(cache_il1, Read, IACOMPRESS(fetch_regs_PC),
+		cache_access(cache_il1, Read,
+			     CACHE_ADDR(IACOMPRESS(fetch_regs_PC),
+					pindex_all),
 			     NULL, ISCOMPRESS(sizeof(md_inst_t)), sim_cycle,
 			     NULL, NULL);
 	      if (lat > cache_il1_lat)
@@ -4421,6 +5263,146 @@ simoo_mstate_obj(FILE *stream,			/* output stream */
 }
 
 
+/* maximum number of structures with warm state */
+#define MAX_WARM_ENTS		11
+
+/* a structure with warm state, a cache (or TLB), a page table or the
+   branch predictor */
+struct warm_ent_t
+{
+  struct cache_t *cp;		/* cache, or NULL */
+  struct pt_t *pt;		/* page table, or NULL */
+  struct bpred_t *pred;		/* branch predictor, or NULL */
+  int restored;			/* restored from the warm state file? */
+};
+
+/* return the caches, TLBs, page tables and branch predictor in ENTS, each
+   one once, returns their number */
+static int
+warm_ents(struct warm_ent_t *ents)	/* structures with warm state */
+{
+  struct cache_t *caches[8];
+  int i, j, n = 0;
+
+  caches[0] = cache_il1; caches[1] = cache_il2;
+  caches[2] = cache_dl1; caches[3] = cache_dl2;
+  caches[4] = itlb; caches[5] = dtlb;
+  caches[6] = stlb; caches[7] = pwc;
+  for (i=0; i<8; i++)
+    {
+      for (j=0; j<i && caches[j] != caches[i]; j++)
+	/* nada */;
+      if (caches[i] && j == i)
+	{
+	  ents[n].cp = caches[i];
+	  ents[n].pt = NULL;
+	  ents[n++].pred = NULL;
+	}
+    }
+
+  if (page_table)
+    {
+      ents[n].cp = NULL;
+      ents[n].pt = page_table;
+      ents[n++].pred = NULL;
+    }
+  if (pmap && pmap != page_table)
+    {
+      ents[n].cp = NULL;
+      ents[n].pt = pmap;
+      ents[n++].pred = NULL;
+    }
+  if (pred)
+    {
+      ents[n].cp = NULL;
+      ents[n].pt = NULL;
+      ents[n++].pred = pred;
+    }
+
+  for (i=0; i<n; i++)
+    ents[i].restored = FALSE;
+  return n;
+}
+
+/* name of the warm state section of structure ENT */
+#define WARM_ENT_NAME(ENT)						\
+  ((ENT)->cp ? (ENT)->cp->name : (ENT)->pt ? (ENT)->pt->name : "bpred")
+
+/* save the warm state to the -warm:save file, the state belongs to the
+   next non-speculative instruction to dispatch (SIM_NUM_INSN counts the
+   non-speculative instructions dispatched) */
+static void
+warm_save(void)
+{
+  struct warm_ent_t ents[MAX_WARM_ENTS];
+  struct warm_t *w;
+  counter_t icnt = sim_num_insn + fastfwd_count;
+  int i, n;
+
+  myfprintf(stderr, "sim: writing warm state file `%s' @ inst %n...\n",
+	    warm_save_opt, icnt);
+
+  /* the next PC is the recovery PC on a mis-speculated path, and is not
+     known before the first dispatch */
+  w = warm_create(warm_save_opt, icnt,
+		  !sim_num_insn ? 0 : spec_mode ? recover_PC : regs.regs_NPC);
+  n = warm_ents(ents);
+  for (i=0; i<n; i++)
+    {
+      if (ents[i].cp)
+	cache_save(ents[i].cp, w);
+      else if (ents[i].pt)
+	pt_save(ents[i].pt, w);
+      else
+	bpred_save(ents[i].pred, w);
+    }
+  warm_close(w);
+}
+
+/* restore the warm state from the -warm:load file, at the start of timing
+   simulation */
+static void
+warm_load(void)
+{
+  struct warm_ent_t ents[MAX_WARM_ENTS];
+  struct warm_t *w;
+  counter_t icnt = sim_num_insn + fastfwd_count;
+  char *name;
+  int i, n;
+
+  n = warm_ents(ents);
+
+  fprintf(stderr, "sim: loading warm state file: %s\n", warm_load_opt);
+  w = warm_open(warm_load_opt);
+  if (w->icnt != icnt || (w->pc && w->pc != regs.regs_PC))
+    fatal("warm state `%s' was saved @ inst %n, timing starts @ inst %n",
+	  warm_load_opt, w->icnt, icnt);
+
+  while ((name = warm_next(w)) != NULL)
+    {
+      for (i=0; i<n; i++)
+	{
+	  if (ents[i].restored || strcmp(WARM_ENT_NAME(&ents[i]), name))
+	    continue;
+
+	  if (ents[i].cp)
+	    cache_restore(ents[i].cp, w);
+	  else if (ents[i].pt)
+	    pt_restore(ents[i].pt, w);
+	  else
+	    bpred_restore(ents[i].pred, w);
+	  ents[i].restored = TRUE;
+	  break;
+	}
+    }
+  warm_close(w);
+
+  for (i=0; i<n; i++)
+    if (!ents[i].restored)
+      warn("`%s' is not in warm state `%s', it starts cold",
+	   WARM_ENT_NAME(&ents[i]), warm_load_opt);
+}
+
 /* start simulation, program loaded, processor precise state initialized */
 void
 sim_main(void)
@@ -4519,6 +5501,10 @@ sim_main(void)
 	}
     }
 
+  /* restore the warm state, before any structure is accessed */
+  if (warm_load_opt)
+    warm_load();
+
   fprintf(stderr, "sim: ** starting performance simulation **\n");
 
   /* set up timing simulation entry state */
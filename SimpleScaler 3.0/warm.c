@@ -0,0 +1,285 @@
+/* warm.c - warm microarchitectural state file routines */
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "warm.h"
+
+/* warm state file magic string */
+#define WARM_MAGIC		"SSWARMST"
+#define WARM_MAGIC_LEN		8
+
+/* longest structure name */
+#define WARM_MAX_NAME		256
+
+/* allocate a warm state file FNAME, opened for writing (WRITING) or
+   reading */
+static struct warm_t *
+warm_alloc(char *fname, int writing)
+{
+  struct warm_t *w;
+
+  w = (struct warm_t *)calloc(1, sizeof(struct warm_t));
+  if (!w)
+    fatal("out of virtual memory");
+  w->name = (char *)calloc(WARM_MAX_NAME+1, sizeof(char));
+  if (!w->name)
+    fatal("out of virtual memory");
+
+  w->fname = mystrdup(fname);
+  w->writing = writing;
+  w->fd = gzopen(fname, writing ? "w" : "r");
+  if (!w->fd)
+    fatal("cannot open warm state file `%s'", fname);
+
+  w->buf = NULL;
+  w->size = w->nbytes = w->pos = 0;
+
+  return w;
+}
+
+/* write NBYTES bytes at P to warm state file W */
+static void
+warm_write(struct warm_t *w, void *p, int nbytes)
+{
+  if (nbytes && fwrite(p, nbytes, 1, w->fd) != 1)
+    fatal("cannot write warm state file `%s'", w->fname);
+}
+
+/* read NBYTES bytes of warm state file W to P */
+static void
+warm_read(struct warm_t *w, void *p, int nbytes)
+{
+  if (nbytes && fread(p, nbytes, 1, w->fd) != 1)
+    fatal("warm state file `%s' is truncated", w->fname);
+}
+
+/* grow the section buffer of warm state file W to hold NBYTES bytes */
+static void
+warm_grow(struct warm_t *w, int nbytes)
+{
+  if (nbytes <= w->size)
+    return;
+
+  w->size = MAX(nbytes, 2*w->size);
+  w->buf = (unsigned char *)realloc(w->buf, w->size);
+  if (!w->buf)
+    fatal("out of virtual memory");
+}
+
+/* create warm state file FNAME, for the state at instruction ICNT and PC */
+struct warm_t *				/* warm state file created */
+warm_create(char *fname,		/* warm state file name */
+	    counter_t icnt,		/* instructions executed */
+	    md_addr_t pc)		/* PC of next instruction, or 0 */
+{
+  struct warm_t *w;
+  word_t version = WARM_VERSION, addr_size = sizeof(md_addr_t);
+
+  w = warm_alloc(fname, /* writing */TRUE);
+  w->icnt = icnt;
+  w->pc = pc;
+
+  warm_write(w, WARM_MAGIC, WARM_MAGIC_LEN);
+  warm_write(w, &version, sizeof(word_t));
+  warm_write(w, &addr_size, sizeof(word_t));
+  warm_write(w, &w->icnt, sizeof(counter_t));
+  warm_write(w, &w->pc, sizeof(md_addr_t));
+
+  return w;
+}
+
+/* open warm state file FNAME for reading */
+struct warm_t *				/* warm state file opened */
+warm_open(char *fname)			/* warm state file name */
+{
+  struct warm_t *w;
+  char magic[WARM_MAGIC_LEN];
+  word_t version, addr_size;
+
+  w = warm_alloc(fname, /* writing */FALSE);
+
+  if (fread(magic, WARM_MAGIC_LEN, 1, w->fd) != 1
+      || memcmp(magic, WARM_MAGIC, WARM_MAGIC_LEN) != 0)
+    fatal("`%s' is not a warm state file", fname);
+
+  /* a file written on a host of the other byte order has a bad version */
+  warm_read(w, &version, sizeof(word_t));
+  warm_read(w, &addr_size, sizeof(word_t));
+  if (version != WARM_VERSION || addr_size != sizeof(md_addr_t))
+    fatal("warm state file `%s' has incompatible version", fname);
+
+  warm_read(w, &w->icnt, sizeof(counter_t));
+  warm_read(w, &w->pc, sizeof(md_addr_t));
+
+  return w;
+}
+
+/* close warm state file W */
+void
+warm_close(struct warm_t *w)		/* warm state file to close */
+{
+  gzclose(w->fd);
+  if (w->buf)
+    free(w->buf);
+  free(w->name);
+  free(w->fname);
+  free(w);
+}
+
+/* start the section of the structure named NAME in warm state file W,
+   written out by warm_end() */
+void
+warm_begin(struct warm_t *w,		/* warm state file to write */
+	   char *name)			/* structure name */
+{
+  if (!w->writing)
+    panic("warm state file `%s' is not open for writing", w->fname);
+  if (strlen(name) > WARM_MAX_NAME)
+    fatal("structure name `%s' is too long for a warm state file", name);
+
+  strcpy(w->name, name);
+  w->nbytes = 0;
+}
+
+/* write the current section of warm state file W */
+void
+warm_end(struct warm_t *w)		/* warm state file to write */
+{
+  word_t namelen = strlen(w->name), nbytes = w->nbytes;
+
+  warm_write(w, &namelen, sizeof(word_t));
+  warm_write(w, w->name, namelen);
+  warm_write(w, &nbytes, sizeof(word_t));
+  warm_write(w, w->buf, w->nbytes);
+  w->nbytes = 0;
+}
+
+/* read the next section of warm state file W, returns the name of its
+   structure, or NULL at the end of the file */
+char *					/* structure name, or NULL */
+warm_next(struct warm_t *w)		/* warm state file to read */
+{
+  word_t namelen, nbytes;
+
+  if (w->writing)
+    panic("warm state file `%s' is not open for reading", w->fname);
+
+  if (fread(&namelen, sizeof(word_t), 1, w->fd) != 1)
+    return NULL;
+  if (namelen > WARM_MAX_NAME)
+    fatal("warm state file `%s' is corrupted", w->fname);
+  warm_read(w, w->name, namelen);
+  w->name[namelen] = '\0';
+
+  warm_read(w, &nbytes, sizeof(word_t));
+  if (nbytes > (word_t)0x7fffffff)
+    fatal("warm state file `%s' is corrupted", w->fname);
+  warm_grow(w, nbytes);
+  warm_read(w, w->buf, nbytes);
+  w->nbytes = nbytes;
+  w->pos = 0;
+
+  return w->name;
+}
+
+/* append NBYTES bytes at P to the current section of warm state file W */
+void
+warm_put(struct warm_t *w,		/* warm state file to write */
+	 void *p,			/* state to write */
+	 int nbytes)			/* number of bytes */
+{
+  if (nbytes > 0x7fffffff - w->nbytes)
+    fatal("state of `%s' is too large for a warm state file", w->name);
+  warm_grow(w, w->nbytes + nbytes);
+  memcpy(w->buf + w->nbytes, p, nbytes);
+  w->nbytes += nbytes;
+}
+
+/* read NBYTES bytes of the current section of warm state file W to P */
+void
+warm_get(struct warm_t *w,		/* warm state file to read */
+	 void *p,			/* state read */
+	 int nbytes)			/* number of bytes */
+{
+  if (nbytes > w->nbytes - w->pos)
+    fatal("warm state of `%s' in `%s' is truncated", w->name, w->fname);
+  memcpy(p, w->buf + w->pos, nbytes);
+  w->pos += nbytes;
+}
+
+/* transfer a configuration parameter WHAT of value VAL, written to warm
+   state file W if it is being written, otherwise read and checked against
+   VAL, a structure configured differently than the one saved is fatal */
+void
+warm_check(struct warm_t *w,		/* warm state file */
+	   char *what,			/* parameter name */
+	   int val)			/* parameter value */
+{
+  int saved;
+
+  if (w->writing)
+    {
+      warm_put(w, &val, sizeof(int));
+      return;
+    }
+
+  warm_get(w, &saved, sizeof(int));
+  if (saved != val)
+    fatal("warm state of `%s' in `%s' has %s %d, not %d",
+	  w->name, w->fname, what, saved, val);
+}
@@ -0,0 +1,154 @@
+/* warm.h - warm microarchitectural state file interfaces */
+
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef WARM_H
+#define WARM_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+
+/*
+ * A warm state file holds the microarchitectural state of the caches, TLBs,
+ * page tables and branch predictors of a simulator, so that later runs can
+ * start from warm structures instead of simulating the warm-up again.  The
+ * state belongs to a point in the execution of the program, given by the
+ * instruction count and PC of that point, e.g., the point at which an EIO
+ * checkpoint was written (see eio_write_chkpt()), a run loading the state
+ * must start there.  The file is a short header followed by sections, one
+ * per structure, named after the structure:
+ *
+ *	header:	"SSWARMST" <version:4> <sizeof(md_addr_t):4> <icnt:8> <pc>
+ *	section: <namelen:4> <name> <nbytes:4> <nbytes of state>
+ *
+ * The state of a structure starts with its configuration, a run loading a
+ * section into a structure configured differently fails, sections of
+ * structures the run does not have are skipped.  Values are stored in host
+ * byte order, so warm state files are only portable between hosts of the
+ * same byte order.  Files with names ending in ".gz" are compressed with
+ * gzip.
+ */
+
+/* warm state file format version, bump it when the state saved by any
+   structure changes */
+#define WARM_VERSION		1
+
+/* an open warm state file */
+struct warm_t {
+  char *fname;			/* warm state file name */
+  FILE *fd;			/* warm state file */
+  int writing;			/* file is open for writing? */
+
+  /* point in the execution the state belongs to */
+  counter_t icnt;		/* instructions executed before the point */
+  md_addr_t pc;			/* PC of the next instruction, 0 if unknown */
+
+  /* current section, buffered whole */
+  char *name;			/* structure name */
+  unsigned char *buf;		/* state of the structure */
+  int size;			/* size of the buffer */
+  int nbytes;			/* bytes of state in buffer */
+  int pos;			/* read position in buffer */
+};
+
+/* create warm state file FNAME, for the state at instruction ICNT and PC */
+struct warm_t *				/* warm state file created */
+warm_create(char *fname,		/* warm state file name */
+	    counter_t icnt,		/* instructions executed */
+	    md_addr_t pc);		/* PC of next instruction, or 0 */
+
+/* open warm state file FNAME for reading */
+struct warm_t *				/* warm state file opened */
+warm_open(char *fname);			/* warm state file name */
+
+/* close warm state file W */
+void
+warm_close(struct warm_t *w);		/* warm state file to close */
+
+/* start the section of the structure named NAME in warm state file W,
+   written out by warm_end() */
+void
+warm_begin(struct warm_t *w,		/* warm state file to write */
+	   char *name);			/* structure name */
+
+/* write the current section of warm state file W */
+void
+warm_end(struct warm_t *w);		/* warm state file to write */
+
+/* read the next section of warm state file W, returns the name of its
+   structure, or NULL at the end of the file */
+char *					/* structure name, or NULL */
+warm_next(struct warm_t *w);		/* warm state file to read */
+
+/* append NBYTES bytes at P to the current section of warm state file W */
+void
+warm_put(struct warm_t *w,		/* warm state file to write */
+	 void *p,			/* state to write */
+	 int nbytes);			/* number of bytes */
+
+/* read NBYTES bytes of the current section of warm state file W to P */
+void
+warm_get(struct warm_t *w,		/* warm state file to read */
+	 void *p,			/* state read */
+	 int nbytes);			/* number of bytes */
+
+/* transfer a configuration parameter WHAT of value VAL, written to warm
+   state file W if it is being written, otherwise read and checked against
+   VAL, a structure configured differently than the one saved is fatal */
+void
+warm_check(struct warm_t *w,		/* warm state file */
+	   char *what,			/* parameter name */
+	   int val);			/* parameter value */
+
+#endif /* WARM_H */
@@ -1,37 +1,58 @@
 /* cache.c - cache module routines (patched: selectable Write-Back / Write-Through)
  *
  * Based on SimpleScalar 3.0 cache.c
- * Adds a compile-time switch to select WRITE-BACK (default) or WRITE-THROUGH.
+ * Adds a per-cache write policy, WRITE-BACK (default) or WRITE-THROUGH,
+ * selected when the cache is created, and a contiguous per-set tag store.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "host.h"
 #include "misc.h"
 #include "machine.h"
 #include "cache.h"
-
-/* ---------------- WRITE POLICY CONTROL ---------------- */
-#define WRITE_BACK     1
-#define WRITE_THROUGH  2
-
-/* SELECT WRITE POLICY HERE (default: WRITE_BACK) */
-#ifndef WRITE_POLICY
-#define WRITE_POLICY WRITE_THROUGH /* change to WRITE_THROUGH for comparison */
-#endif
-
-/* cache access macros */
+#include "prefetch.h"
+#include "reuse.h"
+#include "bus.h"
+#include "warm.h"
+
+/* cache access macros, the set index is the index bits of the address,
+   with its low tag bits XORed in by IndexXOR, or the block address modulo
+   INDEX_PRIME by IndexPrime, a skewed-associative cache indexes each way
+   with its own hash, see cache_skew_set(), CACHE_SET is that of way 0 */
 #define CACHE_TAG(cp, addr)	((addr) >> (cp)->tag_shift)
-#define CACHE_SET(cp, addr)	(((addr) >> (cp)->set_shift) & (cp)->set_mask)
+#define CACHE_SET(cp, addr)						\
+  ((cp)->index_prime							\
+   ? (((addr) >> (cp)->set_shift) % (cp)->index_prime)			\
+   : ((((addr) >> (cp)->set_shift)					\
+       ^ (((addr) >> (cp)->index_shift) & (cp)->index_xor))		\
+      & (cp)->set_mask))
+/* set index of a cache indexed by the bits of the address, see EXTRAS */
+#define CACHE_BITS_SET(cp, addr)					\
+  (((addr) >> (cp)->set_shift) & (cp)->set_mask)
 #define CACHE_BLK(cp, addr)	((addr) & (cp)->blk_mask)
 #define CACHE_TAGSET(cp, addr)	((addr) & (cp)->tagset_mask)
 
-/* extract/reconstruct a block address */
+/* extract/reconstruct a block address, the tags of caches not indexed by
+   bits of the address (INDEX_MASK is 0) are whole block addresses */
 #define CACHE_BADDR(cp, addr)	((addr) & ~(cp)->blk_mask)
 #define CACHE_MK_BADDR(cp, tag, set)					\
-  (((tag) << (cp)->tag_shift)|((set) << (cp)->set_shift))
+  (((tag) << (cp)->tag_shift)						\
+   |((((((set) + (cp)->sample_first) * (cp)->sample_inv)		\
+       ^ ((tag) & (cp)->index_xor)) & (cp)->index_mask)			\
+     << (cp)->set_shift))
+
+/* map set SET of a set-sampled cache to the set modelled for it, the
+   set is not modelled if the result is not below SAMPLE_NSETS, the hash
+   is a bijection, so SAMPLE_INV maps a modelled set back */
+#define CACHE_SAMPLE_SET(cp, set)					\
+  ((((set) * (cp)->sample_mult) & (cp)->set_mask) - (cp)->sample_first)
+
+/* odd multiplier hashing the set index of a set-sampled cache */
+#define SAMPLE_MULT		0x9e3779b1
 
 /* index an array of cache blocks, non-trivial due to variable length blocks */
 #define CACHE_BINDEX(cp, blks, i)					\
@@ -57,6 +78,36 @@
 #define CACHE_HASH(cp, key)						\
   (((key >> 24) ^ (key >> 16) ^ (key >> 8) ^ key) & ((cp)->hsize-1))
 
+/* pseudo-LRU state bits of set SET, and accessors for bit I of the bits */
+#define CACHE_PLRU(cp, set)	((cp)->plru + (set)*(cp)->plru_stride)
+#define PLRU_BIT(bits, i)	(((bits)[(i) >> 3] >> ((i) & 7)) & 1)
+#define PLRU_SET(bits, i)	((bits)[(i) >> 3] |= (1 << ((i) & 7)))
+#define PLRU_CLR(bits, i)	((bits)[(i) >> 3] &= ~(1 << ((i) & 7)))
+
+/* mark set SET of cache CP as holding a dirty block, and test the mark */
+#define CACHE_MARK_DIRTY(cp, set)					\
+  ((cp)->dirty_sets[(set) >> 5] |= (1u << ((set) & 31)))
+#define CACHE_SET_DIRTY(cp, set)					\
+  (((cp)->dirty_sets[(set) >> 5] >> ((set) & 31)) & 1)
+
+/* tag store of set SET, and way of block BLK in set SET */
+#define CACHE_SET_TAGS(cp, set)	((cp)->tags + (set)*(cp)->assoc)
+#define CACHE_WAY(cp, set, blk)						\
+  ((((char *)(blk)) - ((char *)(cp)->sets[set].blks))			\
+   / (sizeof(struct cache_blk_t)					\
+      + ((cp)->balloc ? (cp)->bsize*sizeof(byte_t) : 0)))
+
+/* set of block BLK, the blocks of the sets are allocated in set order */
+#define CACHE_BLK_SET(cp, blk)						\
+  ((md_addr_t)((((char *)(blk)) - ((char *)(cp)->data))			\
+	       / (sizeof(struct cache_blk_t)				\
+		  + ((cp)->balloc ? (cp)->bsize*sizeof(byte_t) : 0))	\
+	       / (cp)->assoc))
+
+/* odd multiplier of the tag bits hashed into the set of way WAY of a
+   skewed-associative cache */
+#define SKEW_MULT(way)		(SAMPLE_MULT * (2*(unsigned int)(way) + 1))
+
 /* copy data out of a cache block to buffer indicated by argument pointer p */
 #define CACHE_BCOPY(cmd, blk, bofs, p, nbytes)	\
   if (cmd == Read)							\
@@ -103,6 +154,15 @@
 /* bound sqword_t/dfloat_t to positive int */
 #define BOUND_POS(N)		((int)(MIN(MAX(0, (N)), 2147483647)))
 
+/* next pseudo-random number of cache CP, a simple LCG that keeps its state
+   in the cache, returns 15 random bits */
+static int
+cache_rand(struct cache_t *cp)
+{
+  cp->rand_state = cp->rand_state * 1103515245 + 12345;
+  return (cp->rand_state >> 16) & 0x7fff;
+}
+
 /* unlink BLK from the hash table bucket chain in SET */
 static void
 unlink_htab_ent(struct cache_t *cp, struct cache_set_t *set, struct cache_blk_t *blk)
@@ -128,6 +188,216 @@ link_htab_ent(struct cache_t *cp, struct cache_set_t *set, struct cache_blk_t *b
   set->hash[index] = blk;
 }
 
+/* return the way of set SET of cache CP holding a valid block with tag TAG,
+   or -1 if the tag misses, the tags of a set are contiguous, so the loop
+   only touches the tag store */
+static INLINE int
+cache_find_way(struct cache_t *cp, md_addr_t set, md_addr_t tag)
+{
+  md_addr_t *tags = CACHE_SET_TAGS(cp, set);
+  int way;
+
+  for (way=0; way < cp->assoc; way++)
+    if (tags[way] == tag)
+      return way;
+  return -1;
+}
+
+/* set of way WAY of skewed-associative cache CP for the block with tag
+   TAG, i.e., block address, way 0 is XOR indexed, the other ways XOR a
+   multiplicative hash of the tag bits of their own into the index bits,
+   so blocks that conflict in one way are spread over the others */
+static INLINE md_addr_t
+cache_skew_set(struct cache_t *cp, md_addr_t tag, int way)
+{
+  md_addr_t hi = tag >> (cp->index_shift - cp->set_shift);
+
+  if (way)
+    hi = (unsigned int)(hi * SKEW_MULT(way))
+      >> (32 - (cp->index_shift - cp->set_shift));
+  return (tag ^ hi) & cp->set_mask;
+}
+
+/* return the valid block of skewed-associative cache CP with tag TAG, or
+   NULL if the tag misses, each way is looked up in its own set, the set
+   and way of the block are returned in *SETP and *WAYP */
+static struct cache_blk_t *
+cache_find_skew_blk(struct cache_t *cp, md_addr_t tag, md_addr_t *setp,
+		    int *wayp)
+{
+  md_addr_t set;
+  int way;
+
+  for (way=0; way<cp->assoc; way++)
+    {
+      set = cache_skew_set(cp, tag, way);
+      if (CACHE_SET_TAGS(cp, set)[way] == tag)
+	{
+	  *setp = set;
+	  *wayp = way;
+	  return CACHE_BINDEX(cp, cp->sets[set].blks, way);
+	}
+    }
+  *wayp = -1;
+  return NULL;
+}
+
+/* return the valid block of set *SETP of cache CP with tag TAG, or NULL if
+   the tag misses, highly associative caches walk a hash bucket chain rather
+   than search the whole tag store; the way of the block is returned in
+   *WAYP, or -1 if a hash chain was walked (use CACHE_WAY), the set of a
+   skewed-associative cache depends on the way, it is returned in *SETP */
+static INLINE struct cache_blk_t *
+cache_find_blk(struct cache_t *cp, md_addr_t *setp, md_addr_t tag, int *wayp)
+{
+  struct cache_blk_t *blk;
+  md_addr_t set = *setp;
+
+  if (cp->index == IndexSkew)
+    return cache_find_skew_blk(cp, tag, setp, wayp);
+
+  if (cp->hsize)
+    {
+      int hindex = CACHE_HASH(cp, tag);
+      *wayp = -1;
+      for (blk=cp->sets[set].hash[hindex]; blk; blk=blk->hash_next)
+	if (blk->tag == tag
+	    && CACHE_SET_TAGS(cp, set)[CACHE_WAY(cp, set, blk)] == tag)
+	  return blk;
+      return NULL;
+    }
+
+  *wayp = cache_find_way(cp, set, tag);
+  return *wayp >= 0 ? CACHE_BINDEX(cp, cp->sets[set].blks, *wayp) : NULL;
+}
+
+/* update the pseudo-LRU state of set SET for an access to way WAY */
+static void
+plru_touch(struct cache_t *cp, md_addr_t set, int way)
+{
+  byte_t *bits = CACHE_PLRU(cp, set);
+  int node, i;
+
+  if (cp->policy == TreePLRU)
+    {
+      /* the tree is a heap of ASSOC-1 nodes over the ways (the leaves are
+	 nodes ASSOC..2*ASSOC-1), each node bit points toward the half of
+	 its subtree to replace, so point the nodes above WAY away from it */
+      for (node=way+cp->assoc; node > 1; node >>= 1)
+	{
+	  if (node & 1)
+	    PLRU_CLR(bits, (node >> 1) - 1);
+	  else
+	    PLRU_SET(bits, (node >> 1) - 1);
+	}
+    }
+  else /* BitPLRU */
+    {
+      /* mark WAY recently used, once all ways are, only WAY remains so */
+      PLRU_SET(bits, way);
+      for (i=0; i<cp->assoc; i++)
+	if (!PLRU_BIT(bits, i))
+	  return;
+      memset(bits, 0, cp->plru_stride);
+      PLRU_SET(bits, way);
+    }
+}
+
+/* return the pseudo-LRU victim way of set SET */
+static int
+plru_victim(struct cache_t *cp, md_addr_t set)
+{
+  byte_t *bits = CACHE_PLRU(cp, set);
+  int node, i;
+
+  if (cp->policy == TreePLRU)
+    {
+      /* follow the node bits from the root down to a leaf */
+      for (node=1; node < cp->assoc; )
+	node = 2*node + PLRU_BIT(bits, node - 1);
+      return node - cp->assoc;
+    }
+  else /* BitPLRU */
+    {
+      /* first way not recently used */
+      for (i=0; i<cp->assoc; i++)
+	if (!PLRU_BIT(bits, i))
+	  return i;
+      return 0;
+    }
+}
+
+/* RRPVs of the blocks of set SET */
+#define CACHE_RRPV(cp, set)	((cp)->rrpv + (set)*(cp)->assoc)
+
+/* return the RRIP victim way of set SET, the first way predicted to be
+   re-referenced in the distant future, after aging all the ways of the
+   set until one is */
+static int
+rrip_victim(struct cache_t *cp, md_addr_t set)
+{
+  byte_t *rrpv = CACHE_RRPV(cp, set);
+  int i, way = 0, max = -1;
+
+  for (i=0; i<cp->assoc; i++)
+    {
+      if (rrpv[i] > max)
+	{
+	  max = rrpv[i];
+	  way = i;
+	}
+    }
+
+  if (max < RRIP_MAX)
+    {
+      for (i=0; i<cp->assoc; i++)
+	rrpv[i] += RRIP_MAX - max;
+    }
+  return way;
+}
+
+/* set the RRPV of way WAY of set SET, just filled on a miss */
+static void
+rrip_fill(struct cache_t *cp, md_addr_t set, int way)
+{
+  enum cache_policy policy = cp->policy;
+
+  if (policy == DRRIP)
+    {
+      /* leader sets train PSEL with their misses, follower sets use the
+	 policy of the leaders missing less */
+      if (set % cp->duel_stride == 0)
+	{
+	  cp->sdm_srrip_misses++;
+	  if (cp->psel < RRIP_PSEL_MAX)
+	    cp->psel++;
+	  policy = SRRIP;
+	}
+      else if (set % cp->duel_stride == 1)
+	{
+	  cp->sdm_brrip_misses++;
+	  if (cp->psel > 0)
+	    cp->psel--;
+	  policy = BRRIP;
+	}
+      else if (cp->psel > RRIP_PSEL_MAX/2)
+	{
+	  cp->follower_brrip_fills++;
+	  policy = BRRIP;
+	}
+      else
+	policy = SRRIP;
+    }
+
+  if (policy == BRRIP && (cache_rand(cp) % RRIP_BIMODAL) != 0)
+    {
+      CACHE_RRPV(cp, set)[way] = RRIP_MAX;
+      cp->rrip_distant_fills++;
+    }
+  else
+    CACHE_RRPV(cp, set)[way] = RRIP_MAX - 1;
+}
+
 /* where to insert a block onto the ordered way chain */
 enum list_loc_t { Head, Tail };
 
@@ -175,16 +445,96 @@ update_way_list(struct cache_set_t *set, struct cache_blk_t *blk, enum list_loc_
   else panic("bogus WHERE designator");
 }
 
+/* allocate and initialize the blocks, tag store and replacement state of
+   the first NSETS sets of cache CP */
+static void
+cache_alloc_sets(struct cache_t *cp, int nsets)
+{
+  struct cache_blk_t *blk;
+  int i, j, bindex;
+
+  cp->data = (byte_t *)calloc(nsets * cp->assoc, sizeof(struct cache_blk_t) +
+			      (cp->balloc ? (cp->bsize*sizeof(byte_t)) : 0));
+  if (!cp->data) fatal("out of virtual memory");
+
+  if (cp->policy == TreePLRU || cp->policy == BitPLRU)
+    {
+      cp->plru_stride = (cp->assoc + 7) >> 3;
+      cp->plru = (byte_t *)calloc(nsets, cp->plru_stride);
+      if (!cp->plru) fatal("out of virtual memory");
+    }
+
+  if (cp->policy == SRRIP || cp->policy == BRRIP || cp->policy == DRRIP)
+    {
+      cp->rrpv = (byte_t *)calloc(nsets * cp->assoc, sizeof(byte_t));
+      if (!cp->rrpv) fatal("out of virtual memory");
+      for (i=0; i<nsets*cp->assoc; i++)
+	cp->rrpv[i] = RRIP_MAX;
+      cp->psel = RRIP_PSEL_MAX/2;
+      cp->duel_stride = MAX(nsets / RRIP_LEADERS, 2);
+    }
+
+  cp->tags = (md_addr_t *)calloc(nsets * cp->assoc, sizeof(md_addr_t));
+  if (!cp->tags) fatal("out of virtual memory");
+  for (i=0; i<nsets*cp->assoc; i++)
+    cp->tags[i] = CACHE_TAG_INVALID;
+
+  cp->dirty_sets = (unsigned int *)calloc((nsets + 31) / 32, sizeof(unsigned int));
+  if (!cp->dirty_sets) fatal("out of virtual memory");
+
+  for (bindex=0,i=0; i<nsets; i++)
+    {
+      cp->sets[i].way_head = NULL;
+      cp->sets[i].way_tail = NULL;
+      if (cp->hsize)
+	{
+	  cp->sets[i].hash =
+	    (struct cache_blk_t **)calloc(cp->hsize, sizeof(struct cache_blk_t *));
+	  if (!cp->sets[i].hash) fatal("out of virtual memory");
+	}
+      cp->sets[i].blks = CACHE_BINDEX(cp, cp->data, bindex);
+
+      for (j=0; j<cp->assoc; j++)
+	{
+	  blk = CACHE_BINDEX(cp, cp->data, bindex);
+	  bindex++;
+
+	  blk->status = 0;
+	  blk->tag = 0;
+	  blk->ready = 0;
+	  blk->user_data = (cp->usize != 0 ? (byte_t *)calloc(cp->usize, sizeof(byte_t)) : NULL);
+
+	  if (cp->hsize) link_htab_ent(cp, &cp->sets[i], blk);
+
+	  blk->way_next = cp->sets[i].way_head;
+	  blk->way_prev = NULL;
+	  if (cp->sets[i].way_head) cp->sets[i].way_head->way_prev = blk;
+	  cp->sets[i].way_head = blk;
+	  if (!cp->sets[i].way_tail) cp->sets[i].way_tail = blk;
+	}
+    }
+}
+
+/* note whether cache CP has an optional feature that needs work on every
+   access, or is set-sampled or not indexed by the bits of the address, the
+   other caches take the short path of cache_access() */
+static void
+cache_update_extras(struct cache_t *cp)
+{
+  cp->extras = (cp->wbuf || cp->victim || cp->mshr || cp->pf || cp->reuse
+		|| cp->shadow || cp->bus || !cp->walloc
+		|| cp->index != IndexBits || cp->sample_rate > 1);
+}
+
 /* create and initialize a general cache structure */
 struct cache_t *
 cache_create(char *name, int nsets, int bsize, int balloc, int usize,
-	     int assoc, enum cache_policy policy,
+	     int assoc, enum cache_policy policy, enum cache_wpolicy wpolicy,
 	     unsigned int (*blk_access_fn)(enum mem_cmd, md_addr_t, int, struct cache_blk_t*, tick_t),
-	     unsigned int hit_latency)
+	     unsigned int hit_latency, int sample)
 {
   struct cache_t *cp;
-  struct cache_blk_t *blk;
-  int i, j, bindex;
+  int i;
 
   if (nsets <= 0) fatal("cache size (in sets) `%d' must be non-zero", nsets);
   if ((nsets & (nsets-1)) != 0) fatal("cache size (in sets) `%d' is not a power of two", nsets);
@@ -194,8 +544,13 @@ cache_create(char *name, int nsets, int bsize, int balloc, int usize,
   if (assoc <= 0) fatal("cache associativity `%d' must be non-zero and positive", assoc);
   if ((assoc & (assoc-1)) != 0) fatal("cache associativity `%d' must be a power of two", assoc);
   if (!blk_access_fn) fatal("must specify miss/replacement functions");
+  if (sample <= 0 || (sample & (sample-1)) != 0)
+    fatal("set sampling rate `%d' must be a power of two", sample);
+  if (sample > nsets)
+    fatal("cache `%s' has %d sets, too few to model 1 in %d",
+	  name, nsets, sample);
 
-  cp = (struct cache_t *)calloc(1, sizeof(struct cache_t) + (nsets-1)*sizeof(struct cache_set_t));
+  cp = (struct cache_t *)calloc(1, sizeof(struct cache_t) + (nsets/sample-1)*sizeof(struct cache_set_t));
   if (!cp) fatal("out of virtual memory");
 
   cp->name = mystrdup(name);
@@ -205,6 +560,8 @@ cache_create(char *name, int nsets, int bsize, int balloc, int usize,
   cp->usize = usize;
   cp->assoc = assoc;
   cp->policy = policy;
+  cp->wpolicy = wpolicy;
+  cp->walloc = TRUE;
   cp->hit_latency = hit_latency;
 
   cp->blk_access_fn = blk_access_fn;
@@ -216,121 +573,1060 @@ cache_create(char *name, int nsets, int bsize, int balloc, int usize,
   cp->tag_shift = cp->set_shift + log_base2(nsets);
   cp->tag_mask = (1 << (32 - cp->tag_shift))-1;
   cp->tagset_mask = ~cp->blk_mask;
+  cp->index = IndexBits;
+  cp->index_shift = cp->tag_shift;
+  cp->index_xor = 0;
+  cp->index_mask = cp->set_mask;
+  cp->index_prime = 0;
+  cp->skew_stamp = NULL;
+  cp->skew_clock = 0;
   cp->bus_free = 0;
+  cp->bus = NULL;
+  cp->rand_state = (unsigned int)myrand();
+
+  /* only the sets modelled are allocated */
+  cp->sample_rate = sample;
+  cp->sample_nsets = nsets / sample;
+  cp->sample_mult = sample > 1 ? SAMPLE_MULT : 1;
+  cp->sample_first = 0;
+  cp->sample_slices = 1;
+  cp->sample_mean_lat = hit_latency;
+  cp->sample_acc = cp->sample_miss = NULL;
+  if (sample > 1)
+    {
+      cp->sample_acc = (counter_t *)calloc(cp->sample_nsets, sizeof(counter_t));
+      cp->sample_miss = (counter_t *)calloc(cp->sample_nsets, sizeof(counter_t));
+      if (!cp->sample_acc || !cp->sample_miss)
+	fatal("out of virtual memory");
+    }
+
+  /* the inverse of the multiplier, each step doubles its correct bits */
+  cp->sample_inv = cp->sample_mult;
+  for (i=0; i<5; i++)
+    cp->sample_inv *= 2 - cp->sample_mult * cp->sample_inv;
 
   cp->hits = cp->misses = cp->replacements = cp->writebacks = cp->invalidations = 0;
+  cp->rrip_distant_fills = cp->sdm_srrip_misses = cp->sdm_brrip_misses = 0;
+  cp->follower_brrip_fills = cp->write_arounds = 0;
+  cp->wbuf_writes = cp->wbuf_coalesced = cp->wbuf_drains = 0;
+  cp->wbuf_full_stalls = cp->wbuf_stall_cycles = 0;
+  cp->victim_hits = cp->victim_misses = 0;
+  cp->pf_issued = cp->pf_useful = cp->pf_late = cp->pf_useless = 0;
+  cp->compulsory_misses = cp->capacity_misses = cp->conflict_misses = 0;
+  cp->mshr_allocs = cp->mshr_merges = 0;
+  cp->mshr_full_stalls = cp->mshr_stall_cycles = 0;
+  cp->mshr_busy_cycles = cp->mshr_miss_cycles = 0;
+  cp->sample_skips = cp->sample_lat = 0;
+  cp->sample_acc_sq = cp->sample_miss_sq = cp->sample_acc_miss = 0.0;
 
   cp->last_tagset = 0;
   cp->last_blk = NULL;
+  cp->last_set = 0;
 
-  cp->data = (byte_t *)calloc(nsets * assoc, sizeof(struct cache_blk_t) +
-			      (cp->balloc ? (bsize*sizeof(byte_t)) : 0));
-  if (!cp->data) fatal("out of virtual memory");
+  cache_alloc_sets(cp, cp->sample_nsets);
+  cache_update_extras(cp);
+  return cp;
+}
 
-  for (bindex=0,i=0; i<nsets; i++)
+/* give write-through cache CP a coalescing write buffer of NENTRIES blocks */
+void cache_set_wbuf(struct cache_t *cp, int nentries)
+{
+  if (nentries < 0) fatal("write buffer size `%d' must be non-negative", nentries);
+  if (nentries && cp->wpolicy != WriteThrough)
     {
-      cp->sets[i].way_head = NULL;
-      cp->sets[i].way_tail = NULL;
-      if (cp->hsize)
+      warn("cache `%s' is write-back, ignoring its write buffer", cp->name);
+      nentries = 0;
+    }
+
+  cp->wbuf_size = nentries;
+  cp->wbuf_head = cp->wbuf_num = 0;
+  cp->wbuf_free = 0;
+  if (cp->wbuf) free(cp->wbuf);
+  cp->wbuf = NULL;
+  if (nentries)
+    {
+      cp->wbuf = (struct cache_wbuf_ent_t *)
+	calloc(nentries, sizeof(struct cache_wbuf_ent_t));
+      if (!cp->wbuf) fatal("out of virtual memory");
+    }
+
+  cache_update_extras(cp);
+}
+
+/* attach a victim buffer of NENTRIES blocks to cache CP */
+void cache_set_victim(struct cache_t *cp, int nentries, unsigned int swap_lat)
+{
+  int i;
+
+  if (nentries < 0) fatal("victim buffer size `%d' must be non-negative", nentries);
+
+  if (cp->victim)
+    {
+      for (i=0; i<cp->victim_size; i++)
 	{
-	  cp->sets[i].hash =
-	    (struct cache_blk_t **)calloc(cp->hsize, sizeof(struct cache_blk_t *));
-	  if (!cp->sets[i].hash) fatal("out of virtual memory");
+	  if (cp->victim[i].user_data) free(cp->victim[i].user_data);
+	  if (cp->victim[i].data) free(cp->victim[i].data);
 	}
-      cp->sets[i].blks = CACHE_BINDEX(cp, cp->data, bindex);
+      free(cp->victim);
+      cp->victim = NULL;
+    }
 
-      for (j=0; j<assoc; j++)
+  cp->victim_size = nentries;
+  cp->victim_num = 0;
+  cp->victim_lat = swap_lat;
+  if (nentries)
+    {
+      cp->victim = (struct cache_victim_t *)
+	calloc(nentries, sizeof(struct cache_victim_t));
+      if (!cp->victim) fatal("out of virtual memory");
+      for (i=0; i<nentries; i++)
 	{
-	  blk = CACHE_BINDEX(cp, cp->data, bindex);
-	  bindex++;
-
-	  blk->status = 0;
-	  blk->tag = 0;
-	  blk->ready = 0;
-	  blk->user_data = (usize != 0 ? (byte_t *)calloc(usize, sizeof(byte_t)) : NULL);
+	  if (cp->usize)
+	    {
+	      cp->victim[i].user_data = (byte_t *)calloc(cp->usize, sizeof(byte_t));
+	      if (!cp->victim[i].user_data) fatal("out of virtual memory");
+	    }
+	  if (cp->balloc)
+	    {
+	      cp->victim[i].data = (byte_t *)calloc(cp->bsize, sizeof(byte_t));
+	      if (!cp->victim[i].data) fatal("out of virtual memory");
+	    }
+	}
+    }
 
-	  if (cp->hsize) link_htab_ent(cp, &cp->sets[i], blk);
+  cache_update_extras(cp);
+}
 
-	  blk->way_next = cp->sets[i].way_head;
-	  blk->way_prev = NULL;
-	  if (cp->sets[i].way_head) cp->sets[i].way_head->way_prev = blk;
-	  cp->sets[i].way_head = blk;
-	  if (!cp->sets[i].way_tail) cp->sets[i].way_tail = blk;
-	}
+/* limit cache CP to NENTRIES outstanding misses of NTARGETS accesses each */
+void cache_set_mshr(struct cache_t *cp, int nentries, int ntargets)
+{
+  if (nentries < 0) fatal("number of MSHRs `%d' must be non-negative", nentries);
+  if (nentries && ntargets <= 0)
+    fatal("MSHR targets `%d' must be non-zero and positive", ntargets);
+
+  cp->mshr_size = nentries;
+  cp->mshr_targets = ntargets;
+  cp->mshr_num = 0;
+  cp->mshr_last_ready = 0;
+  if (cp->mshr) free(cp->mshr);
+  cp->mshr = NULL;
+  if (nentries)
+    {
+      cp->mshr = (struct cache_mshr_t *)
+	calloc(nentries, sizeof(struct cache_mshr_t));
+      if (!cp->mshr) fatal("out of virtual memory");
     }
-  return cp;
+
+  cache_update_extras(cp);
 }
 
-/* parse policy */
-enum cache_policy cache_char2policy(char c)
+/* free the MSHRs of cache CP whose fills are done by NOW */
+static void
+mshr_retire(struct cache_t *cp, tick_t now)
 {
-  switch (c) {
-  case 'l': return LRU;
-  case 'r': return Random;
-  case 'f': return FIFO;
-  default: fatal("bogus replacement policy, `%c'", c);
-  }
+  int i;
+
+  for (i=0; i<cp->mshr_num; )
+    {
+      if (cp->mshr[i].ready <= now)
+	cp->mshr[i] = cp->mshr[--cp->mshr_num];
+      else
+	i++;
+    }
 }
 
-/* print cache configuration */
-void cache_config(struct cache_t *cp, FILE *stream)
+/* find the MSHR of cache CP filling the block at BADDR, NULL if none */
+static struct cache_mshr_t *
+mshr_find(struct cache_t *cp, md_addr_t baddr)
 {
-  fprintf(stream,
-	  "cache: %s: %d sets, %d byte blocks, %d bytes user data/block\n",
-	  cp->name, cp->nsets, cp->bsize, cp->usize);
-  fprintf(stream,
-	  "cache: %s: %d-way, `%s' replacement policy, %s\n",
-	  cp->name, cp->assoc,
-	  cp->policy == LRU ? "LRU"
-	  : cp->policy == Random ? "Random"
-	  : cp->policy == FIFO ? "FIFO"
-	  : (abort(), ""),
-	  WRITE_POLICY == WRITE_BACK ? "write-back" : "write-through");
+  int i;
+
+  for (i=0; i<cp->mshr_num; i++)
+    if (cp->mshr[i].baddr == baddr)
+      return &cp->mshr[i];
+  return NULL;
 }
 
-/* register cache stats */
-void cache_reg_stats(struct cache_t *cp, struct stat_sdb_t *sdb)
+/* get a free MSHR of cache CP for a miss at NOW, waiting for the first fill
+   to finish if there is none, returns the wait */
+static int
+mshr_wait(struct cache_t *cp, tick_t now)
 {
-  char buf[512], buf1[512], *name;
+  int i, first, lat = 0;
 
-  if (!cp->name || !cp->name[0]) name = "<unknown>";
-  else name = cp->name;
+  mshr_retire(cp, now);
+  if (cp->mshr_num == cp->mshr_size)
+    {
+      for (first=0, i=1; i<cp->mshr_num; i++)
+	if (cp->mshr[i].ready < cp->mshr[first].ready)
+	  first = i;
+
+      lat = cp->mshr[first].ready - now;
+      cp->mshr_full_stalls++;
+      cp->mshr_stall_cycles += lat;
+      cp->mshr[first] = cp->mshr[--cp->mshr_num];
+    }
+  return lat;
+}
 
-  sprintf(buf, "%s.accesses", name);
-  sprintf(buf1, "%s.hits + %s.misses", name, name);
-  stat_reg_formula(sdb, buf, "total number of accesses", buf1, "%12.0f");
-  sprintf(buf, "%s.hits", name);
-  stat_reg_counter(sdb, buf, "total number of hits", &cp->hits, 0, NULL);
-  sprintf(buf, "%s.misses", name);
-  stat_reg_counter(sdb, buf, "total number of misses", &cp->misses, 0, NULL);
-  sprintf(buf, "%s.replacements", name);
-  stat_reg_counter(sdb, buf, "total number of replacements", &cp->replacements, 0, NULL);
-  sprintf(buf, "%s.writebacks", name);
-  stat_reg_counter(sdb, buf, "total number of writebacks", &cp->writebacks, 0, NULL);
-  sprintf(buf, "%s.invalidations", name);
-  stat_reg_counter(sdb, buf, "total number of invalidations", &cp->invalidations, 0, NULL);
-  sprintf(buf, "%s.miss_rate", name);
-  sprintf(buf1, "%s.misses / %s.accesses", name, name);
-  stat_reg_formula(sdb, buf, "miss rate (i.e., misses/ref)", buf1, NULL);
-  sprintf(buf, "%s.repl_rate", name);
-  sprintf(buf1, "%s.replacements / %s.accesses", name, name);
-  stat_reg_formula(sdb, buf, "replacement rate (i.e., repls/ref)", buf1, NULL);
-  sprintf(buf, "%s.wb_rate", name);
-  sprintf(buf1, "%s.writebacks / %s.accesses", name, name);
-  stat_reg_formula(sdb, buf, "writeback rate (i.e., wrbks/ref)", buf1, NULL);
-  sprintf(buf, "%s.inv_rate", name);
-  sprintf(buf1, "%s.invalidations / %s.accesses", name, name);
-  stat_reg_formula(sdb, buf, "invalidation rate (i.e., invs/ref)", buf1, NULL);
+/* allocate an MSHR of cache CP for the fill of the block at BADDR, from
+   START until READY */
+static void
+mshr_alloc(struct cache_t *cp, md_addr_t baddr, tick_t start, tick_t ready)
+{
+  struct cache_mshr_t *m = &cp->mshr[cp->mshr_num++];
+
+  m->baddr = baddr;
+  m->ready = ready;
+  m->targets = 1;
+
+  cp->mshr_allocs++;
+  cp->mshr_busy_cycles += BOUND_POS(ready - start);
+  cp->mshr_miss_cycles += BOUND_POS(ready - MAX(start, cp->mshr_last_ready));
+  cp->mshr_last_ready = MAX(cp->mshr_last_ready, ready);
+  if (cp->mshr_occ_dist)
+    stat_add_sample(cp->mshr_occ_dist, cp->mshr_num);
 }
 
-/* print cache stats */
-void cache_stats(struct cache_t *cp, FILE *stream)
+/* merge an access to the block at BADDR of cache CP, still being filled,
+   into the MSHR filling it */
+static void
+mshr_merge(struct cache_t *cp, md_addr_t baddr)
 {
-  double sum = (double)(cp->hits + cp->misses);
+  struct cache_mshr_t *m = mshr_find(cp, baddr);
 
-  fprintf(stream,
-	  "cache: %s: %.0f hits %.0f misses %.0f repls %.0f invalidations\n",
-	  cp->name, (double)cp->hits, (double)cp->misses,
+  if (m)
+    {
+      m->targets++;
+      cp->mshr_merges++;
+    }
+}
+
+/* can an access to ADDR of cache CP at NOW be made without waiting for the
+   MSHRs? */
+int cache_mshr_avail(struct cache_t *cp, md_addr_t addr, tick_t now)
+{
+  md_addr_t tag = CACHE_TAG(cp, addr);
+  md_addr_t set = CACHE_SET(cp, addr);
+  struct cache_mshr_t *m;
+  int way;
+
+  if (!cp->mshr)
+    return TRUE;
+
+  if (cp->sample_rate > 1)
+    {
+      set = CACHE_SAMPLE_SET(cp, set);
+      if (set >= cp->sample_nsets)
+	return TRUE;
+    }
+
+  mshr_retire(cp, now);
+  m = mshr_find(cp, CACHE_BADDR(cp, addr));
+  if (m)
+    return m->targets < cp->mshr_targets;
+  if (cache_find_blk(cp, &set, tag, &way))
+    return TRUE;
+  return cp->mshr_num < cp->mshr_size;
+}
+
+/* attach prefetcher PF to cache CP */
+void cache_set_prefetch(struct cache_t *cp, struct prefetch_t *pf)
+{
+  cp->pf = pf;
+  cache_update_extras(cp);
+}
+
+/* attach reuse distance profiler R to cache CP */
+void cache_set_reuse(struct cache_t *cp, struct reuse_t *r)
+{
+  cp->reuse = r;
+  cache_update_extras(cp);
+}
+
+/* index the sets of cache CP with index function INDEX */
+void cache_set_index(struct cache_t *cp, enum cache_index index)
+{
+  int n = log_base2(cp->nsets), i, j;
+
+  if (cp->hits || cp->misses || cp->sample_skips)
+    panic("cache `%s' indexed after it was accessed", cp->name);
+  if (index != IndexBits && cp->nsets < 2)
+    fatal("cache `%s' needs 2 or more sets to hash its set index", cp->name);
+  if (index == IndexSkew)
+    {
+      if (cp->policy != LRU && cp->policy != FIFO && cp->policy != Random)
+	fatal("skewed-associative cache `%s' needs LRU, FIFO or random "
+	      "replacement", cp->name);
+      if (cp->hsize)
+	fatal("cache `%s' is too associative to be skewed", cp->name);
+      if (cp->sample_rate > 1)
+	fatal("skewed-associative cache `%s' cannot model 1 in %d sets",
+	      cp->name, cp->sample_rate);
+    }
+
+  cp->index = index;
+  cp->index_shift = cp->set_shift + n;
+  cp->index_xor =
+    (index == IndexXOR || index == IndexSkew) ? cp->set_mask : 0;
+  cp->index_mask =
+    (index == IndexBits || index == IndexXOR) ? cp->set_mask : 0;
+
+  /* the largest prime number of sets */
+  cp->index_prime = 0;
+  if (index == IndexPrime)
+    {
+      for (i=cp->nsets; !cp->index_prime; i--)
+	{
+	  for (j=2; j*j <= i && i % j != 0; j++)
+	    /* nada */;
+	  if (j*j > i)
+	    cp->index_prime = i;
+	}
+    }
+
+  /* the tag is the block address when the set is not made of its bits */
+  cp->tag_shift = cp->index_mask ? cp->index_shift : cp->set_shift;
+  cp->tag_mask = (1 << (32 - cp->tag_shift))-1;
+
+  if (cp->skew_stamp)
+    free(cp->skew_stamp);
+  cp->skew_stamp = NULL;
+  if (index == IndexSkew)
+    {
+      cp->skew_stamp = (counter_t *)
+	calloc(cp->sample_nsets * cp->assoc, sizeof(counter_t));
+      if (!cp->skew_stamp)
+	fatal("out of virtual memory");
+    }
+
+  cache_update_extras(cp);
+}
+
+/* make cache CP slice SLICE of NSLICES slices of its sets */
+void cache_set_slice(struct cache_t *cp, int slice, int nslices)
+{
+  if (nslices <= 0 || cp->sample_rate % nslices != 0)
+    fatal("cache `%s' models 1 in %d sets, it cannot be sliced %d ways",
+	  cp->name, cp->sample_rate, nslices);
+  if (slice < 0 || slice >= nslices)
+    panic("bogus slice `%d' of %d", slice, nslices);
+  if (cp->hits || cp->misses || cp->sample_skips)
+    panic("cache `%s' sliced after it was accessed", cp->name);
+
+  cp->sample_first = slice * cp->sample_nsets;
+  cp->sample_slices = nslices;
+}
+
+/* set the stats of cache CP to the totals of its NSLICES slices SLICES */
+void cache_merge_slices(struct cache_t *cp, struct cache_t **slices,
+			int nslices)
+{
+  struct cache_t *sp;
+  int i;
+
+#define MERGE(FIELD)							\
+  for (cp->FIELD = 0, i=0; i<nslices; i++) cp->FIELD += slices[i]->FIELD
+
+  MERGE(hits); MERGE(misses); MERGE(replacements); MERGE(writebacks);
+  MERGE(invalidations); MERGE(write_arounds);
+  MERGE(rrip_distant_fills); MERGE(sdm_srrip_misses); MERGE(sdm_brrip_misses);
+  MERGE(follower_brrip_fills);
+  MERGE(wbuf_writes); MERGE(wbuf_coalesced); MERGE(wbuf_drains);
+  MERGE(wbuf_full_stalls); MERGE(wbuf_stall_cycles);
+  MERGE(victim_hits); MERGE(victim_misses);
+  MERGE(mshr_allocs); MERGE(mshr_merges); MERGE(mshr_full_stalls);
+  MERGE(mshr_stall_cycles); MERGE(mshr_busy_cycles); MERGE(mshr_miss_cycles);
+  MERGE(pf_issued); MERGE(pf_useful); MERGE(pf_late); MERGE(pf_useless);
+  MERGE(compulsory_misses); MERGE(capacity_misses); MERGE(conflict_misses);
+  MERGE(sample_acc_sq); MERGE(sample_miss_sq); MERGE(sample_acc_miss);
+  MERGE(sample_lat);
+
+#undef MERGE
+
+  /* every slice sees every access, the accesses to the sets of no slice
+     are those seen by a slice less those modelled by all of them */
+  if (nslices > 0)
+    {
+      sp = slices[0];
+      cp->sample_skips = sp->hits + sp->misses + sp->sample_skips
+	- (cp->hits + cp->misses);
+    }
+}
+
+/* connect cache CP to its next level through BUS */
+void cache_set_bus(struct cache_t *cp, struct bus_t *bus)
+{
+  cp->bus = bus;
+  cache_update_extras(cp);
+}
+
+/* set the write miss policy of cache CP */
+void cache_set_walloc(struct cache_t *cp, int walloc)
+{
+  cp->walloc = walloc;
+  cache_update_extras(cp);
+}
+
+/* shadow cache blocks are allocated in chunks of SHADOW_CHUNK blocks */
+#define SHADOW_CHUNK		1024
+
+/* a chunk of shadow cache blocks */
+struct cache_shadow_chunk_t
+{
+  struct cache_shadow_chunk_t *next;	/* next chunk allocated */
+  struct cache_shadow_blk_t blks[SHADOW_CHUNK];
+};
+
+/* initial shadow cache hash table size, it doubles when the touched blocks
+   outnumber twice its buckets */
+#define SHADOW_HSIZE		1024
+
+/* hash table bucket of block address BADDR in the shadow cache of CP */
+#define SHADOW_HASH(cp, baddr)						\
+  ((((baddr) >> (cp)->set_shift) ^ ((baddr) >> ((cp)->set_shift + 16)))	\
+   & ((cp)->shadow->hsize-1))
+
+/* outcome of a shadow cache access */
+enum shadow_result { shadow_hit, shadow_miss, shadow_cold };
+
+/* resize the hash table of the shadow cache of CP to HSIZE buckets */
+static void
+shadow_rehash(struct cache_t *cp, int hsize)
+{
+  struct cache_shadow_t *sh = cp->shadow;
+  struct cache_shadow_blk_t **old = sh->hash, *blk, *next;
+  int i, b, old_hsize = sh->hsize;
+
+  sh->hash = (struct cache_shadow_blk_t **)
+    calloc(hsize, sizeof(struct cache_shadow_blk_t *));
+  if (!sh->hash) fatal("out of virtual memory");
+  sh->hsize = hsize;
+
+  for (i=0; i<old_hsize; i++)
+    for (blk=old[i]; blk; blk=next)
+      {
+	next = blk->hash_next;
+	b = SHADOW_HASH(cp, blk->baddr);
+	blk->hash_next = sh->hash[b];
+	sh->hash[b] = blk;
+      }
+  if (old) free(old);
+}
+
+/* remove block BLK from the LRU list of shadow cache SH */
+static void
+shadow_unlink(struct cache_shadow_t *sh, struct cache_shadow_blk_t *blk)
+{
+  if (blk->lru_prev) blk->lru_prev->lru_next = blk->lru_next;
+  else sh->lru_head = blk->lru_next;
+  if (blk->lru_next) blk->lru_next->lru_prev = blk->lru_prev;
+  else sh->lru_tail = blk->lru_prev;
+}
+
+/* insert block BLK at the most recently used end of shadow cache SH */
+static void
+shadow_link_head(struct cache_shadow_t *sh, struct cache_shadow_blk_t *blk)
+{
+  blk->lru_prev = NULL;
+  blk->lru_next = sh->lru_head;
+  if (sh->lru_head) sh->lru_head->lru_prev = blk;
+  else sh->lru_tail = blk;
+  sh->lru_head = blk;
+}
+
+/* access the block at BADDR in the shadow cache of CP, with ALLOC a block
+   not in the shadow cache is inserted, evicting its LRU block if full */
+static enum shadow_result
+shadow_access(struct cache_t *cp, md_addr_t baddr, int alloc)
+{
+  struct cache_shadow_t *sh = cp->shadow;
+  struct cache_shadow_blk_t *blk;
+  enum shadow_result result;
+  int i, b;
+
+  /* repeated accesses to the most recently used block are common */
+  if (sh->lru_head && sh->lru_head->baddr == baddr)
+    return shadow_hit;
+
+  b = SHADOW_HASH(cp, baddr);
+  for (blk=sh->hash[b]; blk && blk->baddr != baddr; blk=blk->hash_next)
+    /* nada */;
+
+  if (blk && blk->resident)
+    {
+      shadow_unlink(sh, blk);
+      shadow_link_head(sh, blk);
+      return shadow_hit;
+    }
+
+  if (blk)
+    result = shadow_miss;
+  else
+    {
+      /* first touch of the block, remember it */
+      result = shadow_cold;
+      if (!sh->free)
+	{
+	  struct cache_shadow_chunk_t *chunk = (struct cache_shadow_chunk_t *)
+	    calloc(1, sizeof(struct cache_shadow_chunk_t));
+	  if (!chunk) fatal("out of virtual memory");
+	  chunk->next = sh->chunks;
+	  sh->chunks = chunk;
+	  for (i=0; i<SHADOW_CHUNK; i++)
+	    {
+	      chunk->blks[i].hash_next = sh->free;
+	      sh->free = &chunk->blks[i];
+	    }
+	}
+      blk = sh->free;
+      sh->free = blk->hash_next;
+      blk->baddr = baddr;
+      blk->resident = FALSE;
+      blk->hash_next = sh->hash[b];
+      sh->hash[b] = blk;
+      if (++sh->nblks > 2*sh->hsize)
+	shadow_rehash(cp, 2*sh->hsize);
+    }
+
+  if (alloc)
+    {
+      if (sh->num == sh->size)
+	{
+	  sh->lru_tail->resident = FALSE;
+	  shadow_unlink(sh, sh->lru_tail);
+	  sh->num--;
+	}
+      shadow_link_head(sh, blk);
+      blk->resident = TRUE;
+      sh->num++;
+    }
+  return result;
+}
+
+/* drop the block at BADDR from the shadow cache of CP, as it is from CP,
+   the block is still known to have been touched */
+static void
+shadow_invalidate(struct cache_t *cp, md_addr_t baddr)
+{
+  struct cache_shadow_t *sh = cp->shadow;
+  struct cache_shadow_blk_t *blk;
+
+  for (blk=sh->hash[SHADOW_HASH(cp, baddr)];
+       blk && blk->baddr != baddr;
+       blk=blk->hash_next)
+    /* nada */;
+  if (!blk || !blk->resident)
+    return;
+
+  shadow_unlink(sh, blk);
+  blk->resident = FALSE;
+  sh->num--;
+}
+
+/* empty the shadow cache of CP, as CP is flushed, its blocks are still
+   known to have been touched, so the misses after a flush are capacity
+   misses (the flushed shadow cache misses too), not compulsory misses */
+static void
+shadow_flush(struct cache_t *cp)
+{
+  struct cache_shadow_t *sh = cp->shadow;
+  struct cache_shadow_blk_t *blk;
+
+  for (blk=sh->lru_head; blk; blk=blk->lru_next)
+    blk->resident = FALSE;
+  sh->lru_head = sh->lru_tail = NULL;
+  sh->num = 0;
+}
+
+/* classify a miss of cache CP to ADDR, with ALLOC the missing block is
+   allocated in CP */
+static void
+shadow_classify(struct cache_t *cp, md_addr_t addr, int alloc)
+{
+  switch (shadow_access(cp, CACHE_BADDR(cp, addr), alloc))
+    {
+    case shadow_cold:
+      cp->compulsory_misses++;
+      break;
+    case shadow_miss:
+      cp->capacity_misses++;
+      break;
+    case shadow_hit:
+      cp->conflict_misses++;
+      break;
+    default:
+      panic("bogus shadow cache result");
+    }
+}
+
+/* classify the misses of cache CP with a fully-associative shadow cache */
+void cache_set_classify(struct cache_t *cp, int classify)
+{
+  struct cache_shadow_chunk_t *chunk, *next;
+
+  if (cp->shadow)
+    {
+      for (chunk=cp->shadow->chunks; chunk; chunk=next)
+	{
+	  next = chunk->next;
+	  free(chunk);
+	}
+      free(cp->shadow->hash);
+      free(cp->shadow);
+      cp->shadow = NULL;
+    }
+
+  if (classify)
+    {
+      cp->shadow = (struct cache_shadow_t *)
+	calloc(1, sizeof(struct cache_shadow_t));
+      if (!cp->shadow) fatal("out of virtual memory");
+      cp->shadow->size = cp->sample_nsets * cp->assoc;
+      shadow_rehash(cp, SHADOW_HSIZE);
+    }
+
+  cache_update_extras(cp);
+}
+
+/* write the block at BADDR of write-through cache CP through its write
+   buffer at NOW, returns the latency seen by the writer */
+static unsigned int
+cache_wbuf_write(struct cache_t *cp, md_addr_t baddr, struct cache_blk_t *blk, tick_t now)
+{
+  struct cache_wbuf_ent_t *ent;
+  int i, lat = 0;
+
+  cp->wbuf_writes++;
+
+  /* free the entries drained by now */
+  while (cp->wbuf_num > 0 && cp->wbuf[cp->wbuf_head].done <= now)
+    {
+      cp->wbuf_head = (cp->wbuf_head + 1) % cp->wbuf_size;
+      cp->wbuf_num--;
+    }
+
+  /* combine with a write of the same block still waiting to drain */
+  for (i=0; i<cp->wbuf_num; i++)
+    {
+      ent = &cp->wbuf[(cp->wbuf_head + i) % cp->wbuf_size];
+      if (ent->baddr == baddr && ent->start > now)
+	{
+	  cp->wbuf_coalesced++;
+	  return 0;
+	}
+    }
+
+  /* buffer full, wait for the oldest entry to drain */
+  if (cp->wbuf_num == cp->wbuf_size)
+    {
+      cp->wbuf_full_stalls++;
+      lat = BOUND_POS(cp->wbuf[cp->wbuf_head].done - now);
+      cp->wbuf_stall_cycles += lat;
+      cp->wbuf_head = (cp->wbuf_head + 1) % cp->wbuf_size;
+      cp->wbuf_num--;
+    }
+
+  /* queue the write, it drains after the writes ahead of it */
+  ent = &cp->wbuf[(cp->wbuf_head + cp->wbuf_num) % cp->wbuf_size];
+  cp->wbuf_num++;
+  ent->baddr = baddr;
+  ent->start = MAX(now + lat, cp->wbuf_free);
+  if (cp->bus)
+    ent->start += bus_access(cp->bus, cp->bsize, ent->start, now);
+  ent->done = ent->start + cp->blk_access_fn(Write, baddr, cp->bsize, blk, ent->start);
+  cp->wbuf_free = ent->done;
+
+  cp->wbuf_drains++;
+  cp->writebacks++;
+
+  return lat;
+}
+
+/* exchange the contents of victim buffer entry ENT of CP with cache block
+   BLK, the block gets the entry's user data and data, the entry BLK's */
+static void
+victim_exchange(struct cache_t *cp, struct cache_victim_t *ent,
+		struct cache_blk_t *blk)
+{
+  byte_t *udata, b;
+  int i;
+
+  udata = ent->user_data;
+  ent->user_data = blk->user_data;
+  blk->user_data = udata;
+
+  if (cp->balloc)
+    for (i=0; i<cp->bsize; i++)
+      {
+	b = ent->data[i];
+	ent->data[i] = blk->data[i];
+	blk->data[i] = b;
+      }
+}
+
+/* move victim buffer entry I of CP to position J, shifting the entries in
+   between */
+static void
+victim_move(struct cache_t *cp, int i, int j)
+{
+  struct cache_victim_t ent = cp->victim[i];
+
+  if (i > j)
+    memmove(&cp->victim[j+1], &cp->victim[j], (i-j)*sizeof(ent));
+  else if (i < j)
+    memmove(&cp->victim[i], &cp->victim[i+1], (j-i)*sizeof(ent));
+  cp->victim[j] = ent;
+}
+
+/* write back victim buffer entry ENT of CP at NOW if it is dirty, returns
+   the latency of the writeback */
+static unsigned int
+victim_writeback(struct cache_t *cp, struct cache_victim_t *ent, tick_t now)
+{
+  int lat = 0;
+
+  if (ent->status & CACHE_BLK_DIRTY)
+    {
+      if (cp->bus)
+	lat += bus_access(cp->bus, cp->bsize, now, now);
+      else
+	{
+	  lat += BOUND_POS(cp->bus_free - now);
+	  cp->bus_free = MAX(cp->bus_free, (now + lat)) + 1;
+	}
+      cp->writebacks++;
+      lat += cp->blk_access_fn(Write, ent->baddr, cp->bsize, NULL, now+lat);
+    }
+  return lat;
+}
+
+/* look up the block at BADDR in the victim buffer of CP on a miss that
+   evicts REPL from SET, the evicted block (if VALID) goes into the buffer,
+   pushing out (and writing back) its LRU entry if the buffer is full, on a
+   hit the buffered block is swapped into REPL and its status returned,
+   otherwise 0 is returned; the latency of any writeback accrues to *LAT */
+static unsigned int
+victim_access(struct cache_t *cp, struct cache_blk_t *repl, int valid,
+	      md_addr_t set, md_addr_t baddr, tick_t now, int *lat)
+{
+  struct cache_victim_t *ent;
+  unsigned int status = 0;
+  int i;
+
+  for (i=0; i<cp->victim_num; i++)
+    if (cp->victim[i].baddr == baddr)
+      break;
+
+  if (i < cp->victim_num)
+    {
+      cp->victim_hits++;
+      status = cp->victim[i].status;
+    }
+  else
+    {
+      cp->victim_misses++;
+      if (!valid)
+	return 0;
+
+      /* make room for the evicted block */
+      if (cp->victim_num < cp->victim_size)
+	i = cp->victim_num++;
+      else
+	{
+	  i = cp->victim_num - 1;
+	  *lat += victim_writeback(cp, &cp->victim[i], now + *lat);
+	}
+    }
+
+  ent = &cp->victim[i];
+  victim_exchange(cp, ent, repl);
+  if (valid)
+    {
+      /* the evicted block becomes the most recent entry */
+      ent->baddr = CACHE_MK_BADDR(cp, repl->tag, set);
+      ent->status = repl->status;
+      victim_move(cp, i, 0);
+    }
+  else
+    {
+      /* nothing evicted, the entry is free now */
+      victim_move(cp, i, --cp->victim_num);
+    }
+
+  return status;
+}
+
+/* parse policy */
+enum cache_policy cache_char2policy(char c)
+{
+  switch (c) {
+  case 'l': return LRU;
+  case 'r': return Random;
+  case 'f': return FIFO;
+  case 't': return TreePLRU;
+  case 'b': return BitPLRU;
+  case 's': return SRRIP;
+  case 'i': return BRRIP;
+  case 'd': return DRRIP;
+  default: fatal("bogus replacement policy, `%c'", c);
+  }
+}
+
+/* parse set index function */
+enum cache_index cache_char2index(char c)
+{
+  switch (c) {
+  case 'b': return IndexBits;
+  case 'x': return IndexXOR;
+  case 'p': return IndexPrime;
+  case 's': return IndexSkew;
+  default: fatal("bogus set index function, `%c'", c);
+  }
+}
+
+/* parse write policy */
+enum cache_wpolicy cache_str2wpolicy(char *s)
+{
+  if (!mystricmp(s, "wb")) return WriteBack;
+  else if (!mystricmp(s, "wt")) return WriteThrough;
+  else fatal("bogus write policy, `%s'", s);
+}
+
+/* print cache configuration */
+void cache_config(struct cache_t *cp, FILE *stream)
+{
+  fprintf(stream,
+	  "cache: %s: %d sets, %d byte blocks, %d bytes user data/block\n",
+	  cp->name, cp->nsets, cp->bsize, cp->usize);
+  fprintf(stream,
+	  "cache: %s: %d-way, `%s' replacement policy, %s%s\n",
+	  cp->name, cp->assoc,
+	  cp->policy == LRU ? "LRU"
+	  : cp->policy == Random ? "Random"
+	  : cp->policy == FIFO ? "FIFO"
+	  : cp->policy == TreePLRU ? "tree-PLRU"
+	  : cp->policy == BitPLRU ? "bit-PLRU"
+	  : cp->policy == SRRIP ? "SRRIP"
+	  : cp->policy == BRRIP ? "BRRIP"
+	  : cp->policy == DRRIP ? "DRRIP"
+	  : (abort(), ""),
+	  cp->wpolicy == WriteBack ? "write-back" : "write-through",
+	  cp->walloc ? "" : ", no-write-allocate");
+  if (cp->index != IndexBits)
+    fprintf(stream,
+	    "cache: %s: %s\n", cp->name,
+	    cp->index == IndexXOR ? "sets indexed by XOR with the tag bits"
+	    : cp->index == IndexSkew ? "skewed-associative, a set hash per way"
+	    : "sets indexed by block address modulo a prime");
+  if (cp->index_prime)
+    fprintf(stream,
+	    "cache: %s: %d of %d sets used\n",
+	    cp->name, cp->index_prime, cp->nsets);
+  if (cp->pf)
+    prefetch_config(cp->pf, stream);
+  if (cp->reuse)
+    reuse_config(cp->reuse, stream);
+  if (cp->shadow)
+    fprintf(stream,
+	    "cache: %s: misses classified by a %d block fully-associative LRU "
+	    "shadow\n", cp->name, cp->shadow->size);
+  if (cp->sample_rate / cp->sample_slices > 1)
+    fprintf(stream,
+	    "cache: %s: 1 in %d sets modelled (%d sets), hashed set sampling\n",
+	    cp->name, cp->sample_rate / cp->sample_slices,
+	    cp->sample_nsets * cp->sample_slices);
+  if (cp->sample_slices > 1)
+    fprintf(stream,
+	    "cache: %s: sets simulated in %d slices of %d sets\n",
+	    cp->name, cp->sample_slices, cp->sample_nsets);
+}
+
+/* register cache stats */
+void cache_reg_stats(struct cache_t *cp, struct stat_sdb_t *sdb)
+{
+  char buf[512], buf1[512], *name;
+
+  if (!cp->name || !cp->name[0]) name = "<unknown>";
+  else name = cp->name;
+
+  sprintf(buf, "%s.accesses", name);
+  sprintf(buf1, "%s.hits + %s.misses", name, name);
+  stat_reg_formula(sdb, buf, "total number of accesses", buf1, "%12.0f");
+  sprintf(buf, "%s.hits", name);
+  stat_reg_counter(sdb, buf, "total number of hits", &cp->hits, 0, NULL);
+  sprintf(buf, "%s.misses", name);
+  stat_reg_counter(sdb, buf, "total number of misses", &cp->misses, 0, NULL);
+  sprintf(buf, "%s.replacements", name);
+  stat_reg_counter(sdb, buf, "total number of replacements", &cp->replacements, 0, NULL);
+  sprintf(buf, "%s.writebacks", name);
+  stat_reg_counter(sdb, buf, "total number of writebacks", &cp->writebacks, 0, NULL);
+  sprintf(buf, "%s.invalidations", name);
+  stat_reg_counter(sdb, buf, "total number of invalidations", &cp->invalidations, 0, NULL);
+  sprintf(buf, "%s.miss_rate", name);
+  sprintf(buf1, "%s.misses / %s.accesses", name, name);
+  stat_reg_formula(sdb, buf, "miss rate (i.e., misses/ref)", buf1, NULL);
+  sprintf(buf, "%s.repl_rate", name);
+  sprintf(buf1, "%s.replacements / %s.accesses", name, name);
+  stat_reg_formula(sdb, buf, "replacement rate (i.e., repls/ref)", buf1, NULL);
+  sprintf(buf, "%s.wb_rate", name);
+  sprintf(buf1, "%s.writebacks / %s.accesses", name, name);
+  stat_reg_formula(sdb, buf, "writeback rate (i.e., wrbks/ref)", buf1, NULL);
+  sprintf(buf, "%s.inv_rate", name);
+  sprintf(buf1, "%s.invalidations / %s.accesses", name, name);
+  stat_reg_formula(sdb, buf, "invalidation rate (i.e., invs/ref)", buf1, NULL);
+
+  if (!cp->walloc)
+    {
+      sprintf(buf, "%s.write_arounds", name);
+      stat_reg_counter(sdb, buf, "total number of write misses not allocated", &cp->write_arounds, 0, NULL);
+    }
+  if (cp->victim)
+    {
+      sprintf(buf, "%s.victim_hits", name);
+      stat_reg_counter(sdb, buf, "total number of misses hitting in the victim buffer", &cp->victim_hits, 0, NULL);
+      sprintf(buf, "%s.victim_misses", name);
+      stat_reg_counter(sdb, buf, "total number of misses missing in the victim buffer", &cp->victim_misses, 0, NULL);
+      sprintf(buf, "%s.victim_hit_rate", name);
+      sprintf(buf1, "%s.victim_hits / %s.misses", name, name);
+      stat_reg_formula(sdb, buf, "fraction of misses hitting in the victim buffer", buf1, NULL);
+    }
+  if (cp->shadow)
+    {
+      sprintf(buf, "%s.compulsory_misses", name);
+      stat_reg_counter(sdb, buf, "total number of misses to blocks never touched", &cp->compulsory_misses, 0, NULL);
+      sprintf(buf, "%s.capacity_misses", name);
+      stat_reg_counter(sdb, buf, "total number of misses a fully-associative cache misses too", &cp->capacity_misses, 0, NULL);
+      sprintf(buf, "%s.conflict_misses", name);
+      stat_reg_counter(sdb, buf, "total number of misses a fully-associative cache hits", &cp->conflict_misses, 0, NULL);
+      sprintf(buf, "%s.conflict_rate", name);
+      sprintf(buf1, "%s.conflict_misses / %s.misses", name, name);
+      stat_reg_formula(sdb, buf, "fraction of misses that are conflict misses", buf1, NULL);
+    }
+  if (cp->sample_rate / cp->sample_slices > 1)
+    {
+      /* the miss rate is a ratio estimate over the sets modelled, a sample
+	 of SAMPLE_NSETS of the NSETS sets, its variance is (1 - f) n D /
+	 ((n - 1) A^2), f = n/NSETS, D the sum over the sets of their
+	 squared deviation from the miss rate, misses - miss_rate * accesses */
+      double n = cp->sample_nsets * cp->sample_slices;
+
+      sprintf(buf, "%s.sample_skips", name);
+      stat_reg_counter(sdb, buf, "total number of accesses to sets not modelled", &cp->sample_skips, 0, NULL);
+      sprintf(buf, "%s.sample_acc_sq", name);
+      stat_reg_double(sdb, buf, "sum over the modelled sets of accesses squared", &cp->sample_acc_sq, 0.0, "%12.0f");
+      sprintf(buf, "%s.sample_miss_sq", name);
+      stat_reg_double(sdb, buf, "sum over the modelled sets of misses squared", &cp->sample_miss_sq, 0.0, "%12.0f");
+      sprintf(buf, "%s.sample_acc_miss", name);
+      stat_reg_double(sdb, buf, "sum over the modelled sets of accesses times misses", &cp->sample_acc_miss, 0.0, "%12.0f");
+      sprintf(buf, "%s.est_accesses", name);
+      sprintf(buf1, "%s.accesses + %s.sample_skips", name, name);
+      stat_reg_formula(sdb, buf, "total number of accesses, all sets", buf1, "%12.0f");
+      sprintf(buf, "%s.est_misses", name);
+      sprintf(buf1, "%s.miss_rate * %s.est_accesses", name, name);
+      stat_reg_formula(sdb, buf, "estimated number of misses, all sets", buf1, "%12.0f");
+      sprintf(buf, "%s.est_writebacks", name);
+      sprintf(buf1, "%s.wb_rate * %s.est_accesses", name, name);
+      stat_reg_formula(sdb, buf, "estimated number of writebacks, all sets", buf1, "%12.0f");
+      if (n > 1.0)
+	{
+	  sprintf(buf, "%s.miss_rate_ci", name);
+	  /* NOTE: the formula evaluator groups a - b + c as a - (b + c) */
+	  sprintf(buf1, "1.96 * sqrt(%.9g * ((%s.sample_miss_sq"
+		  " + %s.miss_rate * %s.miss_rate * %s.sample_acc_sq)"
+		  " - 2 * %s.miss_rate * %s.sample_acc_miss)"
+		  " / (%s.accesses * %s.accesses))",
+		  (1.0 - n/cp->nsets) * n / (n - 1.0),
+		  name, name, name, name, name, name, name, name);
+	  stat_reg_formula(sdb, buf, "miss_rate 95% confidence interval, +/-", buf1, NULL);
+	}
+    }
+  if (cp->mshr)
+    {
+      sprintf(buf, "%s.mshr_allocs", name);
+      stat_reg_counter(sdb, buf, "total number of misses allocating an MSHR", &cp->mshr_allocs, 0, NULL);
+      sprintf(buf, "%s.mshr_merges", name);
+      stat_reg_counter(sdb, buf, "total number of secondary misses merged into an MSHR", &cp->mshr_merges, 0, NULL);
+      sprintf(buf, "%s.mshr_full_stalls", name);
+      stat_reg_counter(sdb, buf, "total number of misses waiting for a free MSHR", &cp->mshr_full_stalls, 0, NULL);
+      sprintf(buf, "%s.mshr_stall_cycles", name);
+      stat_reg_counter(sdb, buf, "total cycles misses waited for a free MSHR", &cp->mshr_stall_cycles, 0, NULL);
+      sprintf(buf, "%s.mshr_busy_cycles", name);
+      stat_reg_counter(sdb, buf, "total MSHR-cycles of outstanding misses", &cp->mshr_busy_cycles, 0, NULL);
+      sprintf(buf, "%s.mshr_miss_cycles", name);
+      stat_reg_counter(sdb, buf, "total cycles with at least one outstanding miss", &cp->mshr_miss_cycles, 0, NULL);
+      sprintf(buf, "%s.mshr_mlp", name);
+      sprintf(buf1, "%s.mshr_busy_cycles / %s.mshr_miss_cycles", name, name);
+      stat_reg_formula(sdb, buf, "memory-level parallelism (misses outstanding when any are)", buf1, NULL);
+      sprintf(buf, "%s.mshr_occupancy", name);
+      cp->mshr_occ_dist =
+	stat_reg_dist(sdb, buf, "MSHRs in use at each miss", /* init */0,
+		      /* arr sz */cp->mshr_size+1, /* bucket sz */1,
+		      (PF_COUNT|PF_PDF), /* format */NULL, /* imap */NULL,
+		      /* print fn */NULL);
+    }
+  if (cp->pf)
+    {
+      sprintf(buf, "%s.pf_issued", name);
+      stat_reg_counter(sdb, buf, "total number of prefetch fills", &cp->pf_issued, 0, NULL);
+      sprintf(buf, "%s.pf_useful", name);
+      stat_reg_counter(sdb, buf, "total number of prefetched blocks used", &cp->pf_useful, 0, NULL);
+      sprintf(buf, "%s.pf_late", name);
+      stat_reg_counter(sdb, buf, "total number of prefetched blocks used before ready", &cp->pf_late, 0, NULL);
+      sprintf(buf, "%s.pf_useless", name);
+      stat_reg_counter(sdb, buf, "total number of prefetched blocks evicted unused", &cp->pf_useless, 0, NULL);
+      sprintf(buf, "%s.pf_accuracy", name);
+      sprintf(buf1, "%s.pf_useful / %s.pf_issued", name, name);
+      stat_reg_formula(sdb, buf, "fraction of prefetch fills used", buf1, NULL);
+      sprintf(buf, "%s.pf_coverage", name);
+      sprintf(buf1, "%s.pf_useful / (%s.pf_useful + %s.misses)", name, name, name);
+      stat_reg_formula(sdb, buf, "fraction of misses eliminated by prefetching", buf1, NULL);
+      prefetch_reg_stats(cp->pf, name, sdb);
+    }
+  if (cp->reuse)
+    reuse_reg_stats(cp->reuse, name, sdb);
+  if (cp->rrpv)
+    {
+      sprintf(buf, "%s.rrip_distant_fills", name);
+      stat_reg_counter(sdb, buf, "total number of fills predicted distant", &cp->rrip_distant_fills, 0, NULL);
+    }
+  if (cp->policy == DRRIP)
+    {
+      sprintf(buf, "%s.sdm_srrip_misses", name);
+      stat_reg_counter(sdb, buf, "total number of misses in SRRIP leader sets", &cp->sdm_srrip_misses, 0, NULL);
+      sprintf(buf, "%s.sdm_brrip_misses", name);
+      stat_reg_counter(sdb, buf, "total number of misses in BRRIP leader sets", &cp->sdm_brrip_misses, 0, NULL);
+      sprintf(buf, "%s.follower_brrip_fills", name);
+      stat_reg_counter(sdb, buf, "total number of follower set fills using BRRIP", &cp->follower_brrip_fills, 0, NULL);
+      sprintf(buf, "%s.psel", name);
+      stat_reg_int(sdb, buf, "final DRRIP policy selector (> 511 is BRRIP)", &cp->psel, cp->psel, NULL);
+    }
+  if (cp->wbuf)
+    {
+      sprintf(buf, "%s.wbuf_writes", name);
+      stat_reg_counter(sdb, buf, "total number of writes into the write buffer", &cp->wbuf_writes, 0, NULL);
+      sprintf(buf, "%s.wbuf_coalesced", name);
+      stat_reg_counter(sdb, buf, "total number of writes combined in the write buffer", &cp->wbuf_coalesced, 0, NULL);
+      sprintf(buf, "%s.wbuf_drains", name);
+      stat_reg_counter(sdb, buf, "total number of write buffer drains to next level", &cp->wbuf_drains, 0, NULL);
+      sprintf(buf, "%s.wbuf_full_stalls", name);
+      stat_reg_counter(sdb, buf, "total number of writes stalled by a full write buffer", &cp->wbuf_full_stalls, 0, NULL);
+      sprintf(buf, "%s.wbuf_stall_cycles", name);
+      stat_reg_counter(sdb, buf, "total cycles stalled by a full write buffer", &cp->wbuf_stall_cycles, 0, NULL);
+      sprintf(buf, "%s.wbuf_coalesce_rate", name);
+      sprintf(buf1, "%s.wbuf_coalesced / %s.wbuf_writes", name, name);
+      stat_reg_formula(sdb, buf, "fraction of writes combined in the write buffer", buf1, NULL);
+    }
+}
+
+/* print cache stats */
+void cache_stats(struct cache_t *cp, FILE *stream)
+{
+  double sum = (double)(cp->hits + cp->misses);
+
+  fprintf(stream,
+	  "cache: %s: %.0f hits %.0f misses %.0f repls %.0f invalidations\n",
+	  cp->name, (double)cp->hits, (double)cp->misses,
 	  (double)cp->replacements, (double)cp->invalidations);
   fprintf(stream,
 	  "cache: %s: miss rate=%f  repl rate=%f  invalidation rate=%f\n",
@@ -339,108 +1635,309 @@ void cache_stats(struct cache_t *cp, FILE *stream)
 	  (double)cp->invalidations/sum);
 }
 
-/* access a cache */
-unsigned int
-cache_access(struct cache_t *cp, enum mem_cmd cmd, md_addr_t addr, void *vp,
-	     int nbytes, tick_t now, byte_t **udata, md_addr_t *repl_addr)
+/* choose the block of skewed-associative cache CP to replace on a miss of
+   tag TAG, of the blocks of the set of each way for TAG, an invalid block
+   if there is one, else by the policy of the cache, the least recently used
+   (LRU), least recently filled (FIFO) or a random block */
+static struct cache_blk_t *
+cache_repl_skew_blk(struct cache_t *cp, md_addr_t tag, md_addr_t *setp,
+		    int *wayp)
+{
+  md_addr_t set, repl_set = 0;
+  counter_t stamp;
+  int way, repl_way = -1;
+
+  for (way=0; way<cp->assoc; way++)
+    {
+      set = cache_skew_set(cp, tag, way);
+      if (CACHE_SET_TAGS(cp, set)[way] == CACHE_TAG_INVALID)
+	{
+	  repl_set = set;
+	  repl_way = way;
+	  break;
+	}
+      stamp = cp->skew_stamp[set*cp->assoc + way];
+      if (repl_way < 0 || stamp < cp->skew_stamp[repl_set*cp->assoc + repl_way])
+	{
+	  repl_set = set;
+	  repl_way = way;
+	}
+    }
+
+  if (way == cp->assoc && cp->policy == Random)
+    {
+      repl_way = cache_rand(cp) & (cp->assoc - 1);
+      repl_set = cache_skew_set(cp, tag, repl_way);
+    }
+
+  cp->skew_stamp[repl_set*cp->assoc + repl_way] = ++cp->skew_clock;
+  *setp = repl_set;
+  *wayp = repl_way;
+  return CACHE_BINDEX(cp, cp->sets[repl_set].blks, repl_way);
+}
+
+/* choose the block of set *SETP of cache CP to replace on a miss of tag
+   TAG, and its way in *WAYP, the replacement state is updated as if the
+   block was filled, the set of a skewed-associative cache depends on the
+   way, it is returned in *SETP */
+static struct cache_blk_t *
+cache_repl_blk(struct cache_t *cp, md_addr_t *setp, md_addr_t tag, int *wayp)
+{
+  struct cache_blk_t *repl;
+  md_addr_t set = *setp;
+  int way;
+
+  if (cp->index == IndexSkew)
+    return cache_repl_skew_blk(cp, tag, setp, wayp);
+
+  switch (cp->policy) {
+  case LRU:
+  case FIFO:
+    repl = cp->sets[set].way_tail;
+    way = CACHE_WAY(cp, set, repl);
+    update_way_list(&cp->sets[set], repl, Head);
+    break;
+  case Random:
+    way = cache_rand(cp) & (cp->assoc - 1);
+    repl = CACHE_BINDEX(cp, cp->sets[set].blks, way);
+    break;
+  case TreePLRU:
+  case BitPLRU:
+    /* fill invalid blocks first */
+    way = cache_find_way(cp, set, CACHE_TAG_INVALID);
+    if (way < 0)
+      way = plru_victim(cp, set);
+    repl = CACHE_BINDEX(cp, cp->sets[set].blks, way);
+    plru_touch(cp, set, way);
+    break;
+  case SRRIP:
+  case BRRIP:
+  case DRRIP:
+    /* fill invalid blocks first */
+    way = cache_find_way(cp, set, CACHE_TAG_INVALID);
+    if (way < 0)
+      way = rrip_victim(cp, set);
+    repl = CACHE_BINDEX(cp, cp->sets[set].blks, way);
+    rrip_fill(cp, set, way);
+    break;
+  default:
+    panic("bogus replacement policy");
+  }
+
+  *wayp = way;
+  return repl;
+}
+
+/* evict block REPL, way WAY of SET of cache CP, and fill it with the block
+   of TAG at NOW, from the victim buffer if it is there, else from the next
+   level, returns the latency of the fill, the address of the evicted block
+   is returned in *REPL_ADDR (if non-NULL) */
+static int
+cache_fill(struct cache_t *cp, struct cache_blk_t *repl, md_addr_t set,
+	   int way, md_addr_t tag, tick_t now, md_addr_t *repl_addr)
+{
+  md_addr_t baddr = CACHE_MK_BADDR(cp, tag, set);
+  unsigned int vstatus = 0;
+  int lat = 0, valid = CACHE_SET_TAGS(cp, set)[way] != CACHE_TAG_INVALID;
+
+  if (cp->hsize) unlink_htab_ent(cp, &cp->sets[set], repl);
+
+  cp->last_tagset = 0;
+  cp->last_blk = NULL;
+
+  if (!valid)
+    cp->valid_blks++;
+  else
+    {
+      cp->replacements++;
+      if (repl->status & CACHE_BLK_PREFETCH)
+	{
+	  cp->pf_useless++;
+	  cp->pf_pending--;
+	}
+
+      if (repl_addr) *repl_addr = CACHE_MK_BADDR(cp, repl->tag, set);
+
+      lat += BOUND_POS(repl->ready - now);
+
+      /* evicted blocks go to the victim buffer, if any, else to the bus */
+      if (!cp->victim)
+	{
+	  if (!cp->bus)
+	    {
+	      lat += BOUND_POS(cp->bus_free - (now + lat));
+	      cp->bus_free = MAX(cp->bus_free, (now + lat)) + 1;
+	    }
+
+	  if (repl->status & CACHE_BLK_DIRTY)
+	    {
+	      if (cp->bus)
+		lat += bus_access(cp->bus, cp->bsize, now+lat, now);
+	      cp->writebacks++;
+	      lat += cp->blk_access_fn(Write,
+				       CACHE_MK_BADDR(cp, repl->tag, set),
+				       cp->bsize, repl, now+lat);
+	    }
+	}
+    }
+
+  if (cp->victim)
+    vstatus = victim_access(cp, repl, valid, set, baddr, now, &lat);
+
+  repl->tag = tag;
+  repl->status = CACHE_BLK_VALID | (vstatus & CACHE_BLK_DIRTY);
+  if (vstatus & CACHE_BLK_DIRTY)
+    CACHE_MARK_DIRTY(cp, set);
+  CACHE_SET_TAGS(cp, set)[way] = tag;
+
+  if (vstatus)
+    lat += cp->victim_lat;
+  else
+    {
+      lat += cp->blk_access_fn(Read, baddr, cp->bsize, repl, now+lat);
+
+      /* the block comes back over the bus once the next level has it */
+      if (cp->bus)
+	lat += bus_access(cp->bus, cp->bsize, now+lat, now);
+    }
+
+  if (cp->hsize) link_htab_ent(cp, &cp->sets[set], repl);
+
+  return lat;
+}
+
+/* prefetch the block containing ADDR into cache CP at NOW */
+int
+cache_prefetch(struct cache_t *cp, md_addr_t addr, tick_t now)
+{
+  md_addr_t tag = CACHE_TAG(cp, addr);
+  md_addr_t set = CACHE_SET(cp, addr);
+  struct cache_blk_t *repl;
+  int way;
+
+  /* prefetches to the sets not modelled are dropped */
+  if (cp->sample_rate > 1)
+    {
+      set = CACHE_SAMPLE_SET(cp, set);
+      if (set >= cp->sample_nsets)
+	return FALSE;
+    }
+
+  if (cache_find_blk(cp, &set, tag, &way))
+    return FALSE;
+
+  /* prefetches are dropped when no MSHR is free */
+  if (cp->mshr)
+    {
+      mshr_retire(cp, now);
+      if (cp->mshr_num == cp->mshr_size)
+	return FALSE;
+    }
+
+  repl = cache_repl_blk(cp, &set, tag, &way);
+  repl->ready = now + cache_fill(cp, repl, set, way, tag, now, NULL);
+  repl->status |= CACHE_BLK_PREFETCH;
+  cp->pf_pending++;
+  cp->pf_issued++;
+
+  if (cp->mshr)
+    mshr_alloc(cp, CACHE_BADDR(cp, addr), now, repl->ready);
+
+  return TRUE;
+}
+
+/* access cache CP, which has optional features (see CP->EXTRAS), with the
+   tag TAG and set SET of ADDR already decoded, the access checks have been
+   done by cache_access_fast() */
+static unsigned int
+cache_access_extras(struct cache_t *cp, enum mem_cmd cmd, md_addr_t addr,
+		    md_addr_t tag, md_addr_t set, void *vp, int nbytes,
+		    tick_t now, byte_t **udata, md_addr_t *repl_addr)
 {
   byte_t *p = vp;
-  md_addr_t tag = CACHE_TAG(cp, addr);
-  md_addr_t set = CACHE_SET(cp, addr);
   md_addr_t bofs = CACHE_BLK(cp, addr);
   struct cache_blk_t *blk, *repl;
-  int lat = 0;
+  tick_t start;
+  int lat = 0, way, pfhit = FALSE;
 
-  if (repl_addr) *repl_addr = 0;
-
-  if ((nbytes & (nbytes-1)) != 0 || (addr & (nbytes-1)) != 0)
-    fatal("cache: access error: bad size or alignment, addr 0x%08x", addr);
-
-  if ((addr + nbytes) > ((addr & ~cp->blk_mask) + cp->bsize))
-    fatal("cache: access error: access spans block, addr 0x%08x", addr);
+  if (cp->reuse)
+    reuse_access(cp->reuse, addr);
 
   if (CACHE_TAGSET(cp, addr) == cp->last_tagset)
     { blk = cp->last_blk; goto cache_fast_hit; }
 
-  if (cp->hsize)
-    {
-      int hindex = CACHE_HASH(cp, tag);
-      for (blk=cp->sets[set].hash[hindex]; blk; blk=blk->hash_next)
-	if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	  goto cache_hit;
-    }
-  else
-    {
-      for (blk=cp->sets[set].way_head; blk; blk=blk->way_next)
-	if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	  goto cache_hit;
-    }
+  blk = cache_find_blk(cp, &set, tag, &way);
+  if (blk)
+    goto cache_hit;
 
   /* -------- MISS -------- */
   cp->misses++;
 
-  switch (cp->policy) {
-  case LRU:
-  case FIFO:
-    repl = cp->sets[set].way_tail;
-    update_way_list(&cp->sets[set], repl, Head);
-    break;
-  case Random:
-    {
-      int bindex = myrand() & (cp->assoc - 1);
-      repl = CACHE_BINDEX(cp, cp->sets[set].blks, bindex);
-    }
-    break;
-  default:
-    panic("bogus replacement policy");
-  }
-
-  if (cp->hsize) unlink_htab_ent(cp, &cp->sets[set], repl);
-
-  cp->last_tagset = 0;
-  cp->last_blk = NULL;
+  if (cp->shadow)
+    shadow_classify(cp, addr, cmd == Read || cp->walloc);
 
-  if (repl->status & CACHE_BLK_VALID)
+  /* no-write-allocate, the write goes around the cache to the next level */
+  if (cmd == Write && !cp->walloc)
     {
-      cp->replacements++;
-
-      if (repl_addr) *repl_addr = CACHE_MK_BADDR(cp, repl->tag, set);
-
-      lat += BOUND_POS(repl->ready - now);
-      lat += BOUND_POS(cp->bus_free - (now + lat));
-      cp->bus_free = MAX(cp->bus_free, (now + lat)) + 1;
+      cp->write_arounds++;
+      if (udata) *udata = NULL;
 
-      if (repl->status & CACHE_BLK_DIRTY)
+      if (cp->wbuf)
+	lat += cache_wbuf_write(cp, CACHE_BADDR(cp, addr), NULL, now);
+      else
 	{
+	  if (cp->bus)
+	    lat += bus_access(cp->bus, cp->bsize, now, now);
+	  else
+	    {
+	      lat += BOUND_POS(cp->bus_free - now);
+	      cp->bus_free = MAX(cp->bus_free, (now + lat)) + 1;
+	    }
 	  cp->writebacks++;
-	  lat += cp->blk_access_fn(Write,
-				   CACHE_MK_BADDR(cp, repl->tag, set),
-				   cp->bsize, repl, now+lat);
+	  lat += cp->blk_access_fn(Write, CACHE_BADDR(cp, addr), cp->bsize, NULL, now+lat);
 	}
+
+      if (cp->pf) prefetch_access(cp->pf, cp->pc, addr, TRUE, FALSE, now);
+
+      return lat;
     }
 
-  repl->tag = tag;
-  repl->status = CACHE_BLK_VALID;
+  /* a miss needs an MSHR, it waits for one if all are in use */
+  if (cp->mshr)
+    lat += mshr_wait(cp, now);
+  start = now+lat;
 
-  lat += cp->blk_access_fn(Read, CACHE_BADDR(cp, addr), cp->bsize, repl, now+lat);
+  repl = cache_repl_blk(cp, &set, tag, &way);
+  lat += cache_fill(cp, repl, set, way, tag, start, repl_addr);
 
   if (cp->balloc) { CACHE_BCOPY(cmd, repl, bofs, p, nbytes); }
 
   if (cmd == Write)
   {
-#if WRITE_POLICY == WRITE_BACK
-    repl->status |= CACHE_BLK_DIRTY;
-#else
-    cp->writebacks++;
-    lat += cp->blk_access_fn(Write, CACHE_BADDR(cp, addr), cp->bsize, repl, now+lat);
-#endif
+    if (cp->wpolicy == WriteBack)
+      {
+	repl->status |= CACHE_BLK_DIRTY;
+	CACHE_MARK_DIRTY(cp, set);
+      }
+    else if (cp->wbuf)
+      lat += cache_wbuf_write(cp, CACHE_BADDR(cp, addr), repl, now+lat);
+    else
+      {
+	cp->writebacks++;
+	if (cp->bus)
+	  lat += bus_access(cp->bus, cp->bsize, now+lat, now);
+	lat += cp->blk_access_fn(Write, CACHE_BADDR(cp, addr), cp->bsize, repl, now+lat);
+      }
   }
 
   if (udata) *udata = repl->user_data;
 
   repl->ready = now+lat;
 
-  if (cp->hsize) link_htab_ent(cp, &cp->sets[set], repl);
+  if (cp->mshr)
+    mshr_alloc(cp, CACHE_BADDR(cp, addr), start, repl->ready);
+
+  if (cp->pf) prefetch_access(cp->pf, cp->pc, addr, TRUE, FALSE, now);
 
   return lat;
 
@@ -448,42 +1945,99 @@ cache_access(struct cache_t *cp, enum mem_cmd cmd, md_addr_t addr, void *vp,
 cache_hit:
   cp->hits++;
 
+  if (cp->shadow)
+    shadow_access(cp, CACHE_BADDR(cp, addr), TRUE);
+
+  /* an access to a block still being filled is a secondary miss */
+  if (cp->mshr && blk->ready > now)
+    mshr_merge(cp, CACHE_BADDR(cp, addr));
+
+  /* first use of a prefetched block */
+  if (blk->status & CACHE_BLK_PREFETCH)
+    {
+      pfhit = TRUE;
+      cp->pf_useful++;
+      cp->pf_pending--;
+      if (blk->ready > now)
+	cp->pf_late++;
+      blk->status &= ~CACHE_BLK_PREFETCH;
+    }
+
   if (cp->balloc) { CACHE_BCOPY(cmd, blk, bofs, p, nbytes); }
 
   if (cmd == Write)
   {
-#if WRITE_POLICY == WRITE_BACK
-    blk->status |= CACHE_BLK_DIRTY;
-#else
-    cp->writebacks++;
-    cp->blk_access_fn(Write, CACHE_BADDR(cp, addr), cp->bsize, blk, now);
-#endif
+    if (cp->wpolicy == WriteBack)
+      {
+	blk->status |= CACHE_BLK_DIRTY;
+	CACHE_MARK_DIRTY(cp, set);
+      }
+    else if (cp->wbuf)
+      lat += cache_wbuf_write(cp, CACHE_BADDR(cp, addr), blk, now);
+    else
+      {
+	cp->writebacks++;
+	if (cp->bus)
+	  bus_access(cp->bus, cp->bsize, now, now);
+	cp->blk_access_fn(Write, CACHE_BADDR(cp, addr), cp->bsize, blk, now);
+      }
   }
 
-  if (blk->way_prev && cp->policy == LRU)
+  if (cp->skew_stamp)
+    {
+      if (cp->policy == LRU)
+	cp->skew_stamp[set*cp->assoc + way] = ++cp->skew_clock;
+    }
+  else if (blk->way_prev && cp->policy == LRU)
     update_way_list(&cp->sets[set], blk, Head);
+  else if (cp->plru)
+    plru_touch(cp, set, way >= 0 ? way : CACHE_WAY(cp, set, blk));
+  else if (cp->rrpv)
+    CACHE_RRPV(cp, set)[way >= 0 ? way : CACHE_WAY(cp, set, blk)] = 0;
 
   cp->last_tagset = CACHE_TAGSET(cp, addr);
   cp->last_blk = blk;
 
   if (udata) *udata = blk->user_data;
 
-  return (int) MAX(cp->hit_latency, (blk->ready - now));
+  lat += MAX(cp->hit_latency, (blk->ready - now));
+
+  if (cp->pf) prefetch_access(cp->pf, cp->pc, addr, FALSE, pfhit, now);
+
+  return lat;
 
   /* -------- FAST HIT -------- */
 cache_fast_hit:
   cp->hits++;
 
+  /* the last block of a skewed-associative cache is in the set of its way */
+  if (cp->index == IndexSkew)
+    set = CACHE_BLK_SET(cp, blk);
+
+  if (cp->shadow)
+    shadow_access(cp, CACHE_BADDR(cp, addr), TRUE);
+
+  if (cp->mshr && blk->ready > now)
+    mshr_merge(cp, CACHE_BADDR(cp, addr));
+
   if (cp->balloc) { CACHE_BCOPY(cmd, blk, bofs, p, nbytes); }
 
   if (cmd == Write)
   {
-#if WRITE_POLICY == WRITE_BACK
-    blk->status |= CACHE_BLK_DIRTY;
-#else
-    cp->writebacks++;
-    cp->blk_access_fn(Write, CACHE_BADDR(cp, addr), cp->bsize, blk, now);
-#endif
+    if (cp->wpolicy == WriteBack)
+      {
+	blk->status |= CACHE_BLK_DIRTY;
+	CACHE_MARK_DIRTY(cp, set);
+      }
+    else if (cp->wbuf)
+      lat += cache_wbuf_write(cp, CACHE_BADDR(cp, addr), blk, now);
+    else
+      {
+	cp->writebacks++;
+	if (cp->bus)
+	  bus_access(cp->bus, cp->bsize, now, now);
+	cp->blk_access_fn(Write, CACHE_BADDR(cp, addr), cp->bsize, blk, now);
+      }
   }
 
   if (udata) *udata = blk->user_data;
@@ -491,7 +2045,222 @@ cache_fast_hit:
   cp->last_tagset = CACHE_TAGSET(cp, addr);
   cp->last_blk = blk;
 
-  return (int) MAX(cp->hit_latency, (blk->ready - now));
+  lat += MAX(cp->hit_latency, (blk->ready - now));
+
+  /* the last block accessed cannot be an unused prefetch */
+  if (cp->pf) prefetch_access(cp->pf, cp->pc, addr, FALSE, FALSE, now);
+
+  return lat;
+}
+
+/* finish a hit of cache CP, which has no optional features, on block BLK
+   of set SET */
+static ALWAYS_INLINE unsigned int
+cache_hit_plain(struct cache_t *cp, enum mem_cmd cmd, md_addr_t addr,
+		struct cache_blk_t *blk, md_addr_t set, void *vp, int nbytes,
+		tick_t now, byte_t **udata)
+{
+  byte_t *p = vp;
+  md_addr_t bofs;
+
+  if (cp->balloc)
+    {
+      bofs = CACHE_BLK(cp, addr);
+      CACHE_BCOPY(cmd, blk, bofs, p, nbytes);
+    }
+
+  if (cmd == Write)
+    {
+      if (cp->wpolicy == WriteThrough)
+	{
+	  cp->writebacks++;
+	  cp->blk_access_fn(Write, CACHE_BADDR(cp, addr), cp->bsize, blk, now);
+	}
+      else if (!(blk->status & CACHE_BLK_DIRTY))
+	{
+	  blk->status |= CACHE_BLK_DIRTY;
+	  CACHE_MARK_DIRTY(cp, set);
+	}
+    }
+
+  if (udata) *udata = blk->user_data;
+
+  return MAX(cp->hit_latency, (blk->ready - now));
+}
+
+/* access cache CP, which has no optional features, for a reference that is
+   not to the block last accessed, i.e., a slow hit or a miss, the set is
+   given by the index bits of ADDR */
+static unsigned int
+cache_access_plain(struct cache_t *cp, enum mem_cmd cmd, md_addr_t addr,
+		   void *vp, int nbytes, tick_t now, byte_t **udata,
+		   md_addr_t *repl_addr)
+{
+  byte_t *p = vp;
+  md_addr_t tag = CACHE_TAG(cp, addr), set = CACHE_BITS_SET(cp, addr), bofs;
+  struct cache_blk_t *blk, *repl;
+  int lat, way;
+
+  blk = cache_find_blk(cp, &set, tag, &way);
+  if (blk)
+    {
+      /* -------- HIT (slow) -------- */
+      cp->hits++;
+
+      if (blk->way_prev && cp->policy == LRU)
+	update_way_list(&cp->sets[set], blk, Head);
+      else if (cp->plru)
+	plru_touch(cp, set, way >= 0 ? way : CACHE_WAY(cp, set, blk));
+      else if (cp->rrpv)
+	CACHE_RRPV(cp, set)[way >= 0 ? way : CACHE_WAY(cp, set, blk)] = 0;
+
+      cp->last_tagset = CACHE_TAGSET(cp, addr);
+      cp->last_blk = blk;
+      cp->last_set = set;
+
+      return cache_hit_plain(cp, cmd, addr, blk, set, vp, nbytes, now, udata);
+    }
+
+  /* -------- MISS -------- */
+  cp->misses++;
+
+  repl = cache_repl_blk(cp, &set, tag, &way);
+  lat = cache_fill(cp, repl, set, way, tag, now, repl_addr);
+
+  if (cp->balloc)
+    {
+      bofs = CACHE_BLK(cp, addr);
+      CACHE_BCOPY(cmd, repl, bofs, p, nbytes);
+    }
+
+  if (cmd == Write)
+    {
+      if (cp->wpolicy == WriteBack)
+	{
+	  repl->status |= CACHE_BLK_DIRTY;
+	  CACHE_MARK_DIRTY(cp, set);
+	}
+      else
+	{
+	  cp->writebacks++;
+	  lat += cp->blk_access_fn(Write, CACHE_BADDR(cp, addr), cp->bsize,
+				   repl, now+lat);
+	}
+    }
+
+  if (udata) *udata = repl->user_data;
+
+  repl->ready = now+lat;
+
+  return lat;
+}
+
+/* access set-sampled cache CP, accesses to the sets not modelled are
+   skipped, they see the mean latency of the accesses modelled */
+static unsigned int
+cache_access_sampled(struct cache_t *cp, enum mem_cmd cmd, md_addr_t addr,
+		     void *vp, int nbytes, tick_t now, byte_t **udata,
+		     md_addr_t *repl_addr)
+{
+  md_addr_t set = CACHE_SAMPLE_SET(cp, CACHE_SET(cp, addr));
+  counter_t a, m, misses = cp->misses;
+  unsigned int lat;
+
+  if (set >= cp->sample_nsets)
+    {
+      cp->sample_skips++;
+      if (udata) *udata = NULL;
+      if (repl_addr) *repl_addr = 0;
+      return cp->sample_mean_lat;
+    }
+
+  lat = cache_access_extras(cp, cmd, addr, CACHE_TAG(cp, addr), set,
+			    vp, nbytes, now, udata, repl_addr);
+  cp->sample_lat += lat;
+  a = cp->hits + cp->misses;
+  cp->sample_mean_lat = (unsigned int)((cp->sample_lat + a/2) / a);
+
+  /* keep the sums over the modelled sets of their accesses squared, misses
+     squared and accesses times misses, for the variance of the miss rate */
+  a = cp->sample_acc[set]++;
+  m = cp->sample_miss[set];
+  cp->sample_acc_sq += 2.0*a + 1.0;
+  cp->sample_acc_miss += (double)m;
+  if (cp->misses != misses)
+    {
+      cp->sample_miss[set]++;
+      cp->sample_miss_sq += 2.0*m + 1.0;
+      cp->sample_acc_miss += (double)(a + 1);
+    }
+
+  return lat;
+}
+
+/* access cache CP, the common path of cache_access() and
+   cache_access_batch(), inlined into both: a hit on the block last accessed
+   is handled here, the other references of caches without optional
+   features take cache_access_plain(), caches with optional features (see
+   CP->EXTRAS) take cache_access_extras() */
+static ALWAYS_INLINE unsigned int
+cache_access_fast(struct cache_t *cp, enum mem_cmd cmd, md_addr_t addr,
+		  void *vp, int nbytes, tick_t now, byte_t **udata,
+		  md_addr_t *repl_addr)
+{
+  if (repl_addr) *repl_addr = 0;
+
+  if ((nbytes & (nbytes-1)) != 0 || (addr & (nbytes-1)) != 0)
+    fatal("cache: access error: bad size or alignment, addr 0x%08x", addr);
+
+  if ((addr + nbytes) > ((addr & ~cp->blk_mask) + cp->bsize))
+    fatal("cache: access error: access spans block, addr 0x%08x", addr);
+
+  if (cp->extras)
+    {
+      if (cp->sample_rate > 1)
+	return cache_access_sampled(cp, cmd, addr, vp, nbytes, now,
+				    udata, repl_addr);
+      return cache_access_extras(cp, cmd, addr, CACHE_TAG(cp, addr),
+				 CACHE_SET(cp, addr), vp, nbytes, now,
+				 udata, repl_addr);
+    }
+
+  if (CACHE_TAGSET(cp, addr) != cp->last_tagset)
+    return cache_access_plain(cp, cmd, addr, vp, nbytes, now,
+			      udata, repl_addr);
+
+  /* -------- FAST HIT -------- */
+  cp->hits++;
+  return cache_hit_plain(cp, cmd, addr, cp->last_blk, cp->last_set,
+			 vp, nbytes, now, udata);
+}
+
+/* access a cache */
+unsigned int
+cache_access(struct cache_t *cp, enum mem_cmd cmd, md_addr_t addr, void *vp,
+	     int nbytes, tick_t now, byte_t **udata, md_addr_t *repl_addr)
+{
+  return cache_access_fast(cp, cmd, addr, vp, nbytes, now, udata, repl_addr);
+}
+
+/* access a cache with a batch of references, the access is inlined into
+   one loop over the batch (prefetching the sets of the batch, or decoding
+   its tags and sets ahead of the lookups, cost more than they saved) */
+void
+cache_access_batch(struct cache_t *cp, struct cache_ref_t *refs, int nrefs,
+		   tick_t now, unsigned int *lats)
+{
+  unsigned int lat;
+  int i;
+
+  for (i=0; i<nrefs; i++)
+    {
+      cp->pc = refs[i].pc;
+      cp->batch_ref = i;
+      lat = cache_access_fast(cp, refs[i].cmd, refs[i].addr, NULL,
+			      refs[i].nbytes, now, NULL, NULL);
+      if (lats)
+	lats[i] = lat;
+    }
 }
 
 /* return non-zero if block containing address ADDR is contained in cache */
@@ -499,52 +2268,81 @@ int cache_probe(struct cache_t *cp, md_addr_t addr)
 {
   md_addr_t tag = CACHE_TAG(cp, addr);
   md_addr_t set = CACHE_SET(cp, addr);
-  struct cache_blk_t *blk;
+  int way;
 
-  if (cp->hsize)
-  {
-    int hindex = CACHE_HASH(cp, tag);
-    for (blk=cp->sets[set].hash[hindex]; blk; blk=blk->hash_next)
-      if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	return TRUE;
-  }
-  else
-  {
-    for (blk=cp->sets[set].way_head; blk; blk=blk->way_next)
-      if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	return TRUE;
-  }
-  return FALSE;
+  if (cp->sample_rate > 1)
+    {
+      set = CACHE_SAMPLE_SET(cp, set);
+      if (set >= cp->sample_nsets)
+	return FALSE;
+    }
+
+  return cache_find_blk(cp, &set, tag, &way) != NULL;
 }
 
-/* flush the entire cache, returns latency of the operation */
+/* flush the entire cache, returns latency of the operation, only the sets
+   marked as holding dirty blocks are visited, the other blocks are all
+   invalidated at once by resetting the tag store */
 unsigned int cache_flush(struct cache_t *cp, tick_t now)
 {
-  int i, lat = cp->hit_latency;
+  int i, w, way, lat = cp->hit_latency;
+  unsigned int bits;
+  md_addr_t set, *tags;
   struct cache_blk_t *blk;
 
   cp->last_tagset = 0;
   cp->last_blk = NULL;
 
-  for (i=0; i<cp->nsets; i++)
+  if (cp->shadow)
+    shadow_flush(cp);
+
+  /* write back the dirty blocks, in way order of each set */
+  for (w=0; w<(cp->sample_nsets + 31)/32; w++)
     {
-      for (blk=cp->sets[i].way_head; blk; blk=blk->way_next)
+      for (bits=cp->dirty_sets[w]; bits; bits &= bits-1)
 	{
-	  if (blk->status & CACHE_BLK_VALID)
+	  for (i=0; !((bits >> i) & 1); i++)
+	    /* nada */;
+	  set = (md_addr_t)(w*32 + i);
+	  tags = CACHE_SET_TAGS(cp, set);
+
+	  for (blk=cp->sets[set].way_head; blk; blk=blk->way_next)
 	    {
-	      cp->invalidations++;
-	      blk->status &= ~CACHE_BLK_VALID;
-
-	      if (blk->status & CACHE_BLK_DIRTY)
-		{
-          	  cp->writebacks++;
-		  lat += cp->blk_access_fn(Write,
-					   CACHE_MK_BADDR(cp, blk->tag, i),
-					   cp->bsize, blk, now+lat);
-		}
+	      if (!(blk->status & CACHE_BLK_DIRTY))
+		continue;
+	      blk->status &= ~CACHE_BLK_DIRTY;
+
+	      way = CACHE_WAY(cp, set, blk);
+	      if (tags[way] == CACHE_TAG_INVALID)
+		continue;
+
+	      cp->writebacks++;
+	      if (cp->bus)
+		lat += bus_access(cp->bus, cp->bsize, now+lat, now);
+	      lat += cp->blk_access_fn(Write,
+				       CACHE_MK_BADDR(cp, blk->tag, set),
+				       cp->bsize, blk, now+lat);
 	    }
 	}
+      cp->dirty_sets[w] = 0;
+    }
+
+  /* invalidate everything else in bulk */
+  cp->invalidations += cp->valid_blks;
+  cp->pf_useless += cp->pf_pending;
+  cp->valid_blks = 0;
+  cp->pf_pending = 0;
+
+  /* CACHE_TAG_INVALID is all ones */
+  memset(cp->tags, 0xff, cp->sample_nsets*cp->assoc*sizeof(md_addr_t));
+
+  for (i=0; i<cp->victim_num; i++)
+    {
+      cp->invalidations++;
+      lat += victim_writeback(cp, &cp->victim[i], now+lat);
     }
+  cp->victim_num = 0;
+
   return lat;
 }
 
@@ -554,26 +2352,32 @@ unsigned int cache_flush_addr(struct cache_t *cp, md_addr_t addr, tick_t now)
   md_addr_t tag = CACHE_TAG(cp, addr);
   md_addr_t set = CACHE_SET(cp, addr);
   struct cache_blk_t *blk;
-  int lat = cp->hit_latency;
+  int lat = cp->hit_latency, way;
 
-  if (cp->hsize)
-    {
-      int hindex = CACHE_HASH(cp, tag);
-      for (blk=cp->sets[set].hash[hindex]; blk; blk=blk->hash_next)
-	if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	  break;
-    }
-  else
+  if (cp->sample_rate > 1)
     {
-      for (blk=cp->sets[set].way_head; blk; blk=blk->way_next)
-	if (blk->tag == tag && (blk->status & CACHE_BLK_VALID))
-	  break;
+      set = CACHE_SAMPLE_SET(cp, set);
+      if (set >= cp->sample_nsets)
+	return lat;
     }
 
+  if (cp->shadow)
+    shadow_invalidate(cp, CACHE_BADDR(cp, addr));
+
+  blk = cache_find_blk(cp, &set, tag, &way);
   if (blk)
     {
       cp->invalidations++;
-      blk->status &= ~CACHE_BLK_VALID;
+      cp->valid_blks--;
+      if (blk->status & CACHE_BLK_PREFETCH)
+	{
+	  cp->pf_useless++;
+	  cp->pf_pending--;
+	}
+      blk->status &= ~(CACHE_BLK_VALID|CACHE_BLK_PREFETCH);
+      if (way < 0)
+	way = CACHE_WAY(cp, set, blk);
+      CACHE_SET_TAGS(cp, set)[way] = CACHE_TAG_INVALID;
 
       cp->last_tagset = 0;
       cp->last_blk = NULL;
@@ -581,11 +2385,206 @@ unsigned int cache_flush_addr(struct cache_t *cp, md_addr_t addr, tick_t now)
       if (blk->status & CACHE_BLK_DIRTY)
 	{
           cp->writebacks++;
+	  if (cp->bus)
+	    lat += bus_access(cp->bus, cp->bsize, now+lat, now);
 	  lat += cp->blk_access_fn(Write,
 				   CACHE_MK_BADDR(cp, blk->tag, set),
 				   cp->bsize, blk, now+lat);
 	}
       update_way_list(&cp->sets[set], blk, Tail);
     }
+  else if (cp->victim)
+    {
+      for (way=0; way<cp->victim_num; way++)
+	if (cp->victim[way].baddr == CACHE_BADDR(cp, addr))
+	  {
+	    cp->invalidations++;
+	    lat += victim_writeback(cp, &cp->victim[way], now+lat);
+	    victim_move(cp, way, --cp->victim_num);
+	    break;
+	  }
+    }
   return lat;
 }
+
+/* transfer the configuration of cache CP to warm state file W, the state
+   of a cache can only be restored into a cache of the same organization */
+static void
+cache_warm_config(struct cache_t *cp, struct warm_t *w)
+{
+  warm_check(w, "sets", cp->nsets);
+  warm_check(w, "block size", cp->bsize);
+  warm_check(w, "associativity", cp->assoc);
+  warm_check(w, "user data size", cp->usize);
+  warm_check(w, "block data", cp->balloc);
+  warm_check(w, "replacement policy", (int)cp->policy);
+  warm_check(w, "write policy", (int)cp->wpolicy);
+  warm_check(w, "set index function", (int)cp->index);
+  warm_check(w, "set sampling rate", cp->sample_rate);
+  warm_check(w, "slices", cp->sample_slices);
+  warm_check(w, "first set", (int)cp->sample_first);
+  warm_check(w, "victim buffer size", cp->victim_size);
+}
+
+/* save the blocks and replacement state of cache CP to warm state file W */
+void cache_save(struct cache_t *cp, struct warm_t *w)
+{
+  struct cache_blk_t *blk;
+  struct cache_victim_t *ent;
+  int i, way, nblks = cp->sample_nsets*cp->assoc;
+
+  warm_begin(w, cp->name);
+  cache_warm_config(cp, w);
+
+  warm_put(w, cp->tags, nblks*sizeof(md_addr_t));
+  for (i=0; i<cp->sample_nsets; i++)
+    {
+      /* the way chain, from its head */
+      for (blk=cp->sets[i].way_head; blk; blk=blk->way_next)
+	{
+	  way = CACHE_WAY(cp, i, blk);
+	  warm_put(w, &way, sizeof(int));
+	}
+
+      for (way=0; way<cp->assoc; way++)
+	{
+	  blk = CACHE_BINDEX(cp, cp->sets[i].blks, way);
+	  warm_put(w, &blk->tag, sizeof(md_addr_t));
+	  warm_put(w, &blk->status, sizeof(unsigned int));
+	  if (cp->usize)
+	    warm_put(w, blk->user_data, cp->usize);
+	  if (cp->balloc)
+	    warm_put(w, blk->data, cp->bsize);
+	}
+    }
+
+  if (cp->plru)
+    warm_put(w, cp->plru, cp->sample_nsets*cp->plru_stride);
+  if (cp->rrpv)
+    {
+      warm_put(w, cp->rrpv, nblks);
+      warm_put(w, &cp->psel, sizeof(int));
+    }
+  if (cp->skew_stamp)
+    {
+      warm_put(w, cp->skew_stamp, nblks*sizeof(counter_t));
+      warm_put(w, &cp->skew_clock, sizeof(counter_t));
+    }
+  warm_put(w, &cp->rand_state, sizeof(unsigned int));
+
+  warm_put(w, cp->dirty_sets,
+	   ((cp->sample_nsets + 31) / 32)*sizeof(unsigned int));
+  warm_put(w, &cp->valid_blks, sizeof(int));
+  warm_put(w, &cp->pf_pending, sizeof(int));
+
+  /* the victim buffer, most recently inserted block first */
+  warm_put(w, &cp->victim_num, sizeof(int));
+  for (i=0; i<cp->victim_num; i++)
+    {
+      ent = &cp->victim[i];
+      warm_put(w, &ent->baddr, sizeof(md_addr_t));
+      warm_put(w, &ent->status, sizeof(unsigned int));
+      if (cp->usize)
+	warm_put(w, ent->user_data, cp->usize);
+      if (cp->balloc)
+	warm_put(w, ent->data, cp->bsize);
+    }
+
+  warm_end(w);
+}
+
+/* restore the blocks and replacement state of cache CP from the current
+   section of warm state file W */
+void cache_restore(struct cache_t *cp, struct warm_t *w)
+{
+  struct cache_set_t *set;
+  struct cache_blk_t *blk;
+  struct cache_victim_t *ent;
+  int i, j, way, num, nblks = cp->sample_nsets*cp->assoc;
+
+  if (cp->hits || cp->misses || cp->sample_skips)
+    panic("cache `%s' restored after it was accessed", cp->name);
+  cache_warm_config(cp, w);
+
+  warm_get(w, cp->tags, nblks*sizeof(md_addr_t));
+  for (i=0; i<cp->sample_nsets; i++)
+    {
+      set = &cp->sets[i];
+
+      /* rebuild the way chain */
+      set->way_head = set->way_tail = NULL;
+      for (j=0; j<cp->assoc; j++)
+	{
+	  warm_get(w, &way, sizeof(int));
+	  if (way < 0 || way >= cp->assoc)
+	    fatal("warm state of `%s' in `%s' is corrupted", cp->name, w->fname);
+	  blk = CACHE_BINDEX(cp, set->blks, way);
+	  blk->way_prev = set->way_tail;
+	  blk->way_next = NULL;
+	  if (set->way_tail)
+	    set->way_tail->way_next = blk;
+	  else
+	    set->way_head = blk;
+	  set->way_tail = blk;
+	}
+
+      /* rebuild the hash table, blocks are hashed by their tag */
+      if (cp->hsize)
+	memset(set->hash, 0, cp->hsize*sizeof(struct cache_blk_t *));
+
+      for (way=0; way<cp->assoc; way++)
+	{
+	  blk = CACHE_BINDEX(cp, set->blks, way);
+	  warm_get(w, &blk->tag, sizeof(md_addr_t));
+	  warm_get(w, &blk->status, sizeof(unsigned int));
+	  if (cp->usize)
+	    warm_get(w, blk->user_data, cp->usize);
+	  if (cp->balloc)
+	    warm_get(w, blk->data, cp->bsize);
+
+	  /* fills of the saving run are done */
+	  blk->ready = 0;
+
+	  if (cp->hsize)
+	    link_htab_ent(cp, set, blk);
+	}
+    }
+
+  if (cp->plru)
+    warm_get(w, cp->plru, cp->sample_nsets*cp->plru_stride);
+  if (cp->rrpv)
+    {
+      warm_get(w, cp->rrpv, nblks);
+      warm_get(w, &cp->psel, sizeof(int));
+    }
+  if (cp->skew_stamp)
+    {
+      warm_get(w, cp->skew_stamp, nblks*sizeof(counter_t));
+      warm_get(w, &cp->skew_clock, sizeof(counter_t));
+    }
+  warm_get(w, &cp->rand_state, sizeof(unsigned int));
+
+  warm_get(w, cp->dirty_sets,
+	   ((cp->sample_nsets + 31) / 32)*sizeof(unsigned int));
+  warm_get(w, &cp->valid_blks, sizeof(int));
+  warm_get(w, &cp->pf_pending, sizeof(int));
+
+  /* the victim buffer, most recently inserted block first */
+  warm_get(w, &num, sizeof(int));
+  if (num < 0 || num > cp->victim_size)
+    fatal("warm state of `%s' in `%s' is corrupted", cp->name, w->fname);
+  cp->victim_num = num;
+  for (i=0; i<num; i++)
+    {
+      ent = &cp->victim[i];
+      warm_get(w, &ent->baddr, sizeof(md_addr_t));
+      warm_get(w, &ent->status, sizeof(unsigned int));
+      if (cp->usize)
+	warm_get(w, ent->user_data, cp->usize);
+      if (cp->balloc)
+	warm_get(w, ent->data, cp->bsize);
+    }
+
+  cp->last_tagset = 0;
+  cp->last_blk = NULL;
+}